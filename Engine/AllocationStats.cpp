@@ -0,0 +1,22 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationStats.hpp"
+
+static std::atomic<std::uint64_t> allocationCount{0};
+
+void* operator new(std::size_t size){
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace AllocationStats {
+    std::uint64_t getCount(){
+        return allocationCount.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <cstdint>
+
+// counts every call to the global operator new, for benchmarks and the per frame heap counter.
+// linking this in replaces operator new for the whole program
+namespace AllocationStats {
+    std::uint64_t getCount(); // allocations since startup, from all threads
+}
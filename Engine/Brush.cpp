@@ -0,0 +1,64 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+
+#include "Brush.hpp"
+
+float Brush::getScale(Source source, float speed, float pressure) const {
+    float t = 1.f;
+    if (source == Source::Velocity)
+        t = 1.f - std::min(speed / fullSpeed, 1.f);
+    else if (source == Source::Pressure)
+        t = std::clamp(pressure, 0.f, 1.f);
+    return minimum + (1.f - minimum) * t;
+}
+
+// cheap integer hash for the chalk grain, so the atlas comes out the same every run
+static float grain(unsigned int x, unsigned int y){
+    unsigned int h = x * 374761393u + y * 668265263u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    return (float)((h ^ (h >> 16)) & 0xFF) / 255.f;
+}
+
+sf::Image makeBrushAtlas(){
+    sf::Image atlas({BRUSH_STAMP_SIZE * BRUSH_STAMP_COUNT, BRUSH_STAMP_SIZE}, sf::Color::White);
+    float center = BRUSH_STAMP_SIZE / 2.f;
+    float radius = center - 1.f;
+    for (unsigned int y = 0; y < BRUSH_STAMP_SIZE; y++){
+        for (unsigned int x = 0; x < BRUSH_STAMP_SIZE; x++){
+            float dx = x + 0.5f - center;
+            float dy = y + 0.5f - center;
+            float distance = std::sqrt(dx * dx + dy * dy);
+            float disc = std::clamp(radius - distance + 0.5f, 0.f, 1.f);
+
+            float falloff = std::max(0.f, 1.f - distance / radius);
+            float airbrush = falloff * falloff;
+            float chalk = disc * (grain(x, y) > 0.35f ? 1.f : 0.25f);
+            // a nib at 45 degrees, a fifth as thick as it is wide
+            float along = std::abs(dx + dy) * 0.70710678f;
+            float across = std::abs(dx - dy) * 0.70710678f;
+            float chisel = std::clamp(radius - along + 0.5f, 0.f, 1.f) * std::clamp(radius / 5.f - across + 0.5f, 0.f, 1.f);
+
+            float alphas[BRUSH_STAMP_COUNT] = {1.f, airbrush, chalk, chisel};
+            for (unsigned int s = 0; s < BRUSH_STAMP_COUNT; s++)
+                atlas.setPixel({s * BRUSH_STAMP_SIZE + x, y}, sf::Color(255, 255, 255, (std::uint8_t)(alphas[s] * 255.f)));
+        }
+    }
+    return atlas;
+}
+
+const sf::Texture& getBrushTexture(){
+    static const sf::Texture texture = [](){
+        sf::Texture atlas(makeBrushAtlas());
+        atlas.setSmooth(true);
+        return atlas;
+    }();
+    return texture;
+}
+
+sf::RenderStates getStrokeStates(bool stamped){
+    sf::RenderStates states;
+    if (stamped)
+        states.texture = &getBrushTexture();
+    return states;
+}
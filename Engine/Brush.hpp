@@ -0,0 +1,33 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+
+#include "Stroke.hpp"
+
+// how pointer input turns into a stroke: the stamp it's drawn with and what drives each
+// point's width and opacity
+struct Brush {
+    enum class Source : std::uint8_t {
+        None,
+        Velocity, // faster is thinner / lighter, like ink running dry
+        Pressure  // pen or touch pressure, for platforms that report it
+    };
+
+    BrushStamp stamp = BrushStamp::Solid;
+    Source width = Source::None;
+    Source opacity = Source::None;
+    float minimum = 0.3f;   // scale at full speed or no pressure
+    float fullSpeed = 30.f; // world units between pointer samples where velocity bottoms out
+
+    // scale in [minimum, 1] for one sample; speed is the distance since the previous sample
+    float getScale(Source source, float speed, float pressure) const;
+};
+
+// the stamps in one row, BRUSH_STAMP_SIZE square each, white with the shape in alpha. the solid
+// slot is all white, so untextured triangles (texture coordinates 0, 0) draw the same with it bound
+sf::Image makeBrushAtlas();
+// the atlas, uploaded on first use. only stamped strokes need it bound
+const sf::Texture& getBrushTexture();
+// states for drawing tessellated strokes, binding the atlas only when one of them is stamped so
+// plain drawings cost what they did before
+sf::RenderStates getStrokeStates(bool stamped);
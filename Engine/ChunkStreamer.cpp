@@ -0,0 +1,462 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+
+#include "Brush.hpp"
+#include "ChunkStreamer.hpp"
+#include "Downsample.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+
+// four indices per texel, the column within the texel picks the channel, and the palette gives the colour
+static const char* paletteShaderSource = R"(
+uniform sampler2D texture;
+uniform sampler2D palette;
+uniform float columns;
+
+void main(){
+    vec2 uv = gl_TexCoord[0].xy;
+    vec4 packed = texture2D(texture, uv);
+    float lane = floor(fract(uv.x * columns) * 4.0);
+    float index = lane < 0.5 ? packed.r : lane < 1.5 ? packed.g : lane < 2.5 ? packed.b : packed.a;
+    gl_FragColor = gl_Color * texture2D(palette, vec2((index * 255.0 + 0.5) / 256.0, 0.5));
+}
+)";
+
+// the level L tile a chunk falls in, rounding towards negative infinity like chunkAt does
+static ChunkCoord tileOf(ChunkCoord chunk, int level){
+    auto shift = [level](int v){ return v >= 0 ? v >> level : -((-v - 1) >> level) - 1; };
+    return {shift(chunk.x), shift(chunk.y)};
+}
+
+ChunkStreamer::ChunkStreamer(const std::string& levelPath, std::size_t maxResidentChunks)
+    : m_maxResident(maxResidentChunks)
+{
+    if (m_level.open(levelPath)){
+        m_existing.insert(m_level.getChunkCoords().begin(), m_level.getChunkCoords().end());
+        loadPalette();
+    }
+    m_worker = std::thread(&ChunkStreamer::workerLoop, this);
+}
+
+ChunkStreamer::~ChunkStreamer(){
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    m_worker.join();
+}
+
+void ChunkStreamer::loadPalette(){
+    const std::vector<sf::Color>& palette = m_level.getPalette();
+    if (palette.empty() || !sf::Shader::isAvailable())
+        return;
+    std::vector<std::uint8_t> pixels(LEVEL_PALETTE_SIZE * 4, 0);
+    for (std::size_t i = 0; i < palette.size(); i++){
+        pixels[i * 4] = palette[i].r;
+        pixels[i * 4 + 1] = palette[i].g;
+        pixels[i * 4 + 2] = palette[i].b;
+        pixels[i * 4 + 3] = palette[i].a;
+    }
+    auto shader = std::make_unique<sf::Shader>();
+    if (!m_paletteTexture.resize({LEVEL_PALETTE_SIZE, 1}) || !shader->loadFromMemory(paletteShaderSource, sf::Shader::Type::Fragment))
+        return; // chunks get baked from their strokes instead
+    m_paletteTexture.update(pixels.data());
+    shader->setUniform("texture", sf::Shader::CurrentTexture);
+    shader->setUniform("palette", m_paletteTexture);
+    shader->setUniform("columns", (float)(CHUNKSIZE / 4));
+    m_paletteShader = std::move(shader);
+}
+
+void ChunkStreamer::workerLoop(){
+    PROFILE_THREAD("chunk streamer");
+    while (true){
+        ChunkCoord coord;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this](){ return m_quit || !m_requests.empty(); });
+            if (m_quit)
+                return;
+            coord = m_requests.front();
+            m_requests.pop_front();
+            m_inFlight.insert(coord);
+        }
+        // decoding (and the page faults behind it) happen off the main thread
+        auto chunk = std::make_unique<Chunk>();
+        bool ok;
+        {
+            PROFILE_SCOPE("load chunk");
+            ok = m_level.loadChunk(coord, *chunk);
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_inFlight.erase(coord);
+        if (!ok)
+            chunk->coord = coord; // an empty chunk still counts as loaded so it isn't requested forever
+        m_loaded.push_back(std::move(chunk));
+    }
+}
+
+void ChunkStreamer::wantChunks(const sf::View& camera, sf::Vector2f velocity, FrameVector<ChunkCoord>& wanted){
+    sf::Vector2f half = camera.getSize() / 2.f;
+    sf::Vector2f center = camera.getCenter();
+    sf::Vector2f ahead = center + velocity * m_prefetchSeconds;
+
+    // visible chunks, then the area the player will reach soon, plus a one chunk margin around both
+    ChunkCoord visLo = chunkAt(center - half);
+    ChunkCoord visHi = chunkAt(center + half);
+    ChunkCoord lo = chunkAt({std::min(center.x, ahead.x) - half.x, std::min(center.y, ahead.y) - half.y});
+    ChunkCoord hi = chunkAt({std::max(center.x, ahead.x) + half.x, std::max(center.y, ahead.y) + half.y});
+    lo = {lo.x - 1, lo.y - 1};
+    hi = {hi.x + 1, hi.y + 1};
+
+    wanted.reserve((hi.x - lo.x + 1) * (hi.y - lo.y + 1));
+    for (int cy = lo.y; cy <= hi.y; cy++){
+        for (int cx = lo.x; cx <= hi.x; cx++){
+            ChunkCoord c{cx, cy};
+            if (!m_existing.count(c))
+                continue;
+            if (cx >= visLo.x && cx <= visHi.x && cy >= visLo.y && cy <= visHi.y)
+                m_visible.push_back(c);
+            wanted.push_back(c);
+        }
+    }
+    // nearest to the predicted position first, and never want more than we are allowed to keep
+    auto distance = [&ahead, &center](ChunkCoord c){
+        sf::Vector2f mid = chunkBounds(c).getCenter();
+        return std::min(std::hypot(mid.x - center.x, mid.y - center.y), std::hypot(mid.x - ahead.x, mid.y - ahead.y));
+    };
+    std::sort(wanted.begin(), wanted.end(), [&distance](ChunkCoord a, ChunkCoord b){ return distance(a) < distance(b); });
+    if (wanted.size() > m_maxResident)
+        wanted.resize(m_maxResident);
+}
+
+void ChunkStreamer::update(const sf::View& camera, sf::Vector2f velocity, float unitsPerPixel){
+    m_frame++;
+    m_mipLevel = unitsPerPixel >= 2.f ? std::min((int)std::log2(unitsPerPixel), MIP_LEVELS) : 0;
+    m_visible.clear();
+    m_visibleTiles.clear();
+    FrameVector<ChunkCoord> wanted;
+    if (m_mipLevel > 0)
+        wantMipTiles(camera, wanted);
+    else
+        wantChunks(camera, velocity, wanted);
+
+    std::vector<std::unique_ptr<Chunk>> loaded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        loaded.swap(m_loaded);
+    }
+    for (auto& chunk : loaded){
+        ChunkCoord c = chunk->coord;
+        if (std::find(wanted.begin(), wanted.end(), c) == wanted.end())
+            continue; // camera moved on while it was loading
+        ResidentChunk& resident = m_resident[c];
+        resident.data = std::move(chunk);
+    }
+
+    bool requested = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.clear();
+        for (const auto& c : wanted){
+            auto it = m_resident.find(c);
+            if (it != m_resident.end())
+                it->second.lastWanted = m_frame;
+            else if (!m_inFlight.count(c))
+                m_requests.push_back(c);
+        }
+        requested = !m_requests.empty();
+    }
+    if (requested)
+        m_wake.notify_one();
+
+    // baking needs the GL context so it stays here, but only a few per frame and visible ones first
+    int budget = m_bakeBudget;
+    for (const auto& c : m_visible){
+        auto it = m_resident.find(c);
+        if (it != m_resident.end() && !isBaked(it->second)){
+            bake(it->second);
+            budget--;
+        }
+    }
+    for (const auto& c : wanted){
+        if (budget <= 0)
+            break;
+        auto it = m_resident.find(c);
+        if (it != m_resident.end() && !isBaked(it->second)){
+            bake(it->second);
+            budget--;
+        }
+    }
+    // zoomed out the chunks are only baked to be filtered into their tiles, which costs a readback
+    // unless they're indexed
+    if (m_mipLevel > 0){
+        int contributions = m_bakeBudget;
+        for (const auto& c : wanted){
+            if (contributions <= 0)
+                break;
+            auto it = m_resident.find(c);
+            if (it != m_resident.end() && isBaked(it->second) && !m_mips[m_mipLevel].contributed.count(c)){
+                contribute(c, it->second);
+                contributions--;
+            }
+        }
+        evictMipTiles();
+    }
+
+    evict(m_frame);
+}
+
+void ChunkStreamer::wantMipTiles(const sf::View& camera, FrameVector<ChunkCoord>& wanted){
+    int level = m_mipLevel;
+    int span = 1 << level; // chunks per tile side
+    MipLevel& mips = m_mips[level];
+    sf::Vector2f half = camera.getSize() / 2.f;
+    sf::Vector2f center = camera.getCenter();
+    ChunkCoord lo = tileOf(chunkAt(center - half), level);
+    ChunkCoord hi = tileOf(chunkAt(center + half), level);
+    for (int ty = lo.y; ty <= hi.y; ty++){
+        for (int tx = lo.x; tx <= hi.x; tx++){
+            ChunkCoord t{tx, ty};
+            auto it = mips.tiles.find(t);
+            if (it == mips.tiles.end()){
+                // empty tiles are never drawn, so they don't take up a slot either
+                MipTile tile;
+                for (int cy = ty * span; cy < (ty + 1) * span; cy++)
+                    for (int cx = tx * span; cx < (tx + 1) * span; cx++)
+                        tile.expected += m_existing.count({cx, cy});
+                if (tile.expected == 0)
+                    continue;
+                it = mips.tiles.emplace(t, std::move(tile)).first;
+            }
+            MipTile& tile = it->second;
+            tile.lastWanted = m_frame;
+            m_visibleTiles.push_back(t);
+            if (tile.contributed == tile.expected)
+                continue;
+            for (int cy = ty * span; cy < (ty + 1) * span; cy++){
+                for (int cx = tx * span; cx < (tx + 1) * span; cx++){
+                    ChunkCoord c{cx, cy};
+                    if (m_existing.count(c) && !mips.contributed.count(c))
+                        wanted.push_back(c);
+                }
+            }
+        }
+    }
+    // fill in from the middle of the screen out, a resident budget's worth at a time
+    auto distance = [&center](ChunkCoord c){
+        sf::Vector2f mid = chunkBounds(c).getCenter();
+        return std::hypot(mid.x - center.x, mid.y - center.y);
+    };
+    std::sort(wanted.begin(), wanted.end(), [&distance](ChunkCoord a, ChunkCoord b){ return distance(a) < distance(b); });
+    if (wanted.size() > m_maxResident)
+        wanted.resize(m_maxResident);
+}
+
+void ChunkStreamer::contribute(ChunkCoord coord, const ResidentChunk& chunk){
+    PROFILE_SCOPE("mip chunk");
+    int level = m_mipLevel;
+    MipLevel& mips = m_mips[level];
+    MipTile& tile = mips.tiles[tileOf(coord, level)];
+    if (!tile.texture){
+        tile.texture = std::make_unique<sf::Texture>(sf::Vector2u(CHUNKSIZE, CHUNKSIZE));
+        std::vector<std::uint8_t> transparent((std::size_t)CHUNKSIZE * CHUNKSIZE * 4, 0);
+        tile.texture->update(transparent.data());
+        tile.texture->setSmooth(true);
+    }
+    // one readback per chunk and level, then halve it level times, ping-ponging between two buffers.
+    // indexed chunks are expanded from their indices instead, nothing is read back
+    const std::size_t pixels = (std::size_t)CHUNKSIZE * CHUNKSIZE;
+    m_mipScratch.resize(pixels + pixels / 4 + (chunk.indexed ? pixels * 4 : 0));
+    std::uint8_t* buffers[2] = {m_mipScratch.data(), m_mipScratch.data() + pixels};
+    sf::Image image;
+    const std::uint8_t* source;
+    if (chunk.indexed){
+        const std::vector<sf::Color>& palette = m_level.getPalette();
+        std::uint8_t* expanded = m_mipScratch.data() + pixels + pixels / 4;
+        for (std::size_t i = 0; i < pixels; i++){
+            sf::Color color = palette[chunk.data->indices[i]];
+            expanded[i * 4] = color.r;
+            expanded[i * 4 + 1] = color.g;
+            expanded[i * 4 + 2] = color.b;
+            expanded[i * 4 + 3] = color.a;
+        }
+        source = expanded;
+    } else {
+        image = chunk.texture->getTexture().copyToImage();
+        source = image.getPixelsPtr();
+    }
+    unsigned int size = CHUNKSIZE;
+    for (int i = 0; i < level; i++){
+        downsampleHalf(source, size, size, buffers[i % 2]);
+        source = buffers[i % 2];
+        size /= 2;
+    }
+    ChunkCoord t = tileOf(coord, level);
+    int span = 1 << level;
+    sf::Vector2u offset((unsigned int)(coord.x - t.x * span) * size, (unsigned int)(coord.y - t.y * span) * size);
+    tile.texture->update(source, {size, size}, offset);
+    tile.contributed++;
+    mips.contributed.insert(coord);
+}
+
+void ChunkStreamer::evictMipTiles(){
+    std::size_t count = 0;
+    for (const auto& mips : m_mips)
+        count += mips.tiles.size();
+    while (count > MIP_MAX_TILES){
+        int oldestLevel = 0;
+        ChunkCoord oldest{0, 0};
+        unsigned long long oldestFrame = ~0ull;
+        // tiles on screen this frame are kept even over the cap, draw() still needs them
+        for (int level = 1; level <= MIP_LEVELS; level++){
+            for (const auto& [t, tile] : m_mips[level].tiles){
+                if (tile.lastWanted != m_frame && tile.lastWanted < oldestFrame){
+                    oldestFrame = tile.lastWanted;
+                    oldestLevel = level;
+                    oldest = t;
+                }
+            }
+        }
+        if (oldestLevel == 0)
+            break;
+        // its chunks have to be filtered in again if it's ever wanted back
+        int span = 1 << oldestLevel;
+        for (int cy = oldest.y * span; cy < (oldest.y + 1) * span; cy++)
+            for (int cx = oldest.x * span; cx < (oldest.x + 1) * span; cx++)
+                m_mips[oldestLevel].contributed.erase({cx, cy});
+        m_mips[oldestLevel].tiles.erase(oldest);
+        count--;
+    }
+}
+
+void ChunkStreamer::bake(ResidentChunk& chunk){
+    PROFILE_SCOPE("bake chunk");
+    if (m_paletteShader && chunk.data->indices.size() == (std::size_t)CHUNKSIZE * CHUNKSIZE){
+        // four consecutive indices are already the bytes of one RGBA texel
+        chunk.indexed = std::make_unique<sf::Texture>();
+        if (chunk.indexed->resize({CHUNKSIZE / 4, CHUNKSIZE})){
+            chunk.indexed->update(chunk.data->indices.data());
+            return;
+        }
+        chunk.indexed.reset();
+    }
+    chunk.data->indices = std::vector<std::uint8_t>(); // not drawn from, don't keep them resident
+    if (!m_texturePool.empty()){
+        chunk.texture = std::move(m_texturePool.back());
+        m_texturePool.pop_back();
+    } else {
+        chunk.texture = std::make_unique<sf::RenderTexture>(sf::Vector2u(CHUNKSIZE, CHUNKSIZE));
+    }
+    sf::Vector2f origin = chunkBounds(chunk.data->coord).position;
+    std::size_t vertexCount = 0;
+    bool stamped = false;
+    for (const auto& stroke : chunk.data->strokes){
+        vertexCount += getTessellatedVertexCount(stroke);
+        stamped |= stroke.stamp != BrushStamp::Solid;
+    }
+    FrameVector<sf::Vertex> triangles;
+    triangles.reserve(vertexCount);
+    for (const auto& stroke : chunk.data->strokes)
+        tessellateStroke(stroke, triangles, -origin);
+    CountingTarget target(*chunk.texture);
+    target.clear(sf::Color::Transparent);
+    target.draw(triangles.data(), triangles.size(), sf::PrimitiveType::Triangles, getStrokeStates(stamped));
+    chunk.texture->display();
+}
+
+void ChunkStreamer::evict(unsigned long long frame){
+    if (m_resident.size() <= m_maxResident){
+        // still drop anything that hasn't been wanted for a while, keeps memory tracking the camera
+        for (auto it = m_resident.begin(); it != m_resident.end();){
+            if (frame - it->second.lastWanted > 600){
+                if (it->second.texture)
+                    m_texturePool.push_back(std::move(it->second.texture));
+                it = m_resident.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    while (m_resident.size() > m_maxResident){
+        auto oldest = m_resident.begin();
+        for (auto it = m_resident.begin(); it != m_resident.end(); ++it){
+            if (it->second.lastWanted < oldest->second.lastWanted)
+                oldest = it;
+        }
+        if (oldest->second.texture)
+            m_texturePool.push_back(std::move(oldest->second.texture));
+        m_resident.erase(oldest);
+    }
+    // the pool only needs to cover a frame's worth of churn
+    if (m_texturePool.size() > 8)
+        m_texturePool.resize(8);
+}
+
+void ChunkStreamer::draw(sf::RenderTarget& renderTarget) const {
+    CountingTarget target(renderTarget);
+    if (m_mipLevel > 0){
+        int span = 1 << m_mipLevel;
+        float scale = (float)span;
+        for (const auto& t : m_visibleTiles){
+            auto it = m_mips[m_mipLevel].tiles.find(t);
+            if (it == m_mips[m_mipLevel].tiles.end() || !it->second.texture)
+                continue;
+            sf::Sprite sprite(*it->second.texture);
+            sprite.setPosition(chunkBounds({t.x * span, t.y * span}).position);
+            sprite.setScale({scale, scale});
+            target.draw(sprite);
+        }
+        return;
+    }
+    for (const auto& c : m_visible){
+        auto it = m_resident.find(c);
+        if (it == m_resident.end() || !isBaked(it->second))
+            continue;
+        if (it->second.indexed){
+            sf::Sprite sprite(*it->second.indexed);
+            sprite.setPosition(chunkBounds(c).position);
+            sprite.setScale({4.f, 1.f});
+            target.draw(sprite, sf::RenderStates(m_paletteShader.get()));
+            continue;
+        }
+        sf::Sprite sprite(it->second.texture->getTexture());
+        sprite.setPosition(chunkBounds(c).position);
+        target.draw(sprite);
+    }
+}
+
+const Chunk* ChunkStreamer::getChunk(ChunkCoord coord) const {
+    auto it = m_resident.find(coord);
+    return it == m_resident.end() ? nullptr : it->second.data.get();
+}
+
+void ChunkStreamer::getCollision(sf::FloatRect area, std::vector<CollisionCapsule>& out) const {
+    [[maybe_unused]] std::size_t before = out.size();
+    ChunkCoord lo = chunkAt(area.position);
+    ChunkCoord hi = chunkAt(area.position + area.size);
+    for (int cy = lo.y; cy <= hi.y; cy++){
+        for (int cx = lo.x; cx <= hi.x; cx++){
+            if (const Chunk* chunk = getChunk({cx, cy}))
+                out.insert(out.end(), chunk->collision.begin(), chunk->collision.end());
+        }
+    }
+    PROFILE_COUNTER("collision candidates", out.size() - before); // capsules the caller will test against
+}
+
+std::size_t ChunkStreamer::getResidentBytes() const {
+    std::size_t bytes = 0;
+    for (const auto& [c, chunk] : m_resident){
+        bytes += chunk.data->getMemoryUsage();
+        if (chunk.texture)
+            bytes += CHUNKSIZE * CHUNKSIZE * 4;
+        if (chunk.indexed)
+            bytes += CHUNKSIZE * CHUNKSIZE;
+    }
+    for (const auto& mips : m_mips)
+        for (const auto& [t, tile] : mips.tiles)
+            if (tile.texture)
+                bytes += CHUNKSIZE * CHUNKSIZE * 4;
+    return bytes + m_texturePool.size() * CHUNKSIZE * CHUNKSIZE * 4;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "FrameArena.hpp"
+#include "Level.hpp"
+#include "LevelFile.hpp"
+
+#define MIP_LEVELS 5       // coarsest level has one tile per 32x32 chunks
+#define MIP_MAX_TILES 64   // resident tiles over all levels, CHUNKSIZE squared texels each
+
+// keeps the chunks around the camera resident (strokes, collision and a baked texture)
+// and streams the rest in from a mapped level file on a background thread.
+// zoomed out, it draws a mip pyramid instead: a level L tile covers 2^L chunks per side at the
+// resolution of one chunk, and each chunk is baked once, read back and box filtered down into it.
+// tiles fill in lazily as the chunks under the visible ones stream past, so a zoomed out frame
+// draws about a screen's worth of texels however much of the world is in view.
+// chunks the level has baked palette indices for skip the bake: the indices go up four to a texel
+// and a shader looks their colours up in the level's palette as they're drawn
+class ChunkStreamer {
+public:
+    ChunkStreamer(const std::string& levelPath, std::size_t maxResidentChunks = 48);
+    ~ChunkStreamer();
+    ChunkStreamer(const ChunkStreamer&) = delete;
+    ChunkStreamer& operator=(const ChunkStreamer&) = delete;
+
+    // call once per frame before drawing; velocity is in world units per second, unitsPerPixel is
+    // the camera's zoom and picks the mip level (1 or less draws the chunks themselves)
+    void update(const sf::View& camera, sf::Vector2f velocity, float unitsPerPixel = 1.f);
+    void draw(sf::RenderTarget& target) const;
+
+    const Chunk* getChunk(ChunkCoord coord) const; // nullptr if not resident
+    void getCollision(sf::FloatRect area, std::vector<CollisionCapsule>& out) const;
+
+    std::size_t getResidentCount() const { return m_resident.size(); }
+    int getMipLevel() const { return m_mipLevel; }
+    std::size_t getResidentBytes() const;
+    void setPrefetchSeconds(float seconds){ m_prefetchSeconds = seconds; }
+    void setBakeBudget(int chunksPerFrame){ m_bakeBudget = chunksPerFrame; }
+
+private:
+    struct ResidentChunk {
+        std::unique_ptr<Chunk> data;
+        std::unique_ptr<sf::RenderTexture> texture; // null until baked
+        std::unique_ptr<sf::Texture> indexed;       // CHUNKSIZE / 4 x CHUNKSIZE packed indices, instead of texture
+        unsigned long long lastWanted = 0;
+    };
+
+    struct MipTile {
+        std::unique_ptr<sf::Texture> texture; // null until a chunk under it is drawn in
+        std::size_t expected = 0;             // chunks under it that exist in the level
+        std::size_t contributed = 0;          // of those, already drawn in
+        unsigned long long lastWanted = 0;
+    };
+
+    struct MipLevel {
+        std::unordered_map<ChunkCoord, MipTile, ChunkCoordHash> tiles;
+        std::unordered_set<ChunkCoord, ChunkCoordHash> contributed; // chunks drawn into this level's tiles
+    };
+
+    void workerLoop();
+    void loadPalette();
+    static bool isBaked(const ResidentChunk& chunk){ return chunk.texture || chunk.indexed; }
+    void bake(ResidentChunk& chunk);
+    void evict(unsigned long long frame);
+    void wantChunks(const sf::View& camera, sf::Vector2f velocity, FrameVector<ChunkCoord>& wanted);
+    void wantMipTiles(const sf::View& camera, FrameVector<ChunkCoord>& wanted);
+    void contribute(ChunkCoord coord, const ResidentChunk& chunk); // filters the chunk's texture into its tile
+    void evictMipTiles();
+
+    LevelFile m_level; // read only once opened, so the worker can decode from it without locking
+    std::size_t m_maxResident;
+    float m_prefetchSeconds = 0.75f;
+    int m_bakeBudget = 2;
+    unsigned long long m_frame = 0;
+
+    std::unordered_set<ChunkCoord, ChunkCoordHash> m_existing; // from the level directory
+    std::unordered_map<ChunkCoord, ResidentChunk, ChunkCoordHash> m_resident;
+    std::vector<ChunkCoord> m_visible;
+    int m_mipLevel = 0;
+    MipLevel m_mips[MIP_LEVELS + 1]; // [0] is unused, level 0 is the chunks
+    std::vector<ChunkCoord> m_visibleTiles; // at m_mipLevel
+    std::vector<std::uint8_t> m_mipScratch;
+    std::unique_ptr<sf::Shader> m_paletteShader; // null when the level has no palette or there are no shaders
+    sf::Texture m_paletteTexture;                // LEVEL_PALETTE_SIZE x 1
+    std::vector<std::unique_ptr<sf::RenderTexture>> m_texturePool; // recycled so eviction never frees GL objects mid-frame
+
+    // shared with the worker
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<ChunkCoord> m_requests;  // nearest first, replaced every update
+    std::unordered_set<ChunkCoord, ChunkCoordHash> m_inFlight;
+    std::vector<std::unique_ptr<Chunk>> m_loaded;
+    bool m_quit = false;
+    std::thread m_worker;
+};
@@ -0,0 +1,123 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "Collision.hpp"
+#include "Shape.hpp"
+#include "Stroke.hpp"
+
+#define FILL_COLLISION_BAND 8.f // world units of fill per row of capsules
+
+// distance from p to the segment from a to b
+static float distanceToSegment(sf::Vector2f p, sf::Vector2f a, sf::Vector2f b){
+    sf::Vector2f ab = b - a;
+    float lengthSquared = ab.x * ab.x + ab.y * ab.y;
+    float t = lengthSquared > 0.f ? std::clamp(((p.x - a.x) * ab.x + (p.y - a.y) * ab.y) / lengthSquared, 0.f, 1.f) : 0.f;
+    return std::hypot(p.x - a.x - ab.x * t, p.y - a.y - ab.y * t);
+}
+
+// a box as the capsule inscribed along its longer side
+static void appendBoxCapsule(float x0, float y0, float x1, float y1, std::vector<CollisionCapsule>& out){
+    float w = x1 - x0, h = y1 - y0;
+    if (w <= 0.f || h <= 0.f)
+        return;
+    if (w >= h){
+        float r = h / 2.f;
+        out.push_back({{x0 + r, y0 + r}, {x1 - r, y0 + r}, r});
+    } else {
+        float r = w / 2.f;
+        out.push_back({{x0 + r, y0 + r}, {x0 + r, y1 - r}, r});
+    }
+}
+
+// fills are cut into horizontal bands, and the overlapping rectangles in each band merged into one
+// capsule. a slanted edge comes out up to a band's height of slope too wide, but a fill costs
+// about one capsule per band per run instead of one per pixel row
+static void compileFillCollision(const Stroke& stroke, std::vector<CollisionCapsule>& out){
+    struct Slice {
+        int band;
+        float x0, y0, x1, y1;
+    };
+    std::vector<Slice> slices;
+    const auto& pts = stroke.points;
+    for (std::size_t i = 0; i + 1 < pts.size(); i += 2){
+        sf::Vector2f a = pts[i], b = pts[i + 1];
+        if (b.x <= a.x || b.y <= a.y)
+            continue;
+        for (int band = (int)std::floor(a.y / FILL_COLLISION_BAND); band * FILL_COLLISION_BAND < b.y; band++)
+            slices.push_back({band, a.x, std::max(a.y, band * FILL_COLLISION_BAND), b.x, std::min(b.y, (band + 1) * FILL_COLLISION_BAND)});
+    }
+    std::sort(slices.begin(), slices.end(), [](const Slice& a, const Slice& b){ return a.band != b.band ? a.band < b.band : a.x0 < b.x0; });
+    for (std::size_t i = 0; i < slices.size();){
+        Slice merged = slices[i++];
+        while (i < slices.size() && slices[i].band == merged.band && slices[i].x0 <= merged.x1){
+            merged.x1 = std::max(merged.x1, slices[i].x1);
+            merged.y0 = std::min(merged.y0, slices[i].y0);
+            merged.y1 = std::max(merged.y1, slices[i].y1);
+            i++;
+        }
+        appendBoxCapsule(merged.x0, merged.y0, merged.x1, merged.y1, out);
+    }
+}
+
+// shapes go straight from their handles: an edge is one capsule, and curves are flattened at the
+// collision tolerance rather than the drawing's, one capsule per chord
+static void compileShapeCollision(const Stroke& stroke, std::vector<CollisionCapsule>& out, float tolerance){
+    float radius = stroke.thickness / 2.f;
+    std::vector<sf::Vector2f> outline;
+    flattenShape(stroke.shape, stroke.handles, outline, tolerance);
+    if (outline.size() == 1)
+        out.push_back({outline[0], outline[0], radius});
+    for (std::size_t i = 1; i < outline.size(); i++)
+        out.push_back({outline[i - 1], outline[i], radius});
+}
+
+void compileCollision(const Stroke& stroke, std::vector<CollisionCapsule>& out, float tolerance){
+    if (stroke.stamp == BrushStamp::Fill){
+        compileFillCollision(stroke, out);
+        return;
+    }
+    if (stroke.shape != StrokeShape::Freehand && isValidShape(stroke.shape, stroke.handles.size())){
+        compileShapeCollision(stroke, out, tolerance);
+        return;
+    }
+    const auto& pts = stroke.points;
+    float radius = stroke.thickness / 2.f;
+    if (pts.empty())
+        return;
+    if (pts.size() == 1){
+        out.push_back({pts[0], pts[0], radius});
+        return;
+    }
+    // Ramer-Douglas-Peucker against segments rather than lines, so a stroke that doubles back on
+    // itself keeps its turning point and both legs get a capsule
+    std::vector<bool> kept(pts.size(), false);
+    kept.front() = kept.back() = true;
+    std::vector<std::pair<std::size_t, std::size_t>> stack{{0, pts.size() - 1}};
+    while (!stack.empty()){
+        auto [first, last] = stack.back();
+        stack.pop_back();
+        float farthest = 0.f;
+        std::size_t index = first;
+        for (std::size_t i = first + 1; i < last; i++){
+            float distance = distanceToSegment(pts[i], pts[first], pts[last]);
+            if (distance > farthest){
+                farthest = distance;
+                index = i;
+            }
+        }
+        if (farthest > tolerance){
+            kept[index] = true;
+            stack.push_back({first, index});
+            stack.push_back({index, last});
+        }
+    }
+    std::size_t start = 0;
+    for (std::size_t i = 1; i < pts.size(); i++){
+        if (!kept[i])
+            continue;
+        out.push_back({pts[start], pts[i], radius});
+        start = i;
+    }
+}
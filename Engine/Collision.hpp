@@ -0,0 +1,16 @@
+#pragma once
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+
+struct Stroke;
+
+// a drawn segment as the physics sees it: a line with round ends
+struct CollisionCapsule {
+    sf::Vector2f a;
+    sf::Vector2f b;
+    float radius;
+};
+
+// compiles a stroke into capsules, merging runs of nearly collinear segments. bucket fills
+// become rows of capsules across the filled area, and shapes a capsule per edge (see Shape.hpp)
+void compileCollision(const Stroke& stroke, std::vector<CollisionCapsule>& out, float tolerance = 0.5f);
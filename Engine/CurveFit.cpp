@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cmath>
+
+#include "CurveFit.hpp"
+
+#define CURVE_REPARAMETERIZE_ITERATIONS 4
+
+namespace {
+    float dot(sf::Vector2f a, sf::Vector2f b){
+        return a.x * b.x + a.y * b.y;
+    }
+
+    sf::Vector2f normalize(sf::Vector2f v){
+        float length = std::sqrt(dot(v, v));
+        return length > 1e-6f ? v / length : sf::Vector2f();
+    }
+
+    // first and second derivatives of the cubic at t
+    sf::Vector2f cubicPrime(sf::Vector2f p0, sf::Vector2f c1, sf::Vector2f c2, sf::Vector2f p3, float t){
+        float s = 1.f - t;
+        return (c1 - p0) * (3.f * s * s) + (c2 - c1) * (6.f * s * t) + (p3 - c2) * (3.f * t * t);
+    }
+
+    sf::Vector2f cubicSecond(sf::Vector2f p0, sf::Vector2f c1, sf::Vector2f c2, sf::Vector2f p3, float t){
+        return (c2 - c1 * 2.f + p0) * (6.f * (1.f - t)) + (p3 - c2 * 2.f + c1) * (6.f * t);
+    }
+
+    void flattenSegment(sf::Vector2f p0, sf::Vector2f c1, sf::Vector2f c2, sf::Vector2f p3, float tolerance, int depth, std::vector<sf::Vector2f>& out){
+        // the curve stays inside the hull of its control points, so it's flat enough once both
+        // handles are within the tolerance of the chord
+        sf::Vector2f chord = p3 - p0;
+        float length = std::sqrt(dot(chord, chord));
+        float d1, d2;
+        if (length > 1e-6f){
+            d1 = std::abs(chord.x * (c1.y - p0.y) - chord.y * (c1.x - p0.x)) / length;
+            d2 = std::abs(chord.x * (c2.y - p0.y) - chord.y * (c2.x - p0.x)) / length;
+        } else {
+            d1 = std::sqrt(dot(c1 - p0, c1 - p0));
+            d2 = std::sqrt(dot(c2 - p0, c2 - p0));
+        }
+        if (depth >= 16 || std::max(d1, d2) <= tolerance){
+            out.push_back(p3);
+            return;
+        }
+        // split in half (de Casteljau)
+        sf::Vector2f a = (p0 + c1) * 0.5f;
+        sf::Vector2f b = (c1 + c2) * 0.5f;
+        sf::Vector2f c = (c2 + p3) * 0.5f;
+        sf::Vector2f ab = (a + b) * 0.5f;
+        sf::Vector2f bc = (b + c) * 0.5f;
+        sf::Vector2f mid = (ab + bc) * 0.5f;
+        flattenSegment(p0, a, ab, mid, tolerance, depth + 1, out);
+        flattenSegment(mid, bc, c, p3, tolerance, depth + 1, out);
+    }
+}
+
+sf::Vector2f evaluateCubic(sf::Vector2f p0, sf::Vector2f c1, sf::Vector2f c2, sf::Vector2f p3, float t){
+    float s = 1.f - t;
+    return p0 * (s * s * s) + c1 * (3.f * s * s * t) + c2 * (3.f * s * t * t) + p3 * (t * t * t);
+}
+
+void flattenCurve(const std::vector<sf::Vector2f>& curve, std::vector<sf::Vector2f>& out, float tolerance){
+    if (curve.size() < 4)
+        return;
+    out.push_back(curve[0]);
+    for (std::size_t i = 0; i + 3 < curve.size(); i += 3)
+        flattenSegment(curve[i], curve[i + 1], curve[i + 2], curve[i + 3], tolerance, 0, out);
+}
+
+void CurveFitter::begin(sf::Vector2f pos){
+    m_points.clear();
+    m_curve.clear();
+    m_points.push_back(pos);
+    m_curve.push_back(pos);
+    m_startTangent = sf::Vector2f();
+    m_open = Fit();
+}
+
+void CurveFitter::addPoint(sf::Vector2f pos){
+    if (m_points.empty()){
+        begin(pos);
+        return;
+    }
+    sf::Vector2f step = pos - m_points.back();
+    if (dot(step, step) < 1e-8f)
+        return;
+    m_points.push_back(pos);
+    std::size_t last = m_points.size() - 1;
+    Fit next = last < CURVE_MAX_SEGMENT_POINTS ? fit(0, last) : Fit();
+    if (next.valid && next.error <= m_tolerance * m_tolerance){
+        m_open = next;
+        return;
+    }
+    // the open segment ended one point ago, continue from there with only the newest point
+    commit(m_open, last - 1);
+    m_open = fit(0, 1);
+}
+
+std::vector<sf::Vector2f> CurveFitter::finish(){
+    if (m_points.size() >= 2)
+        commit(m_open, m_points.size() - 1);
+    std::vector<sf::Vector2f> curve;
+    if (m_curve.size() >= 4)
+        curve.swap(m_curve);
+    m_curve.clear();
+    m_points.clear();
+    return curve;
+}
+
+void CurveFitter::commit(const Fit& fit, std::size_t last){
+    m_curve.push_back(fit.c1);
+    m_curve.push_back(fit.c2);
+    m_curve.push_back(m_points[last]);
+    // the next segment leaves the anchor the way this one arrived, so the joint has no corner
+    m_startTangent = normalize(m_points[last] - fit.c2);
+    if (m_startTangent == sf::Vector2f())
+        m_startTangent = normalize(m_points[last] - m_points[last - 1]);
+    m_points.erase(m_points.begin(), m_points.begin() + last);
+}
+
+CurveFitter::Fit CurveFitter::fit(std::size_t first, std::size_t last) const {
+    Fit result;
+    sf::Vector2f p0 = m_points[first];
+    sf::Vector2f p3 = m_points[last];
+    float chordLength = std::sqrt(dot(p3 - p0, p3 - p0));
+
+    // end tangents, estimated a couple of points in to ride over jitter
+    sf::Vector2f t1 = m_startTangent;
+    if (t1 == sf::Vector2f())
+        t1 = normalize(m_points[std::min(first + 2, last)] - p0);
+    sf::Vector2f t2 = normalize(m_points[last >= first + 2 ? last - 2 : first] - p3);
+    if (t1 == sf::Vector2f())
+        t1 = normalize(p3 - p0);
+    if (t2 == sf::Vector2f())
+        t2 = normalize(p0 - p3);
+
+    if (last - first < 2){
+        result.c1 = p0 + t1 * (chordLength / 3.f);
+        result.c2 = p3 + t2 * (chordLength / 3.f);
+        result.valid = true;
+        return result;
+    }
+
+    // chord length parameterization
+    std::vector<float>& u = m_params;
+    u.assign(last - first + 1, 0.f);
+    for (std::size_t i = first + 1; i <= last; i++){
+        sf::Vector2f d = m_points[i] - m_points[i - 1];
+        u[i - first] = u[i - first - 1] + std::sqrt(dot(d, d));
+    }
+    if (u.back() <= 0.f)
+        return result;
+    for (float& value : u)
+        value /= u.back();
+
+    for (int iteration = 0; ; iteration++){
+        // least squares handle lengths along the fixed tangents
+        float c00 = 0.f, c01 = 0.f, c11 = 0.f, x0 = 0.f, x1 = 0.f;
+        for (std::size_t i = 0; i < u.size(); i++){
+            float t = u[i], s = 1.f - t;
+            float b0 = s * s * s, b1 = 3.f * s * s * t, b2 = 3.f * s * t * t, b3 = t * t * t;
+            sf::Vector2f a1 = t1 * b1;
+            sf::Vector2f a2 = t2 * b2;
+            sf::Vector2f rest = m_points[first + i] - (p0 * (b0 + b1) + p3 * (b2 + b3));
+            c00 += dot(a1, a1);
+            c01 += dot(a1, a2);
+            c11 += dot(a2, a2);
+            x0 += dot(a1, rest);
+            x1 += dot(a2, rest);
+        }
+        float det = c00 * c11 - c01 * c01;
+        float alpha1 = 0.f, alpha2 = 0.f;
+        if (std::abs(det) > 1e-12f){
+            alpha1 = (x0 * c11 - x1 * c01) / det;
+            alpha2 = (c00 * x1 - c01 * x0) / det;
+        }
+        // degenerate or backwards handles, fall back to the Wu/Barsky heuristic
+        float epsilon = 1e-6f * chordLength;
+        if (alpha1 < epsilon || alpha2 < epsilon || alpha1 > chordLength * 2.f || alpha2 > chordLength * 2.f)
+            alpha1 = alpha2 = chordLength / 3.f;
+        result.c1 = p0 + t1 * alpha1;
+        result.c2 = p3 + t2 * alpha2;
+        result.valid = true;
+
+        result.error = 0.f;
+        for (std::size_t i = 1; i + 1 < u.size(); i++){
+            sf::Vector2f d = evaluateCubic(p0, result.c1, result.c2, p3, u[i]) - m_points[first + i];
+            result.error = std::max(result.error, dot(d, d));
+        }
+        // close misses get a few Newton steps on the parameters, far ones aren't worth it
+        float tolerance = m_tolerance * m_tolerance;
+        if (result.error <= tolerance || result.error > tolerance * 16.f || iteration == CURVE_REPARAMETERIZE_ITERATIONS)
+            return result;
+        for (std::size_t i = 1; i + 1 < u.size(); i++){
+            sf::Vector2f d = evaluateCubic(p0, result.c1, result.c2, p3, u[i]) - m_points[first + i];
+            sf::Vector2f prime = cubicPrime(p0, result.c1, result.c2, p3, u[i]);
+            sf::Vector2f second = cubicSecond(p0, result.c1, result.c2, p3, u[i]);
+            float denominator = dot(prime, prime) + dot(d, second);
+            if (std::abs(denominator) > 1e-12f)
+                u[i] = std::clamp(u[i] - dot(d, prime) / denominator, 0.f, 1.f);
+        }
+    }
+}
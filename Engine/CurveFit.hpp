@@ -0,0 +1,48 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <vector>
+
+// fits a growing polyline with cubic Béziers (Schneider, "An Algorithm for Automatically Fitting
+// Digitized Curves"), one segment at a time: the open segment is refit to the points since the
+// last anchor on every new point, and when it no longer fits within the tolerance the last good
+// fit is kept and a new segment starts there, continuing its tangent. the work per point is
+// bounded by CURVE_MAX_SEGMENT_POINTS, so it keeps up with drawing.
+// curves are stored as control points: anchor, handle, handle, anchor, handle, handle, anchor...
+#define CURVE_MAX_SEGMENT_POINTS 128
+
+class CurveFitter {
+public:
+    explicit CurveFitter(float tolerance = 1.f) : m_tolerance(tolerance) {}
+
+    void begin(sf::Vector2f pos);
+    void addPoint(sf::Vector2f pos);
+    // closes the open segment and hands over the control points, empty for fewer than two points
+    std::vector<sf::Vector2f> finish();
+
+    const std::vector<sf::Vector2f>& getControlPoints() const { return m_curve; } // closed segments so far
+    float getTolerance() const { return m_tolerance; }
+
+private:
+    struct Fit {
+        sf::Vector2f c1;
+        sf::Vector2f c2;
+        float error = 0.f; // largest squared distance of a point from the curve
+        bool valid = false;
+    };
+
+    Fit fit(std::size_t first, std::size_t last) const;
+    void commit(const Fit& fit, std::size_t last);
+
+    float m_tolerance;
+    std::vector<sf::Vector2f> m_points; // since the anchor, the anchor first
+    std::vector<sf::Vector2f> m_curve;
+    sf::Vector2f m_startTangent;        // zero at the start of the stroke
+    Fit m_open;                          // fit of all of m_points
+    mutable std::vector<float> m_params; // scratch for fit()
+};
+
+sf::Vector2f evaluateCubic(sf::Vector2f p0, sf::Vector2f c1, sf::Vector2f c2, sf::Vector2f p3, float t);
+// appends points along the curve, close enough that the polyline strays at most tolerance from
+// it. the first anchor is included, and nothing depends on anything but the control points
+void flattenCurve(const std::vector<sf::Vector2f>& curve, std::vector<sf::Vector2f>& out, float tolerance = 0.25f);
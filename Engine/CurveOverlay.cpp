@@ -0,0 +1,52 @@
+#include <SFML/Graphics.hpp>
+
+#include "CurveOverlay.hpp"
+
+#define OVERLAY_CURVE_COLOR sf::Color(230, 60, 160)
+#define OVERLAY_LIVE_COLOR sf::Color(60, 160, 230)
+
+sw::Spline CurveOverlay::makeSpline(const std::vector<sf::Vector2f>& curve, sf::Color color){
+    // one spline vertex per anchor, the handles either side of it are offsets from it
+    std::size_t anchors = curve.size() / 3 + 1;
+    sw::Spline spline(anchors);
+    for (std::size_t i = 0; i < anchors; i++){
+        std::size_t at = i * 3;
+        spline[i].position = curve[at];
+        if (at + 1 < curve.size())
+            spline[i].frontHandle = curve[at + 1] - curve[at];
+        if (at > 0)
+            spline[i].backHandle = curve[at - 1] - curve[at];
+    }
+    spline.setBezierInterpolation(true);
+    spline.setInterpolationSteps(8);
+    spline.setHandlesVisible(true);
+    spline.setThickness(1.5f);
+    spline.setThickStartCapType(sw::Spline::ThickCapType::Round);
+    spline.setThickEndCapType(sw::Spline::ThickCapType::Round);
+    spline.setColor(color);
+    spline.update();
+    return spline;
+}
+
+void CurveOverlay::setStrokes(const std::vector<Stroke>& strokes){
+    m_splines.clear();
+    for (const auto& stroke : strokes)
+        if (stroke.curve.size() >= 4)
+            m_splines.push_back(makeSpline(stroke.curve, OVERLAY_CURVE_COLOR));
+}
+
+void CurveOverlay::setLiveCurve(const std::vector<sf::Vector2f>& curve){
+    if (curve.size() == m_liveSize)
+        return; // segments are only ever appended while drawing
+    m_liveSize = curve.size();
+    m_live = curve.size() >= 4 ? makeSpline(curve, OVERLAY_LIVE_COLOR) : sw::Spline();
+}
+
+void CurveOverlay::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    if (!m_visible)
+        return;
+    for (const auto& spline : m_splines)
+        target.draw(spline, states);
+    if (m_liveSize >= 4)
+        target.draw(m_live, states);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <SelbaWard.hpp>
+#include <vector>
+
+#include "Stroke.hpp"
+
+// the Bézier curves fitted strokes were flattened from, as sw::Splines with their handles showing,
+// over the canvas. strokes that weren't fitted don't show up
+class CurveOverlay : public sf::Drawable {
+public:
+    void toggle(){ m_visible = !m_visible; }
+    bool isVisible() const { return m_visible; }
+
+    void setStrokes(const std::vector<Stroke>& strokes); // rebuilds every spline
+    void setLiveCurve(const std::vector<sf::Vector2f>& curve); // the stroke being drawn, empty for none
+
+private:
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+    static sw::Spline makeSpline(const std::vector<sf::Vector2f>& curve, sf::Color color);
+
+    bool m_visible = false;
+    std::vector<sw::Spline> m_splines;
+    sw::Spline m_live;
+    std::size_t m_liveSize = 0; // control points m_live was built from
+};
@@ -0,0 +1,44 @@
+#include "Downsample.hpp"
+#include "Simd.hpp"
+
+// the four pixels summed and rounded once, so repeated halvings don't drift lighter
+static inline unsigned int average(unsigned int a, unsigned int b, unsigned int c, unsigned int d){
+    return (a + b + c + d + 2) >> 2;
+}
+
+#ifdef PIZARRA_SSE2
+// 4 source pixels from each row become 2, widened to 16 bits so the sum can't overflow
+static inline __m128i averageQuads(const std::uint8_t* top, const std::uint8_t* bottom){
+    const __m128i zero = _mm_setzero_si128();
+    __m128i t = _mm_loadu_si128((const __m128i*)top);
+    __m128i b = _mm_loadu_si128((const __m128i*)bottom);
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(t, zero), _mm_unpacklo_epi8(b, zero)); // pixels 0 and 1
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(t, zero), _mm_unpackhi_epi8(b, zero)); // pixels 2 and 3
+    // even pixels in one register, odd in the other, then each pixel plus its right hand neighbour
+    __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+#endif
+
+void downsampleHalf(const std::uint8_t* src, unsigned int width, unsigned int height, std::uint8_t* dst){
+    unsigned int outWidth = width / 2;
+    std::size_t srcStride = (std::size_t)width * 4;
+    for (unsigned int y = 0; y < height / 2; y++){
+        const std::uint8_t* top = src + (std::size_t)y * 2 * srcStride;
+        const std::uint8_t* bottom = top + srcStride;
+        std::uint8_t* out = dst + (std::size_t)y * outWidth * 4;
+        unsigned int x = 0;
+#ifdef PIZARRA_SSE2
+        // 8 source pixels across two rows become 4
+        for (; x + 4 <= outWidth; x += 4){
+            __m128i left = averageQuads(top + x * 8, bottom + x * 8);
+            __m128i right = averageQuads(top + x * 8 + 16, bottom + x * 8 + 16);
+            _mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(left, right));
+        }
+#endif
+        for (; x < outWidth; x++){
+            for (int c = 0; c < 4; c++)
+                out[x * 4 + c] = (std::uint8_t)average(top[x * 8 + c], top[x * 8 + 4 + c], bottom[x * 8 + c], bottom[x * 8 + 4 + c]);
+        }
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// halves an RGBA8 image with a 2x2 box filter: dst is (width / 2) x (height / 2), rows tightly
+// packed. width and height must be even. uses SSE2 where the compiler targets it, four output
+// pixels per step, and plain loops elsewhere; both round the same way
+void downsampleHalf(const std::uint8_t* src, unsigned int width, unsigned int height, std::uint8_t* dst);
@@ -7,6 +7,7 @@
 #include "../gfx/mario.h"
 
 #include "Engine.hpp"
+#include "RenderStats.hpp"
 
 Mario::Mario(){
     
@@ -46,5 +47,5 @@ Mario::Mario(){
 }
 void Mario::render(sf::RenderWindow& window){
     sprite.set(clock.getElapsedTime().asMilliseconds() / 250 % 23 + 1); // sets exhibit based on clock, which cycles through exhibits
-    window.draw(sprite);
+    CountingTarget(window).draw(sprite);
 }
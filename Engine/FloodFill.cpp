@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cstring>
+
+#include "FloodFill.hpp"
+#include "Simd.hpp"
+
+// compares pixels against the seed colour, every channel within the tolerance
+struct RgbaMatcher {
+    static const int stride = 4; // bytes per pixel
+    std::uint8_t seed[4];
+    int tolerance;
+#ifdef PIZARRA_SSE2
+    __m128i seed4;
+    __m128i tolerance4;
+#endif
+
+    RgbaMatcher(const std::uint8_t* color, int tolerance) : tolerance(tolerance) {
+        std::memcpy(seed, color, 4);
+#ifdef PIZARRA_SSE2
+        std::uint32_t packed;
+        std::memcpy(&packed, color, 4);
+        seed4 = _mm_set1_epi32((int)packed);
+        tolerance4 = _mm_set1_epi8((char)(std::uint8_t)std::clamp(tolerance, 0, 255));
+#endif
+    }
+
+    bool match(const std::uint8_t* p) const {
+        for (int c = 0; c < 4; c++){
+            int d = (int)p[c] - seed[c];
+            if (d > tolerance || -d > tolerance)
+                return false;
+        }
+        return true;
+    }
+
+    // bit i set when pixel i of the 4 at p matches
+    int match4(const std::uint8_t* p) const {
+#ifdef PIZARRA_SSE2
+        __m128i pixels = _mm_loadu_si128((const __m128i*)p);
+        __m128i difference = _mm_or_si128(_mm_subs_epu8(pixels, seed4), _mm_subs_epu8(seed4, pixels));
+        __m128i over = _mm_subs_epu8(difference, tolerance4); // non zero where a channel is out
+        return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(over, _mm_setzero_si128())));
+#else
+        return (int)match(p) | (int)match(p + 4) << 1 | (int)match(p + 8) << 2 | (int)match(p + 12) << 3;
+#endif
+    }
+
+    // first x in [x, limit) whose match differs from want, or limit
+    int findRight(const std::uint8_t* row, int x, int limit, bool want) const {
+        int all = want ? 0xF : 0;
+        for (; x + 4 <= limit; x += 4){
+            int mask = match4(row + x * 4) ^ all; // set where it differs from want
+            if (mask){
+                while (!(mask & 1)){
+                    mask >>= 1;
+                    x++;
+                }
+                return x;
+            }
+        }
+        for (; x < limit; x++)
+            if (match(row + x * 4) != want)
+                return x;
+        return limit;
+    }
+
+    // the start of the matching run that ends at x (which matches)
+    int findLeft(const std::uint8_t* row, int x) const {
+        while (x >= 4){
+            int mask = match4(row + (x - 4) * 4);
+            if (mask != 0xF){
+                int bit = 3;
+                while (mask & (1 << bit))
+                    bit--;
+                return x - 4 + bit + 1;
+            }
+            x -= 4;
+        }
+        while (x > 0 && match(row + (x - 1) * 4))
+            x--;
+        return x;
+    }
+};
+
+// palette indices equal to the seed's, 16 per compare
+struct IndexMatcher {
+    static const int stride = 1;
+    std::uint8_t seed;
+#ifdef PIZARRA_SSE2
+    __m128i seed16;
+#endif
+
+    explicit IndexMatcher(std::uint8_t index) : seed(index) {
+#ifdef PIZARRA_SSE2
+        seed16 = _mm_set1_epi8((char)index);
+#endif
+    }
+
+    int findRight(const std::uint8_t* row, int x, int limit, bool want) const {
+#ifdef PIZARRA_SSE2
+        int all = want ? 0xFFFF : 0;
+        for (; x + 16 <= limit; x += 16){
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(row + x)), seed16)) ^ all;
+            if (mask){
+                while (!(mask & 1)){
+                    mask >>= 1;
+                    x++;
+                }
+                return x;
+            }
+        }
+#endif
+        for (; x < limit; x++)
+            if ((row[x] == seed) != want)
+                return x;
+        return limit;
+    }
+
+    int findLeft(const std::uint8_t* row, int x) const {
+#ifdef PIZARRA_SSE2
+        while (x >= 16){
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(row + x - 16)), seed16));
+            if (mask != 0xFFFF){
+                int bit = 15;
+                while (mask & (1 << bit))
+                    bit--;
+                return x - 16 + bit + 1;
+            }
+            x -= 16;
+        }
+#endif
+        while (x > 0 && row[x - 1] == seed)
+            x--;
+        return x;
+    }
+};
+
+bool FloodFill::fill(const std::uint8_t* pixels, sf::Vector2u size, sf::Vector2u seed, int tolerance){
+    m_spans.clear();
+    m_pixelCount = 0;
+    m_bounds = sf::IntRect();
+    if (seed.x >= size.x || seed.y >= size.y)
+        return false;
+    m_width = (int)size.x;
+    m_height = (int)size.y;
+    flood(RgbaMatcher(pixels + ((std::size_t)seed.y * m_width + seed.x) * 4, tolerance), pixels, seed);
+    return true;
+}
+
+bool FloodFill::fillIndexed(const std::uint8_t* indices, sf::Vector2u size, sf::Vector2u seed){
+    m_spans.clear();
+    m_pixelCount = 0;
+    m_bounds = sf::IntRect();
+    if (seed.x >= size.x || seed.y >= size.y)
+        return false;
+    m_width = (int)size.x;
+    m_height = (int)size.y;
+    flood(IndexMatcher(indices[(std::size_t)seed.y * m_width + seed.x]), indices, seed);
+    return true;
+}
+
+template <typename Matcher>
+void FloodFill::flood(const Matcher& matcher, const std::uint8_t* pixels, sf::Vector2u seed){
+    m_stack.clear();
+    m_visited.assign((std::size_t)m_width * m_height, 0);
+    int minX = m_width, minY = m_height, maxX = 0, maxY = 0;
+    m_stack.push_back({(int)seed.x, (int)seed.x + 1, (int)seed.y, 1, 1, 0});
+    while (!m_stack.empty()){
+        Seed s = m_stack.back();
+        m_stack.pop_back();
+        std::uint8_t* visited = &m_visited[(std::size_t)s.y * m_width];
+        if (visited[s.x0])
+            continue; // a run is always filled whole, so this one is done
+        const std::uint8_t* row = pixels + (std::size_t)s.y * m_width * Matcher::stride;
+        int x0 = matcher.findLeft(row, s.x0);
+        int x1 = matcher.findRight(row, s.x1, m_width, true);
+        std::memset(visited + x0, 1, x1 - x0);
+        m_spans.push_back({s.y, x0, x1});
+        m_pixelCount += x1 - x0;
+        minX = std::min(minX, x0);
+        maxX = std::max(maxX, x1);
+        minY = std::min(minY, s.y);
+        maxY = std::max(maxY, s.y + 1);
+
+        scanRow(matcher, pixels, s.y + s.dy, x0, x1, s.dy, x0, x1);
+        // back towards the parent, whose own span is already filled
+        if (s.parentX0 >= s.parentX1){
+            scanRow(matcher, pixels, s.y - s.dy, x0, x1, -s.dy, x0, x1);
+        } else {
+            scanRow(matcher, pixels, s.y - s.dy, x0, std::min(s.parentX0, x1), -s.dy, x0, x1);
+            scanRow(matcher, pixels, s.y - s.dy, std::max(s.parentX1, x0), x1, -s.dy, x0, x1);
+        }
+    }
+    std::sort(m_spans.begin(), m_spans.end(), [](const FillSpan& a, const FillSpan& b){ return a.y != b.y ? a.y < b.y : a.x0 < b.x0; });
+    m_bounds = sf::IntRect({minX, minY}, {maxX - minX, maxY - minY});
+}
+
+// seeds each matching run of row y within [x0, x1) that isn't filled yet
+template <typename Matcher>
+void FloodFill::scanRow(const Matcher& matcher, const std::uint8_t* pixels, int y, int x0, int x1, int dy, int parentX0, int parentX1){
+    if (y < 0 || y >= m_height || x0 >= x1)
+        return;
+    const std::uint8_t* row = pixels + (std::size_t)y * m_width * Matcher::stride;
+    const std::uint8_t* visited = &m_visited[(std::size_t)y * m_width];
+    int x = x0;
+    while (x < x1){
+        x = matcher.findRight(row, x, x1, false);
+        if (x >= x1)
+            break;
+        int end = matcher.findRight(row, x, x1, true);
+        if (!visited[x])
+            m_stack.push_back({x, end, y, dy, parentX0, parentX1});
+        x = end;
+    }
+}
+
+void FloodFill::getRects(std::vector<sf::Vector2f>& out, sf::Vector2f offset) const {
+    struct Rect {
+        int x0, x1, y0, y1;
+    };
+    std::vector<Rect> open, next, closed;
+    std::size_t i = 0;
+    while (i < m_spans.size()){
+        int y = m_spans[i].y;
+        // spans and open rects are both sorted by x, so equal ones line up in one pass
+        std::size_t o = 0;
+        next.clear();
+        for (; i < m_spans.size() && m_spans[i].y == y; i++){
+            const FillSpan& span = m_spans[i];
+            while (o < open.size() && (open[o].x0 < span.x0 || open[o].y1 != y)){
+                closed.push_back(open[o]);
+                o++;
+            }
+            if (o < open.size() && open[o].x0 == span.x0 && open[o].x1 == span.x1){
+                next.push_back(open[o]);
+                next.back().y1 = y + 1;
+                o++;
+            } else {
+                next.push_back({span.x0, span.x1, y, y + 1});
+            }
+        }
+        closed.insert(closed.end(), open.begin() + o, open.end());
+        open.swap(next);
+    }
+    closed.insert(closed.end(), open.begin(), open.end());
+    std::sort(closed.begin(), closed.end(), [](const Rect& a, const Rect& b){ return a.y0 != b.y0 ? a.y0 < b.y0 : a.x0 < b.x0; });
+    out.reserve(out.size() + closed.size() * 2);
+    for (const Rect& r : closed){
+        out.push_back(sf::Vector2f((float)r.x0, (float)r.y0) + offset);
+        out.push_back(sf::Vector2f((float)r.x1, (float)r.y1) + offset);
+    }
+}
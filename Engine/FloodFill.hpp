@@ -0,0 +1,58 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// a run of filled pixels [x0, x1) on row y
+struct FillSpan {
+    int y;
+    int x0;
+    int x1;
+};
+
+// span based scanline flood fill over RGBA8 pixels, 4-connected. each visit fills a whole run, seeds
+// one entry per matching run on the next row, and only looks back at the row it came from where
+// the run sticks out past its parent, so most pixels are compared once or twice. runs are found
+// 4 RGBA pixels, or 16 palette indices, per compare with SSE2 where the compiler targets it. nothing is written to the image;
+// the result is the spans, so the caller decides what to draw and upload. the scratch buffers
+// are kept between fills
+class FloodFill {
+public:
+    // pixels within tolerance of the seed's colour on every channel are part of the region.
+    // false when the seed is outside the image
+    bool fill(const std::uint8_t* pixels, sf::Vector2u size, sf::Vector2u seed, int tolerance = 0);
+    // the same over one palette index per pixel, where the region is the seed's index exactly
+    bool fillIndexed(const std::uint8_t* indices, sf::Vector2u size, sf::Vector2u seed);
+
+    const std::vector<FillSpan>& getSpans() const { return m_spans; } // by row, then x
+    sf::IntRect getBounds() const { return m_bounds; }
+    std::size_t getPixelCount() const { return m_pixelCount; }
+
+    // the spans merged into as few rectangles as stacking equal spans gives, appended as pairs of
+    // opposite corners (the points of a BrushStamp::Fill stroke), ordered by top then left
+    void getRects(std::vector<sf::Vector2f>& out, sf::Vector2f offset = {0.f, 0.f}) const;
+
+private:
+    struct Seed {
+        int x0;       // [x0, x1) on row y is known to match
+        int x1;
+        int y;
+        int dy;       // direction away from the parent span
+        int parentX0; // the parent's extent on row y - dy, empty for the first seed
+        int parentX1;
+    };
+
+    template <typename Matcher>
+    void flood(const Matcher& matcher, const std::uint8_t* pixels, sf::Vector2u seed);
+    template <typename Matcher>
+    void scanRow(const Matcher& matcher, const std::uint8_t* pixels, int y, int x0, int x1, int dy, int parentX0, int parentX1);
+
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<std::uint8_t> m_visited; // one byte per pixel, whole runs are marked at once
+    std::vector<Seed> m_stack;
+    std::vector<FillSpan> m_spans;
+    sf::IntRect m_bounds;
+    std::size_t m_pixelCount = 0;
+};
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationStats.hpp"
+#include "FrameArena.hpp"
+#include "Profiler.hpp"
+
+static FrameArena::Stats s_lastFrame;
+static std::uint64_t s_lastHeapCount = 0;
+
+FrameArena::FrameArena(std::size_t capacity)
+    : m_memory(new unsigned char[capacity]), m_capacity(capacity)
+{
+    m_stats.capacity = capacity;
+}
+
+void* FrameArena::allocate(std::size_t bytes, std::size_t alignment){
+    std::size_t start = (m_top + alignment - 1) & ~(alignment - 1);
+    if (start + bytes <= m_capacity){
+        m_top = start + bytes;
+        m_stats.used = std::max(m_stats.used, m_top);
+        return m_memory.get() + start;
+    }
+    m_stats.fallbacks++;
+    m_overflow += bytes + alignment;
+    if (alignment > alignof(std::max_align_t))
+        throw std::bad_alloc(); // nothing in the frame data needs more than that
+    return ::operator new(bytes);
+}
+
+void FrameArena::deallocate(void* p, std::size_t bytes){
+    if (!owns(p)){
+        ::operator delete(p);
+        return;
+    }
+    // a vector growing in place frees the block it just outgrew, which is usually the last one
+    unsigned char* block = static_cast<unsigned char*>(p);
+    if (block + bytes == m_memory.get() + m_top)
+        m_top = block - m_memory.get();
+}
+
+void FrameArena::reset(){
+    if (m_overflow > 0){
+        // grow while nothing points into the arena, so the next frame like this one fits
+        m_capacity = std::max(m_capacity * 2, m_stats.used + m_overflow);
+        m_memory.reset(new unsigned char[m_capacity]);
+    }
+    m_top = 0;
+    m_overflow = 0;
+    m_stats = Stats();
+    m_stats.capacity = m_capacity;
+}
+
+FrameArena& FrameArena::get(){
+    static FrameArena arena;
+    return arena;
+}
+
+void FrameArena::endFrame(){
+    FrameArena& arena = get();
+    std::uint64_t heapCount = AllocationStats::getCount();
+    arena.m_stats.heapAllocations = heapCount - s_lastHeapCount;
+    s_lastHeapCount = heapCount;
+    s_lastFrame = arena.m_stats;
+    PROFILE_COUNTER("arena bytes", s_lastFrame.used);
+    PROFILE_COUNTER("arena fallbacks", s_lastFrame.fallbacks);
+    PROFILE_COUNTER("heap allocations", s_lastFrame.heapAllocations);
+    arena.reset();
+}
+
+const FrameArena::Stats& FrameArena::getLastFrameStats(){
+    return s_lastFrame;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// bump allocator for data that only lives until the end of the frame. allocating is a pointer
+// bump, freeing only rolls back the most recent block, and reset() drops everything at once.
+// when a frame needs more than the capacity the rest comes from the heap (counted as fallbacks)
+// and the next reset grows the block, so a steady frame settles at zero heap allocations
+class FrameArena {
+public:
+    struct Stats {
+        std::size_t used = 0;      // bytes handed out this frame
+        std::size_t capacity = 0;
+        std::uint32_t fallbacks = 0; // allocations that didn't fit and went to the heap
+        std::uint64_t heapAllocations = 0; // everything that called operator new during the frame
+    };
+
+    explicit FrameArena(std::size_t capacity = 1 << 20);
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(std::size_t bytes, std::size_t alignment);
+    void deallocate(void* p, std::size_t bytes);
+    // nothing allocated from the arena may be used after this
+    void reset();
+
+    const Stats& getStats() const { return m_stats; }
+
+    // the arena of the thread running the frame loop, and its end of frame hook: resets it and
+    // publishes arena and heap counters to the profiler
+    static FrameArena& get();
+    static void endFrame();
+    static const Stats& getLastFrameStats();
+
+private:
+    bool owns(const void* p) const { return p >= m_memory.get() && p < m_memory.get() + m_capacity; }
+
+    std::unique_ptr<unsigned char[]> m_memory;
+    std::size_t m_capacity;
+    std::size_t m_top = 0;
+    std::size_t m_overflow = 0; // bytes that fell back to the heap this frame
+    Stats m_stats;
+};
+
+// allocator so standard containers can live in a frame arena
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() : m_arena(&FrameArena::get()) {}
+    explicit ArenaAllocator(FrameArena& arena) : m_arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.getArena()) {}
+
+    T* allocate(std::size_t n){ return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, std::size_t n){ m_arena->deallocate(p, n * sizeof(T)); }
+
+    FrameArena* getArena() const { return m_arena; }
+
+private:
+    FrameArena* m_arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b){ return a.getArena() == b.getArena(); }
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b){ return a.getArena() != b.getArena(); }
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,391 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+
+#include "Brush.hpp"
+#include "CurveFit.hpp"
+#include "History.hpp"
+#include "RenderStats.hpp"
+#include "Shape.hpp"
+
+std::size_t HistoryOp::getMemoryUsage() const {
+    std::size_t bytes = sizeof(HistoryOp) + strokes.capacity() * sizeof(Stroke) + indices.capacity() * sizeof(std::uint32_t);
+    for (const auto& stroke : strokes)
+        bytes += stroke.points.capacity() * sizeof(sf::Vector2f) + stroke.widths.capacity() + stroke.alphas.capacity()
+            + (stroke.curve.capacity() + stroke.handles.capacity()) * sizeof(sf::Vector2f);
+    return bytes;
+}
+
+History::History(std::size_t memoryBudget, const std::string& spillDir)
+    : m_memoryBudget(memoryBudget), m_spillDir(spillDir)
+{
+}
+
+History::~History(){
+    std::error_code ec;
+    for (const auto& segment : m_segments){
+        if (segment.spilled)
+            std::filesystem::remove(spillPath(segment), ec);
+    }
+}
+
+std::unique_ptr<sf::Texture> History::takeTexture(sf::Vector2u size){
+    for (auto it = m_texturePool.begin(); it != m_texturePool.end(); ++it){
+        if ((*it)->getSize() == size){
+            auto texture = std::move(*it);
+            m_texturePool.erase(it);
+            return texture;
+        }
+    }
+    return std::make_unique<sf::Texture>(size);
+}
+
+void History::startSegment(const sf::RenderTexture& canvas){
+    Segment segment;
+    segment.start = m_total;
+    segment.id = m_nextSegmentId++;
+    // texture to texture copy stays on the GPU
+    segment.checkpoint = takeTexture(canvas.getSize());
+    segment.checkpoint->update(canvas.getTexture());
+    m_memoryUsage += segmentBytes(segment);
+    m_segments.push_back(std::move(segment));
+}
+
+void History::reset(const sf::RenderTexture& canvas){
+    std::error_code ec;
+    for (auto& segment : m_segments){
+        if (segment.spilled)
+            std::filesystem::remove(spillPath(segment), ec);
+        else if (segment.checkpoint)
+            m_texturePool.push_back(std::move(segment.checkpoint));
+    }
+    m_segments.clear();
+    m_cursor = 0;
+    m_total = 0;
+    m_memoryUsage = 0;
+    startSegment(canvas);
+}
+
+std::size_t History::segmentBytes(const Segment& segment) const {
+    if (segment.spilled)
+        return 0;
+    std::size_t bytes = 0;
+    if (segment.checkpoint)
+        bytes += (std::size_t)segment.checkpoint->getSize().x * segment.checkpoint->getSize().y * 4;
+    for (const auto& op : segment.ops)
+        bytes += op.getMemoryUsage();
+    return bytes;
+}
+
+void History::truncateRedo(){
+    if (m_cursor == m_total)
+        return;
+    std::error_code ec;
+    while (m_segments.size() > 1 && m_segments.back().start > m_cursor){
+        Segment& segment = m_segments.back();
+        m_memoryUsage -= segmentBytes(segment);
+        if (segment.spilled)
+            std::filesystem::remove(spillPath(segment), ec);
+        else if (segment.checkpoint)
+            m_texturePool.push_back(std::move(segment.checkpoint));
+        m_segments.pop_back();
+    }
+    Segment& last = m_segments.back();
+    if (last.spilled)
+        unspill(last);
+    m_memoryUsage -= segmentBytes(last);
+    last.ops.resize(m_cursor - last.start);
+    m_memoryUsage += segmentBytes(last);
+    m_total = m_cursor;
+}
+
+void History::record(HistoryOp op, const sf::RenderTexture& canvas){
+    if (m_segments.empty()){
+        reset(canvas); // canvas already has the op applied, so history starts after it
+        return;
+    }
+    truncateRedo();
+    Segment& segment = m_segments.back();
+    if (segment.spilled)
+        unspill(segment);
+    bool additive = op.type == HistoryOp::Type::Add;
+    m_memoryUsage += op.getMemoryUsage();
+    segment.ops.push_back(std::move(op));
+    m_total++;
+    m_cursor = m_total;
+    // anything that isn't a plain add can't be replayed on top of a checkpoint cheaply, so it ends a segment
+    if (!additive || segment.ops.size() >= m_checkpointInterval)
+        startSegment(canvas);
+    enforceBudget();
+}
+
+void History::recordAdd(const Stroke& stroke, const sf::RenderTexture& canvas){
+    HistoryOp op;
+    op.type = HistoryOp::Type::Add;
+    op.strokes.push_back(stroke);
+    record(std::move(op), canvas);
+}
+
+void History::recordErase(std::vector<std::uint32_t> indices, std::vector<Stroke> erased, const sf::RenderTexture& canvas){
+    HistoryOp op;
+    op.type = HistoryOp::Type::Erase;
+    op.indices = std::move(indices);
+    op.strokes = std::move(erased);
+    record(std::move(op), canvas);
+}
+
+void History::recordClear(std::vector<Stroke> cleared, const sf::RenderTexture& canvas){
+    HistoryOp op;
+    op.type = HistoryOp::Type::Clear;
+    op.strokes = std::move(cleared);
+    record(std::move(op), canvas);
+}
+
+void History::recordReplace(std::vector<std::uint32_t> indices, std::vector<Stroke> before, std::vector<Stroke> after, const sf::RenderTexture& canvas){
+    HistoryOp op;
+    op.type = HistoryOp::Type::Replace;
+    op.indices = std::move(indices);
+    op.strokes = std::move(before);
+    op.strokes.insert(op.strokes.end(), std::make_move_iterator(after.begin()), std::make_move_iterator(after.end()));
+    record(std::move(op), canvas);
+}
+
+void History::undoStrokes(const HistoryOp& op, std::vector<Stroke>& strokes){
+    switch (op.type){
+        case HistoryOp::Type::Add:
+            if (!strokes.empty())
+                strokes.pop_back();
+            break;
+        case HistoryOp::Type::Erase:
+            // ascending, so every stroke before one is already back when it goes in
+            for (std::size_t i = 0; i < op.indices.size(); i++)
+                strokes.insert(strokes.begin() + std::min<std::size_t>(op.indices[i], strokes.size()), op.strokes[i]);
+            break;
+        case HistoryOp::Type::Clear:
+            strokes = op.strokes;
+            break;
+        case HistoryOp::Type::Replace:
+            for (std::size_t i = 0; i < op.indices.size(); i++)
+                if (op.indices[i] < strokes.size())
+                    strokes[op.indices[i]] = op.strokes[i];
+            break;
+    }
+}
+
+void History::redoStrokes(const HistoryOp& op, std::vector<Stroke>& strokes){
+    switch (op.type){
+        case HistoryOp::Type::Add:
+            strokes.push_back(op.strokes[0]);
+            break;
+        case HistoryOp::Type::Erase:
+            for (std::size_t i = op.indices.size(); i-- > 0;)
+                if (op.indices[i] < strokes.size())
+                    strokes.erase(strokes.begin() + op.indices[i]);
+            break;
+        case HistoryOp::Type::Clear:
+            strokes.clear();
+            break;
+        case HistoryOp::Type::Replace:
+            for (std::size_t i = 0; i < op.indices.size(); i++)
+                if (op.indices[i] < strokes.size())
+                    strokes[op.indices[i]] = op.strokes[op.indices.size() + i];
+            break;
+    }
+}
+
+std::size_t History::findSegment(std::size_t opIndex) const {
+    // the cursor is almost always in one of the last segments
+    for (std::size_t i = m_segments.size(); i-- > 0;){
+        if (m_segments[i].start <= opIndex)
+            return i;
+    }
+    return 0;
+}
+
+void History::restore(std::size_t segmentIndex, std::size_t opCount, sf::RenderTexture& canvas){
+    Segment& segment = m_segments[segmentIndex];
+    CountingTarget target(canvas);
+    sf::Sprite sprite(*segment.checkpoint);
+    target.draw(sprite, sf::RenderStates(sf::BlendNone));
+    FrameVector<sf::Vertex> triangles;
+    bool stamped = false;
+    for (std::size_t i = 0; i < opCount; i++){
+        for (const auto& stroke : segment.ops[i].strokes){
+            tessellateStroke(stroke, triangles); // only adds can be inside a segment
+            stamped |= stroke.stamp != BrushStamp::Solid;
+        }
+    }
+    target.draw(triangles.data(), triangles.size(), sf::PrimitiveType::Triangles, getStrokeStates(stamped));
+    canvas.display();
+}
+
+const HistoryOp* History::undo(std::vector<Stroke>& strokes, sf::RenderTexture& canvas){
+    if (!canUndo())
+        return nullptr;
+    std::size_t opIndex = m_cursor - 1;
+    std::size_t segmentIndex = findSegment(opIndex);
+    Segment& segment = m_segments[segmentIndex];
+    if (segment.spilled && !unspill(segment))
+        return nullptr;
+    const HistoryOp& op = segment.ops[opIndex - segment.start];
+    undoStrokes(op, strokes);
+    restore(segmentIndex, opIndex - segment.start, canvas);
+    m_cursor--;
+    return &op;
+}
+
+const HistoryOp* History::redo(std::vector<Stroke>& strokes, sf::RenderTexture& canvas){
+    if (!canRedo())
+        return nullptr;
+    std::size_t opIndex = m_cursor;
+    std::size_t segmentIndex = findSegment(opIndex);
+    Segment& segment = m_segments[segmentIndex];
+    if (segment.spilled && !unspill(segment))
+        return nullptr;
+    const HistoryOp& op = segment.ops[opIndex - segment.start];
+    redoStrokes(op, strokes);
+    if (op.type == HistoryOp::Type::Add){
+        FrameVector<sf::Vertex> triangles;
+        triangles.reserve(getTessellatedVertexCount(op.strokes[0]));
+        tessellateStroke(op.strokes[0], triangles);
+        CountingTarget(canvas).draw(triangles.data(), triangles.size(), sf::PrimitiveType::Triangles,
+            getStrokeStates(op.strokes[0].stamp != BrushStamp::Solid));
+        canvas.display();
+    } else {
+        // non-additive ops always end their segment, so the next checkpoint is exactly the state after it
+        Segment& next = m_segments[segmentIndex + 1];
+        if (next.spilled)
+            unspill(next);
+        CountingTarget(canvas).draw(sf::Sprite(*next.checkpoint), sf::RenderStates(sf::BlendNone));
+        canvas.display();
+    }
+    m_cursor++;
+    return &op;
+}
+
+void History::enforceBudget(){
+    // oldest first, and never the segments the cursor is working in
+    std::size_t keep = findSegment(m_cursor == 0 ? 0 : m_cursor - 1);
+    for (std::size_t i = 0; i < m_segments.size() && m_memoryUsage > m_memoryBudget; i++){
+        if (i + 1 >= m_segments.size() || i >= keep)
+            break;
+        if (!m_segments[i].spilled)
+            spill(m_segments[i]);
+    }
+    // spilled checkpoints only free GPU memory if their textures don't all sit in the pool
+    if (m_texturePool.size() > 2)
+        m_texturePool.resize(2);
+}
+
+std::string History::spillPath(const Segment& segment) const {
+    return m_spillDir + "/segment_" + std::to_string(segment.id) + ".bin";
+}
+
+template <typename T>
+static void writeRaw(std::FILE* file, const T* values, std::size_t count){
+    std::fwrite(values, sizeof(T), count, file);
+}
+
+template <typename T>
+static bool readRaw(std::FILE* file, T* values, std::size_t count){
+    return std::fread(values, sizeof(T), count, file) == count;
+}
+
+bool History::spill(Segment& segment){
+    std::error_code ec;
+    std::filesystem::create_directories(m_spillDir, ec);
+    std::FILE* file = std::fopen(spillPath(segment).c_str(), "wb");
+    if (!file)
+        return false;
+    // readback stalls, but only happens once per segment and only for history nobody is touching
+    sf::Image pixels = segment.checkpoint->copyToImage();
+    std::uint32_t header[3] = {(std::uint32_t)segment.ops.size(), pixels.getSize().x, pixels.getSize().y};
+    writeRaw(file, header, 3);
+    writeRaw(file, pixels.getPixelsPtr(), (std::size_t)header[1] * header[2] * 4);
+    for (const auto& op : segment.ops){
+        std::uint32_t opHeader[3] = {(std::uint32_t)op.type, (std::uint32_t)op.indices.size(), (std::uint32_t)op.strokes.size()};
+        writeRaw(file, opHeader, 3);
+        for (const auto& stroke : op.strokes){
+            // fitted strokes only keep their curve, flag 4, and shapes their handles, the shape in the
+            // flags' second byte. both are flattened again on the way back
+            const std::vector<sf::Vector2f>& points = !stroke.handles.empty() ? stroke.handles : stroke.curve.empty() ? stroke.points : stroke.curve;
+            std::uint32_t strokeHeader[5] = {stroke.id, stroke.color.toInteger(), (std::uint32_t)points.size(), (std::uint32_t)stroke.stamp,
+                (std::uint32_t)(!stroke.widths.empty()) | (std::uint32_t)(!stroke.alphas.empty()) << 1 | (std::uint32_t)(!stroke.curve.empty()) << 2
+                | (std::uint32_t)(stroke.handles.empty() ? StrokeShape::Freehand : stroke.shape) << 8};
+            writeRaw(file, strokeHeader, 5);
+            writeRaw(file, &stroke.thickness, 1);
+            writeRaw(file, points.data(), points.size());
+            writeRaw(file, stroke.widths.data(), stroke.widths.size());
+            writeRaw(file, stroke.alphas.data(), stroke.alphas.size());
+        }
+        writeRaw(file, op.indices.data(), op.indices.size());
+    }
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    if (!ok){
+        std::filesystem::remove(spillPath(segment), ec);
+        return false;
+    }
+    m_memoryUsage -= segmentBytes(segment);
+    m_texturePool.push_back(std::move(segment.checkpoint));
+    segment.ops.clear();
+    segment.ops.shrink_to_fit();
+    segment.spilled = true;
+    return true;
+}
+
+bool History::unspill(Segment& segment){
+    std::FILE* file = std::fopen(spillPath(segment).c_str(), "rb");
+    if (!file)
+        return false;
+    std::uint32_t header[3];
+    bool ok = readRaw(file, header, 3);
+    std::vector<std::uint8_t> pixels(ok ? (std::size_t)header[1] * header[2] * 4 : 0);
+    ok = ok && readRaw(file, pixels.data(), pixels.size());
+    std::vector<HistoryOp> ops(ok ? header[0] : 0);
+    for (auto& op : ops){
+        std::uint32_t opHeader[3];
+        if (!(ok = readRaw(file, opHeader, 3)))
+            break;
+        op.type = (HistoryOp::Type)opHeader[0];
+        op.indices.resize(opHeader[1]);
+        op.strokes.resize(opHeader[2]);
+        for (auto& stroke : op.strokes){
+            std::uint32_t strokeHeader[5];
+            if (!(ok = readRaw(file, strokeHeader, 5) && readRaw(file, &stroke.thickness, 1)))
+                break;
+            stroke.id = strokeHeader[0];
+            stroke.color = sf::Color(strokeHeader[1]);
+            stroke.points.resize(strokeHeader[2]);
+            stroke.stamp = (BrushStamp)strokeHeader[3];
+            stroke.widths.resize(strokeHeader[4] & 1 ? strokeHeader[2] : 0);
+            stroke.alphas.resize(strokeHeader[4] & 2 ? strokeHeader[2] : 0);
+            if (!(ok = readRaw(file, stroke.points.data(), stroke.points.size()) && readRaw(file, stroke.widths.data(), stroke.widths.size())
+                && readRaw(file, stroke.alphas.data(), stroke.alphas.size())))
+                break;
+            if (strokeHeader[4] & 4){
+                stroke.curve.swap(stroke.points);
+                flattenCurve(stroke.curve, stroke.points);
+            } else if (strokeHeader[4] >> 8){
+                stroke.shape = (StrokeShape)(strokeHeader[4] >> 8);
+                stroke.handles.swap(stroke.points);
+                flattenShape(stroke.shape, stroke.handles, stroke.points);
+            }
+        }
+        if (!ok || !(ok = readRaw(file, op.indices.data(), op.indices.size())))
+            break;
+    }
+    std::fclose(file);
+    if (!ok)
+        return false;
+    segment.checkpoint = takeTexture({header[1], header[2]});
+    segment.checkpoint->update(pixels.data());
+    segment.ops = std::move(ops);
+    segment.spilled = false;
+    m_memoryUsage += segmentBytes(segment);
+    std::error_code ec;
+    std::filesystem::remove(spillPath(segment), ec);
+    return true;
+}
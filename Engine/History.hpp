@@ -0,0 +1,84 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Stroke.hpp"
+
+struct HistoryOp {
+    enum class Type : std::uint32_t { Add, Erase, Clear, Replace };
+    Type type = Type::Add;
+    std::vector<Stroke> strokes; // add: the new stroke, erase: the erased ones, clear: everything cleared,
+                                 // replace: every stroke as it was, then every one as it is now
+    std::vector<std::uint32_t> indices; // erase, replace: where each of them sits, ascending
+
+    std::size_t getMemoryUsage() const;
+};
+
+// undo/redo over the stroke list plus the baked canvas. ops are grouped into segments that each
+// start with a GPU copy of the canvas, so undo only replays the few strokes since the last checkpoint.
+// old segments are spilled to disk once the history goes over its memory budget
+class History {
+public:
+    History(std::size_t memoryBudget = 64 << 20, const std::string& spillDir = "history");
+    ~History();
+    History(const History&) = delete;
+    History& operator=(const History&) = delete;
+
+    // drops all history and starts over from the canvas as it is now
+    void reset(const sf::RenderTexture& canvas);
+
+    // call after the op has been applied to both the stroke list and the canvas
+    void recordAdd(const Stroke& stroke, const sf::RenderTexture& canvas);
+    void recordErase(std::vector<std::uint32_t> indices, std::vector<Stroke> erased, const sf::RenderTexture& canvas);
+    void recordClear(std::vector<Stroke> cleared, const sf::RenderTexture& canvas);
+    void recordReplace(std::vector<std::uint32_t> indices, std::vector<Stroke> before, std::vector<Stroke> after, const sf::RenderTexture& canvas);
+
+    // undo/redo update strokes and canvas and return the op they reverted/reapplied, or nullptr
+    const HistoryOp* undo(std::vector<Stroke>& strokes, sf::RenderTexture& canvas);
+    const HistoryOp* redo(std::vector<Stroke>& strokes, sf::RenderTexture& canvas);
+    // just the stroke list half of undo and redo, no canvas involved
+    static void undoStrokes(const HistoryOp& op, std::vector<Stroke>& strokes);
+    static void redoStrokes(const HistoryOp& op, std::vector<Stroke>& strokes);
+    bool canUndo() const { return m_cursor > 0; }
+    bool canRedo() const { return m_cursor < m_total; }
+
+    void setCheckpointInterval(std::size_t ops){ m_checkpointInterval = ops; }
+    void setMemoryBudget(std::size_t bytes){ m_memoryBudget = bytes; }
+    std::size_t getMemoryUsage() const { return m_memoryUsage; }
+
+private:
+    struct Segment {
+        std::size_t start = 0;                   // global index of ops[0]
+        std::unique_ptr<sf::Texture> checkpoint; // canvas before ops[0]
+        std::vector<HistoryOp> ops;              // empty while spilled
+        bool spilled = false;
+        std::uint64_t id = 0;
+    };
+
+    void record(HistoryOp op, const sf::RenderTexture& canvas);
+    void truncateRedo();
+    void startSegment(const sf::RenderTexture& canvas);
+    std::size_t findSegment(std::size_t opIndex) const;
+    void restore(std::size_t segmentIndex, std::size_t opCount, sf::RenderTexture& canvas);
+    std::size_t segmentBytes(const Segment& segment) const;
+    void enforceBudget();
+    bool spill(Segment& segment);
+    bool unspill(Segment& segment);
+    std::string spillPath(const Segment& segment) const;
+    std::unique_ptr<sf::Texture> takeTexture(sf::Vector2u size);
+
+    std::deque<Segment> m_segments;
+    std::vector<std::unique_ptr<sf::Texture>> m_texturePool;
+    std::size_t m_cursor = 0; // ops currently applied
+    std::size_t m_total = 0;  // ops recorded, anything past the cursor is redo
+    std::size_t m_checkpointInterval = 32;
+    std::size_t m_memoryBudget;
+    std::size_t m_memoryUsage = 0;
+    std::string m_spillDir;
+    std::uint64_t m_nextSegmentId = 0;
+};
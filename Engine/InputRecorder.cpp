@@ -0,0 +1,373 @@
+#include <SFML/Window.hpp>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "InputRecorder.hpp"
+
+#define INPUT_MAGIC "PZIR"
+#define INPUT_VERSION 1
+#define INPUT_FLUSH_BYTES (64 << 10)
+
+using InputFormat::Record;
+
+static std::uint8_t packModifiers(bool alt, bool control, bool shift, bool system){
+    return (alt ? 1 : 0) | (control ? 2 : 0) | (shift ? 4 : 0) | (system ? 8 : 0);
+}
+
+InputRecorder::~InputRecorder(){
+    close();
+}
+
+bool InputRecorder::open(const std::string& path){
+    close();
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file)
+        return false;
+    m_buffer.clear();
+    m_buffer.insert(m_buffer.end(), INPUT_MAGIC, INPUT_MAGIC + 4);
+    writeByte(INPUT_VERSION);
+    m_start = std::chrono::steady_clock::now();
+    m_lastTime = 0;
+    m_lastMouse = {};
+    m_frameHasEvents = false;
+    return true;
+}
+
+void InputRecorder::close(){
+    if (!m_file)
+        return;
+    flush();
+    std::fclose(m_file);
+    m_file = nullptr;
+}
+
+void InputRecorder::flush(){
+    if (!m_buffer.empty())
+        std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+    std::fflush(m_file);
+    m_buffer.clear();
+}
+
+void InputRecorder::writeVarint(std::uint64_t value){
+    while (value >= 0x80){
+        writeByte((std::uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    writeByte((std::uint8_t)value);
+}
+
+void InputRecorder::writeSigned(std::int64_t value){
+    writeVarint(((std::uint64_t)value << 1) ^ (std::uint64_t)(value >> 63)); // zigzag, small negatives stay small
+}
+
+void InputRecorder::writeHeader(Record type){
+    std::uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+    writeVarint(now - m_lastTime);
+    writeByte((std::uint8_t)type);
+    m_lastTime = now;
+}
+
+void InputRecorder::beginWindow(std::uint8_t windowId){
+    if (!m_file)
+        return;
+    writeHeader(Record::WindowBegin);
+    writeByte(windowId);
+    m_frameHasEvents = true;
+}
+
+void InputRecorder::record(const sf::Event& event){
+    if (!m_file)
+        return;
+
+    auto writeMouse = [this](sf::Vector2i position){
+        writeSigned(position.x - m_lastMouse.x);
+        writeSigned(position.y - m_lastMouse.y);
+        m_lastMouse = position;
+    };
+
+    if (event.is<sf::Event::Closed>())
+        writeHeader(Record::Closed);
+    else if (const auto* resized = event.getIf<sf::Event::Resized>()){
+        writeHeader(Record::Resized);
+        writeVarint(resized->size.x);
+        writeVarint(resized->size.y);
+    }
+    else if (event.is<sf::Event::FocusLost>())
+        writeHeader(Record::FocusLost);
+    else if (event.is<sf::Event::FocusGained>())
+        writeHeader(Record::FocusGained);
+    else if (const auto* text = event.getIf<sf::Event::TextEntered>()){
+        writeHeader(Record::TextEntered);
+        writeVarint(text->unicode);
+    }
+    else if (const auto* key = event.getIf<sf::Event::KeyPressed>()){
+        writeHeader(Record::KeyPressed);
+        writeSigned((int)key->code);
+        writeSigned((int)key->scancode);
+        writeByte(packModifiers(key->alt, key->control, key->shift, key->system));
+    }
+    else if (const auto* key = event.getIf<sf::Event::KeyReleased>()){
+        writeHeader(Record::KeyReleased);
+        writeSigned((int)key->code);
+        writeSigned((int)key->scancode);
+        writeByte(packModifiers(key->alt, key->control, key->shift, key->system));
+    }
+    else if (const auto* wheel = event.getIf<sf::Event::MouseWheelScrolled>()){
+        writeHeader(Record::MouseWheelScrolled);
+        writeByte((std::uint8_t)wheel->wheel);
+        std::uint8_t delta[sizeof(float)];
+        std::memcpy(delta, &wheel->delta, sizeof(float));
+        m_buffer.insert(m_buffer.end(), delta, delta + sizeof(float));
+        writeMouse(wheel->position);
+    }
+    else if (const auto* button = event.getIf<sf::Event::MouseButtonPressed>()){
+        writeHeader(Record::MouseButtonPressed);
+        writeByte((std::uint8_t)button->button);
+        writeMouse(button->position);
+    }
+    else if (const auto* button = event.getIf<sf::Event::MouseButtonReleased>()){
+        writeHeader(Record::MouseButtonReleased);
+        writeByte((std::uint8_t)button->button);
+        writeMouse(button->position);
+    }
+    else if (const auto* moved = event.getIf<sf::Event::MouseMoved>()){
+        writeHeader(Record::MouseMoved);
+        writeMouse(moved->position);
+    }
+    else if (event.is<sf::Event::MouseEntered>())
+        writeHeader(Record::MouseEntered);
+    else if (event.is<sf::Event::MouseLeft>())
+        writeHeader(Record::MouseLeft);
+    else if (const auto* touch = event.getIf<sf::Event::TouchBegan>()){
+        writeHeader(Record::TouchBegan);
+        writeVarint(touch->finger);
+        writeSigned(touch->position.x);
+        writeSigned(touch->position.y);
+    }
+    else if (const auto* touch = event.getIf<sf::Event::TouchMoved>()){
+        writeHeader(Record::TouchMoved);
+        writeVarint(touch->finger);
+        writeSigned(touch->position.x);
+        writeSigned(touch->position.y);
+    }
+    else if (const auto* touch = event.getIf<sf::Event::TouchEnded>()){
+        writeHeader(Record::TouchEnded);
+        writeVarint(touch->finger);
+        writeSigned(touch->position.x);
+        writeSigned(touch->position.y);
+    }
+    else
+        return; // joystick and sensor events don't drive anything yet
+    m_frameHasEvents = true;
+}
+
+void InputRecorder::endFrame(){
+    if (!m_file || !m_frameHasEvents)
+        return;
+    writeHeader(Record::FrameEnd);
+    m_frameHasEvents = false;
+    if (m_buffer.size() >= INPUT_FLUSH_BYTES)
+        flush();
+}
+
+bool InputReplayer::open(const std::string& path, Mode mode){
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 5 || std::memcmp(data.data(), INPUT_MAGIC, 4) != 0 || data[4] != INPUT_VERSION)
+        return false;
+    m_data = std::move(data);
+    m_offset = 5;
+    m_mode = mode;
+    m_start = std::chrono::steady_clock::now();
+    m_time = 0;
+    m_lastMouse = {};
+    m_windowId = 0;
+    m_eventCount = 0;
+    return true;
+}
+
+std::uint64_t InputReplayer::readVarint(){
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64 && m_offset < m_data.size(); shift += 7){
+        std::uint8_t byte = m_data[m_offset++];
+        value |= (std::uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            break;
+    }
+    return value;
+}
+
+std::int64_t InputReplayer::readSigned(){
+    std::uint64_t value = readVarint();
+    return (std::int64_t)(value >> 1) ^ -(std::int64_t)(value & 1);
+}
+
+bool InputReplayer::peekTime(std::uint64_t& time){
+    if (isFinished())
+        return false;
+    std::size_t offset = m_offset;
+    time = m_time + readVarint();
+    m_offset = offset;
+    return true;
+}
+
+std::optional<sf::Event> InputReplayer::poll(){
+    while (!isFinished()){
+        if (m_mode == Mode::RealTime){
+            std::uint64_t due;
+            peekTime(due);
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+            if (due > (std::uint64_t)elapsed)
+                return std::nullopt;
+        }
+        m_time += readVarint();
+        Record type = (Record)readByte();
+        if (type == Record::FrameEnd){
+            if (m_mode == Mode::Fast)
+                return std::nullopt;
+            continue;
+        }
+        if (type == Record::WindowBegin){
+            m_windowId = readByte();
+            // the new window took a while to open, don't make up for that by bursting events
+            if (m_mode == Mode::RealTime)
+                m_start = std::chrono::steady_clock::now() - std::chrono::microseconds(m_time);
+            continue;
+        }
+        if (std::optional<sf::Event> event = decode(type)){
+            m_eventCount++;
+            return event;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<sf::Event> InputReplayer::next(){
+    while (!isFinished()){
+        m_time += readVarint();
+        Record type = (Record)readByte();
+        if (type == Record::FrameEnd)
+            continue;
+        if (type == Record::WindowBegin){
+            m_windowId = readByte();
+            continue;
+        }
+        if (std::optional<sf::Event> event = decode(type)){
+            m_eventCount++;
+            return event;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<sf::Event> InputReplayer::decode(Record type){
+    auto readMouse = [this](){
+        m_lastMouse.x += (int)readSigned();
+        m_lastMouse.y += (int)readSigned();
+        return m_lastMouse;
+    };
+    auto readKey = [this](auto key){
+        key.code = (sf::Keyboard::Key)readSigned();
+        key.scancode = (sf::Keyboard::Scancode)readSigned();
+        std::uint8_t modifiers = readByte();
+        key.alt = modifiers & 1;
+        key.control = modifiers & 2;
+        key.shift = modifiers & 4;
+        key.system = modifiers & 8;
+        return key;
+    };
+    auto readTouch = [this](auto touch){
+        touch.finger = (unsigned int)readVarint();
+        touch.position.x = (int)readSigned();
+        touch.position.y = (int)readSigned();
+        return touch;
+    };
+
+    switch (type){
+    case Record::Closed:
+        return sf::Event::Closed{};
+    case Record::Resized: {
+        sf::Event::Resized resized;
+        resized.size.x = (unsigned int)readVarint();
+        resized.size.y = (unsigned int)readVarint();
+        return resized;
+    }
+    case Record::FocusLost:
+        return sf::Event::FocusLost{};
+    case Record::FocusGained:
+        return sf::Event::FocusGained{};
+    case Record::TextEntered:
+        return sf::Event::TextEntered{(char32_t)readVarint()};
+    case Record::KeyPressed:
+        return readKey(sf::Event::KeyPressed{});
+    case Record::KeyReleased:
+        return readKey(sf::Event::KeyReleased{});
+    case Record::MouseWheelScrolled: {
+        sf::Event::MouseWheelScrolled wheel;
+        wheel.wheel = (sf::Mouse::Wheel)readByte();
+        if (m_offset + sizeof(float) > m_data.size()){
+            m_offset = m_data.size();
+            return std::nullopt;
+        }
+        std::memcpy(&wheel.delta, m_data.data() + m_offset, sizeof(float));
+        m_offset += sizeof(float);
+        wheel.position = readMouse();
+        return wheel;
+    }
+    case Record::MouseButtonPressed: {
+        sf::Event::MouseButtonPressed button;
+        button.button = (sf::Mouse::Button)readByte();
+        button.position = readMouse();
+        return button;
+    }
+    case Record::MouseButtonReleased: {
+        sf::Event::MouseButtonReleased button;
+        button.button = (sf::Mouse::Button)readByte();
+        button.position = readMouse();
+        return button;
+    }
+    case Record::MouseMoved:
+        return sf::Event::MouseMoved{readMouse()};
+    case Record::MouseEntered:
+        return sf::Event::MouseEntered{};
+    case Record::MouseLeft:
+        return sf::Event::MouseLeft{};
+    case Record::TouchBegan:
+        return readTouch(sf::Event::TouchBegan{});
+    case Record::TouchMoved:
+        return readTouch(sf::Event::TouchMoved{});
+    case Record::TouchEnded:
+        return readTouch(sf::Event::TouchEnded{});
+    default:
+        m_offset = m_data.size(); // unknown record, the rest can't be framed anymore
+        return std::nullopt;
+    }
+}
+
+void InputSession::beginWindow(std::uint8_t windowId){
+    m_recorder.beginWindow(windowId);
+}
+
+std::optional<sf::Event> InputSession::pollEvent(sf::WindowBase& window){
+    std::optional<sf::Event> event;
+    if (isReplaying()){
+        // keep pumping the OS queue so the window stays responsive, but only let a close through
+        while (std::optional<sf::Event> live = window.pollEvent()){
+            if (live->is<sf::Event::Closed>())
+                return live;
+        }
+        event = m_replayer.poll();
+    }
+    else
+        event = window.pollEvent();
+    if (event)
+        m_recorder.record(*event);
+    return event;
+}
+
+void InputSession::endFrame(){
+    m_recorder.endFrame();
+}
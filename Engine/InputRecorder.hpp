@@ -0,0 +1,119 @@
+#pragma once
+#include <SFML/Window.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+// .pzr input recordings: "PZIR" + version, then one record per event:
+//   varint microseconds since the previous record, type byte, type specific payload
+// mouse moves are stored as deltas from the last mouse position, so a drawn stroke costs a
+// few bytes per sample. frame markers keep the per frame grouping for as fast as possible replay
+namespace InputFormat {
+    enum class Record : std::uint8_t {
+        FrameEnd = 0,
+        WindowBegin, // the game and the whiteboard each open their own window
+        Closed,
+        Resized,
+        FocusLost,
+        FocusGained,
+        TextEntered,
+        KeyPressed,
+        KeyReleased,
+        MouseWheelScrolled,
+        MouseButtonPressed,
+        MouseButtonReleased,
+        MouseMoved,
+        MouseEntered,
+        MouseLeft,
+        TouchBegan,
+        TouchMoved,
+        TouchEnded
+    };
+}
+
+class InputRecorder {
+public:
+    ~InputRecorder();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return m_file != nullptr; }
+
+    void beginWindow(std::uint8_t windowId);
+    void record(const sf::Event& event);
+    void endFrame(); // only written when the frame had events
+
+private:
+    void writeHeader(InputFormat::Record type);
+    void writeVarint(std::uint64_t value);
+    void writeSigned(std::int64_t value);
+    void writeByte(std::uint8_t value){ m_buffer.push_back(value); }
+    void flush();
+
+    std::FILE* m_file = nullptr;
+    std::vector<std::uint8_t> m_buffer;
+    std::chrono::steady_clock::time_point m_start;
+    std::uint64_t m_lastTime = 0;
+    sf::Vector2i m_lastMouse;
+    bool m_frameHasEvents = false;
+};
+
+class InputReplayer {
+public:
+    enum class Mode {
+        RealTime, // events come out when their recorded timestamp is due
+        Fast      // one recorded frame per poll loop, regardless of time
+    };
+
+    bool open(const std::string& path, Mode mode = Mode::RealTime);
+    bool isOpen() const { return !m_data.empty(); }
+    bool isFinished() const { return m_offset >= m_data.size(); }
+    Mode getMode() const { return m_mode; }
+
+    // next event due, std::nullopt ends the current frame's batch
+    std::optional<sf::Event> poll();
+    // reads the next event ignoring time and frame markers, for tools that don't run a frame loop
+    std::optional<sf::Event> next();
+
+    std::uint8_t getWindowId() const { return m_windowId; }
+    std::size_t getEventCount() const { return m_eventCount; }
+    std::uint64_t getTimestamp() const { return m_time; } // microseconds of the last decoded record
+
+private:
+    bool peekTime(std::uint64_t& time);
+    std::optional<sf::Event> decode(InputFormat::Record type);
+    std::uint64_t readVarint();
+    std::int64_t readSigned();
+    std::uint8_t readByte(){ return m_offset < m_data.size() ? m_data[m_offset++] : 0; }
+
+    std::vector<std::uint8_t> m_data;
+    std::size_t m_offset = 0;
+    Mode m_mode = Mode::RealTime;
+    std::chrono::steady_clock::time_point m_start;
+    std::uint64_t m_time = 0;
+    sf::Vector2i m_lastMouse;
+    std::uint8_t m_windowId = 0;
+    std::size_t m_eventCount = 0;
+    bool m_frameDone = false;
+};
+
+// sits between a window and its event loop: records what the window produces, or replaces it with
+// a recording. while replaying, live input is swallowed except for closing the window
+class InputSession {
+public:
+    bool startRecording(const std::string& path){ return m_recorder.open(path); }
+    bool startReplay(const std::string& path, InputReplayer::Mode mode){ return m_replayer.open(path, mode); }
+    bool isReplaying() const { return m_replayer.isOpen() && !m_replayer.isFinished(); }
+    bool isFastReplay() const { return isReplaying() && m_replayer.getMode() == InputReplayer::Mode::Fast; }
+
+    void beginWindow(std::uint8_t windowId);
+    std::optional<sf::Event> pollEvent(sf::WindowBase& window);
+    void endFrame();
+
+private:
+    InputRecorder m_recorder;
+    InputReplayer m_replayer;
+};
@@ -0,0 +1,404 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "CurveFit.hpp"
+#include "Journal.hpp"
+#include "LevelFile.hpp"
+#include "Profiler.hpp"
+#include "Shape.hpp"
+
+#define JOURNAL_MAGIC "PZJL"
+#define JOURNAL_VERSION 1
+
+static std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc = 0){
+    static const std::array<std::uint32_t, 256> table = [](){
+        std::array<std::uint32_t, 256> t;
+        for (std::uint32_t i = 0; i < 256; i++){
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+Journal::Journal(const std::string& basePath, std::vector<Stroke>& recovered, std::size_t ringBytes)
+    : m_snapshotPath(basePath + ".pzl"), m_journalPath(basePath + ".journal"), m_ring(ringBytes)
+{
+    recover();
+    recovered = m_replica;
+    m_sequence = m_appliedSequence;
+    m_writer = std::thread(&Journal::writerLoop, this);
+}
+
+Journal::~Journal(){
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    m_writer.join();
+}
+
+void Journal::recover(){
+    LevelFile snapshot;
+    if (snapshot.open(m_snapshotPath)){
+        snapshot.loadStrokes(m_replica);
+        m_appliedSequence = snapshot.getSequence();
+    }
+
+    std::ifstream in(m_journalPath, std::ios::binary);
+    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < 8 || std::memcmp(data.data(), JOURNAL_MAGIC, 4) != 0)
+        return;
+    std::size_t offset = 8;
+    std::uint32_t checksumSkip = offsetof(RecordHeader, sequence);
+    while (data.size() - offset >= sizeof(RecordHeader)){
+        RecordHeader header;
+        std::memcpy(&header, data.data() + offset, sizeof(header));
+        // a torn or corrupt record means the crash happened mid-write, everything before it is good
+        if (header.size < sizeof(header) || header.size > data.size() - offset
+            || crc32(data.data() + offset + checksumSkip, header.size - checksumSkip) != header.checksum
+            || !isValidPayload(header, data.data() + offset + sizeof(header)))
+            break;
+        if (header.sequence > m_appliedSequence){
+            applyRecord(header, data.data() + offset + sizeof(header));
+            m_appliedSequence = header.sequence;
+            m_journalBytes += header.size;
+        }
+        offset += header.size;
+    }
+}
+
+void Journal::push(const RecordHeader& header, std::initializer_list<Span> payload){
+    std::size_t head = m_head.load(std::memory_order_relaxed);
+    std::size_t tail = m_tail.load(std::memory_order_acquire);
+    if (m_spilling.load(std::memory_order_acquire) || header.size > m_ring.size() - (head - tail)){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // the writer may have taken the spill since, then the ring is usable again if there's room
+        tail = m_tail.load(std::memory_order_acquire);
+        if (m_spilling.load(std::memory_order_relaxed) || header.size > m_ring.size() - (head - tail)){
+            m_spilling.store(true, std::memory_order_release);
+            const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(&header);
+            m_spill.insert(m_spill.end(), bytes, bytes + sizeof(header));
+            for (const Span& span : payload){
+                bytes = static_cast<const std::uint8_t*>(span.data);
+                m_spill.insert(m_spill.end(), bytes, bytes + span.size);
+            }
+            return;
+        }
+    }
+    auto copyIn = [this](std::size_t at, const void* src, std::size_t size){
+        std::size_t pos = at % m_ring.size();
+        std::size_t first = std::min(size, m_ring.size() - pos);
+        std::memcpy(m_ring.data() + pos, src, first);
+        std::memcpy(m_ring.data(), static_cast<const std::uint8_t*>(src) + first, size - first);
+    };
+    copyIn(head, &header, sizeof(header));
+    std::size_t at = head + sizeof(header);
+    for (const Span& span : payload){
+        copyIn(at, span.data, span.size);
+        at += span.size;
+    }
+    m_head.store(head + header.size, std::memory_order_release);
+}
+
+void Journal::pushStroke(OpType type, const Stroke& stroke, std::uint32_t target){
+    RecordHeader header{};
+    Span prefix{&target, type == OpType::Add ? 0 : sizeof(target)};
+    std::size_t pointBytes = stroke.points.size() * sizeof(sf::Vector2f);
+    header.sequence = ++m_sequence;
+    header.type = type;
+    header.id = stroke.id;
+    header.color = stroke.color.toInteger();
+    header.thickness = stroke.thickness;
+    header.pointCount = (std::uint32_t)stroke.points.size();
+    if (!stroke.handles.empty()){
+        StyleHeader style{(std::uint8_t)stroke.stamp, 0, 0, (std::uint8_t)(1 + (int)stroke.shape)};
+        std::size_t handleBytes = stroke.handles.size() * sizeof(sf::Vector2f);
+        header.pointCount = (std::uint32_t)stroke.handles.size();
+        header.size = (std::uint32_t)(sizeof(header) + prefix.size + handleBytes + sizeof(style));
+        push(header, {prefix, {stroke.handles.data(), handleBytes}, {&style, sizeof(style)}});
+        return;
+    }
+    if (!stroke.curve.empty()){
+        StyleHeader style{(std::uint8_t)stroke.stamp, 0, 0, 1};
+        std::size_t curveBytes = stroke.curve.size() * sizeof(sf::Vector2f);
+        header.pointCount = (std::uint32_t)stroke.curve.size();
+        header.size = (std::uint32_t)(sizeof(header) + prefix.size + curveBytes + sizeof(style));
+        push(header, {prefix, {stroke.curve.data(), curveBytes}, {&style, sizeof(style)}});
+        return;
+    }
+    if (stroke.stamp == BrushStamp::Solid && stroke.widths.empty() && stroke.alphas.empty()){
+        header.size = (std::uint32_t)(sizeof(header) + prefix.size + pointBytes);
+        push(header, {prefix, {stroke.points.data(), pointBytes}});
+        return;
+    }
+    StyleHeader style{(std::uint8_t)stroke.stamp, !stroke.widths.empty(), !stroke.alphas.empty(), 0};
+    header.size = (std::uint32_t)(sizeof(header) + prefix.size + pointBytes + sizeof(style) + stroke.widths.size() + stroke.alphas.size());
+    push(header, {prefix, {stroke.points.data(), pointBytes}, {&style, sizeof(style)}, {stroke.widths.data(), stroke.widths.size()}, {stroke.alphas.data(), stroke.alphas.size()}});
+}
+
+void Journal::recordAdd(const Stroke& stroke){
+    pushStroke(OpType::Add, stroke, 0);
+}
+
+void Journal::recordInsert(std::uint32_t index, const Stroke& stroke){
+    pushStroke(OpType::Insert, stroke, index);
+}
+
+void Journal::recordReplace(std::uint32_t strokeId, const Stroke& stroke){
+    pushStroke(OpType::Replace, stroke, strokeId);
+}
+
+void Journal::recordErase(std::uint32_t strokeId){
+    RecordHeader header{};
+    header.size = sizeof(header);
+    header.sequence = ++m_sequence;
+    header.type = OpType::Erase;
+    header.id = strokeId;
+    push(header, {});
+}
+
+void Journal::recordClear(){
+    RecordHeader header{};
+    header.size = sizeof(header);
+    header.sequence = ++m_sequence;
+    header.type = OpType::Clear;
+    push(header, {});
+}
+
+bool Journal::isValidPayload(const RecordHeader& header, const std::uint8_t* payload){
+    std::uint64_t size = header.size - sizeof(header);
+    switch (header.type){
+        case OpType::Add:
+            return isValidStroke(header, payload, size);
+        case OpType::Insert:
+        case OpType::Replace:
+            return size >= sizeof(std::uint32_t) && isValidStroke(header, payload + sizeof(std::uint32_t), size - sizeof(std::uint32_t));
+        case OpType::Erase:
+        case OpType::Clear:
+            return size == 0;
+        default:
+            return false;
+    }
+}
+
+bool Journal::isValidStroke(const RecordHeader& header, const std::uint8_t* payload, std::uint64_t size){
+    std::uint64_t pointBytes = (std::uint64_t)header.pointCount * sizeof(sf::Vector2f);
+    if (size == pointBytes)
+        return true;
+    if (size < pointBytes + sizeof(StyleHeader))
+        return false;
+    StyleHeader style;
+    std::memcpy(&style, payload + pointBytes, sizeof(style));
+    std::uint64_t styleBytes = (std::uint64_t)((style.hasWidths ? 1 : 0) + (style.hasAlphas ? 1 : 0)) * header.pointCount;
+    if (style.curve == 1 && (style.hasWidths || style.hasAlphas || header.pointCount < 4 || header.pointCount % 3 != 1))
+        return false;
+    if (style.curve > 1 && (style.hasWidths || style.hasAlphas || style.curve > STROKE_SHAPE_VALUES
+        || !isValidShape((StrokeShape)(style.curve - 1), header.pointCount)))
+        return false;
+    return style.stamp < BRUSH_STAMP_VALUES && size == pointBytes + sizeof(style) + styleBytes;
+}
+
+void Journal::readStroke(const RecordHeader& header, const std::uint8_t* payload, std::size_t size, Stroke& stroke){
+    stroke.id = header.id;
+    stroke.color = sf::Color(header.color);
+    stroke.thickness = header.thickness;
+    stroke.points.resize(header.pointCount);
+    std::size_t pointBytes = header.pointCount * sizeof(sf::Vector2f);
+    std::memcpy(stroke.points.data(), payload, pointBytes);
+    if (size <= pointBytes)
+        return;
+    StyleHeader style;
+    const std::uint8_t* at = payload + pointBytes;
+    std::memcpy(&style, at, sizeof(style));
+    at += sizeof(style);
+    stroke.stamp = (BrushStamp)style.stamp;
+    if (style.curve == 1){
+        stroke.curve.swap(stroke.points);
+        flattenCurve(stroke.curve, stroke.points);
+    } else if (style.curve > 1){
+        stroke.shape = (StrokeShape)(style.curve - 1);
+        stroke.handles.swap(stroke.points);
+        flattenShape(stroke.shape, stroke.handles, stroke.points);
+    }
+    if (style.hasWidths){
+        stroke.widths.assign(at, at + header.pointCount);
+        at += header.pointCount;
+    }
+    if (style.hasAlphas)
+        stroke.alphas.assign(at, at + header.pointCount);
+}
+
+void Journal::applyRecord(const RecordHeader& header, const std::uint8_t* payload){
+    std::size_t size = header.size - sizeof(header);
+    std::uint32_t target = 0;
+    if (header.type == OpType::Insert || header.type == OpType::Replace){
+        std::memcpy(&target, payload, sizeof(target));
+        payload += sizeof(target);
+        size -= sizeof(target);
+    }
+    switch (header.type){
+        case OpType::Add:
+            m_replica.emplace_back();
+            readStroke(header, payload, size, m_replica.back());
+            break;
+        case OpType::Insert: {
+            Stroke stroke;
+            readStroke(header, payload, size, stroke);
+            m_replica.insert(m_replica.begin() + std::min<std::size_t>(target, m_replica.size()), std::move(stroke));
+            break;
+        }
+        case OpType::Replace: {
+            auto it = std::find_if(m_replica.begin(), m_replica.end(), [target](const Stroke& s){ return s.id == target; });
+            if (it != m_replica.end()){
+                *it = Stroke();
+                readStroke(header, payload, size, *it);
+            }
+            break;
+        }
+        case OpType::Erase:
+            m_replica.erase(std::remove_if(m_replica.begin(), m_replica.end(), [&header](const Stroke& s){ return s.id == header.id; }), m_replica.end());
+            break;
+        case OpType::Clear:
+            m_replica.clear();
+            break;
+    }
+}
+
+bool Journal::startJournal(){
+    if (m_file)
+        std::fclose(m_file);
+    m_file = std::fopen(m_journalPath.c_str(), "wb");
+    m_journalBytes = 0;
+    if (!m_file)
+        return false;
+    std::uint32_t version = JOURNAL_VERSION;
+    std::fwrite(JOURNAL_MAGIC, 1, 4, m_file);
+    std::fwrite(&version, sizeof(version), 1, m_file);
+    std::fflush(m_file);
+    return true;
+}
+
+void Journal::appendRecord(const RecordHeader& header, const std::uint8_t* payload){
+    std::uint32_t checksumSkip = offsetof(RecordHeader, sequence);
+    RecordHeader out = header;
+    std::uint32_t crc = crc32(reinterpret_cast<const std::uint8_t*>(&out) + checksumSkip, sizeof(out) - checksumSkip);
+    out.checksum = crc32(payload, header.size - sizeof(header), crc);
+    std::fwrite(&out, sizeof(out), 1, m_file);
+    std::fwrite(payload, 1, header.size - sizeof(header), m_file);
+    m_journalBytes += header.size;
+}
+
+void Journal::compact(){
+    PROFILE_SCOPE("compact");
+    // the snapshot is renamed into place before the journal is cut, so there's always a full copy on disk
+    if (!saveLevelFile(m_snapshotPath, m_replica, m_appliedSequence))
+        return;
+    startJournal();
+}
+
+void Journal::writerLoop(){
+    PROFILE_THREAD("journal");
+    // fold whatever was recovered into the snapshot; starting a fresh journal also drops any torn tail
+    if (m_journalBytes > 0)
+        compact();
+    else
+        startJournal();
+
+    std::vector<std::uint8_t> payload;
+    std::vector<std::uint8_t> spill;
+    auto lastCompact = std::chrono::steady_clock::now();
+    bool quit = false;
+    while (!quit){
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait_for(lock, std::chrono::milliseconds(100), [this](){ return m_quit; });
+            quit = m_quit;
+            spill.clear();
+            spill.swap(m_spill);
+            m_spilling.store(false, std::memory_order_release);
+        }
+
+        // everything in the ring up to head was pushed before the spill started or after it was
+        // taken, so the two streams interleave cleanly by sequence
+        std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        std::size_t head = m_head.load(std::memory_order_acquire);
+        std::size_t spillAt = 0;
+        bool wrote = false;
+        auto copyOut = [this](std::size_t at, void* dst, std::size_t size){
+            std::size_t pos = at % m_ring.size();
+            std::size_t first = std::min(size, m_ring.size() - pos);
+            std::memcpy(dst, m_ring.data() + pos, first);
+            std::memcpy(static_cast<std::uint8_t*>(dst) + first, m_ring.data(), size - first);
+        };
+        while (tail != head || spillAt < spill.size()){
+            RecordHeader header;
+            bool fromRing = tail != head;
+            if (fromRing)
+                copyOut(tail, &header, sizeof(header));
+            if (spillAt < spill.size()){
+                RecordHeader spilled;
+                std::memcpy(&spilled, spill.data() + spillAt, sizeof(spilled));
+                if (!fromRing || spilled.sequence < header.sequence){
+                    header = spilled;
+                    fromRing = false;
+                }
+            }
+            const std::uint8_t* data;
+            if (fromRing){
+                payload.resize(header.size - sizeof(header));
+                copyOut(tail + sizeof(header), payload.data(), payload.size());
+                tail += header.size;
+                data = payload.data();
+            } else {
+                data = spill.data() + spillAt + sizeof(header);
+                spillAt += header.size;
+            }
+            applyRecord(header, data);
+            m_appliedSequence = header.sequence;
+            if (m_file){
+                appendRecord(header, data);
+                wrote = true;
+            }
+        }
+        m_tail.store(tail, std::memory_order_release);
+
+        if (wrote && m_file){
+            PROFILE_SCOPE("fsync");
+            std::fflush(m_file);
+#ifdef _WIN32
+            _commit(_fileno(m_file));
+#else
+            fsync(fileno(m_file));
+#endif
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (m_journalBytes > 0 && (quit || m_journalBytes > (16u << 20)
+            || std::chrono::duration<float>(now - lastCompact).count() >= m_compactSeconds)){
+            compact();
+            lastCompact = now;
+        }
+    }
+    if (m_file)
+        std::fclose(m_file);
+    m_file = nullptr;
+}
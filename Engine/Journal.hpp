@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Stroke.hpp"
+
+// append-only autosave: <base>.pzl is the last compacted snapshot, <base>.journal holds every
+// stroke operation since. the UI thread only copies records into a preallocated ring, a
+// background thread appends them to the journal, fsyncs, and periodically compacts. every edit is
+// journaled as what it changed, never as the whole model
+class Journal {
+public:
+    // recovers snapshot + journal into recovered, the canvas should start from exactly that
+    Journal(const std::string& basePath, std::vector<Stroke>& recovered, std::size_t ringBytes = 8 << 20);
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // UI thread only, never touch the disk and only allocate once the ring is full
+    void recordAdd(const Stroke& stroke);
+    void recordInsert(std::uint32_t index, const Stroke& stroke); // puts a stroke back at index
+    void recordReplace(std::uint32_t strokeId, const Stroke& stroke);
+    void recordErase(std::uint32_t strokeId);
+    void recordClear();
+
+    void setCompactInterval(float seconds){ m_compactSeconds = seconds; }
+
+private:
+    enum class OpType : std::uint32_t { Add = 1, Erase = 2, Clear = 3, Insert = 4, Replace = 5 };
+
+    // an add's payload is pointCount points, then for strokes that aren't plain solid ones a
+    // StyleHeader followed by the widths and alphas it flags, pointCount bytes each. fitted strokes
+    // log their curve's control points instead, and shapes their handles; both are flattened again
+    // when read back. inserts and replaces lead the same payload with a uint32, the index to insert
+    // at or the id of the stroke replaced
+    struct RecordHeader {
+        std::uint32_t size;     // whole record including this header
+        std::uint32_t checksum; // crc32 of everything after this field, only filled in on disk
+        std::uint32_t sequence;
+        OpType type;
+        std::uint32_t id;
+        std::uint32_t color;
+        float thickness;
+        std::uint32_t pointCount;
+    };
+
+    struct StyleHeader {
+        std::uint8_t stamp;
+        std::uint8_t hasWidths;
+        std::uint8_t hasAlphas;
+        std::uint8_t curve; // 1: the points are Bézier control points, above that a shape's handles, StrokeShape + 1
+    };
+
+    struct Span {
+        const void* data;
+        std::size_t size;
+    };
+
+    void push(const RecordHeader& header, std::initializer_list<Span> payload);
+    void pushStroke(OpType type, const Stroke& stroke, std::uint32_t target);
+    void writerLoop();
+    static bool isValidPayload(const RecordHeader& header, const std::uint8_t* payload);
+    static bool isValidStroke(const RecordHeader& header, const std::uint8_t* payload, std::uint64_t size);
+    static void readStroke(const RecordHeader& header, const std::uint8_t* payload, std::size_t size, Stroke& stroke);
+    void applyRecord(const RecordHeader& header, const std::uint8_t* payload);
+    void recover();
+    bool startJournal(); // truncates to an empty journal
+    void appendRecord(const RecordHeader& header, const std::uint8_t* payload);
+    void compact();
+
+    std::string m_snapshotPath;
+    std::string m_journalPath;
+    float m_compactSeconds = 30.f;
+
+    // single producer (UI) / single consumer (writer) byte ring
+    std::vector<std::uint8_t> m_ring;
+    std::atomic<std::size_t> m_head{0}; // total bytes written by the UI
+    std::atomic<std::size_t> m_tail{0}; // total bytes consumed by the writer
+    std::uint32_t m_sequence = 0;       // UI side counter
+    // records that didn't fit in the ring, guarded by m_mutex. while this is set every record goes
+    // there, and the writer merges both streams back by sequence
+    std::atomic<bool> m_spilling{false};
+    std::vector<std::uint8_t> m_spill;
+
+    // writer thread state
+    std::FILE* m_file = nullptr;
+    std::vector<Stroke> m_replica; // the model as the journal sees it, compacted into the snapshot
+    std::uint32_t m_appliedSequence = 0;
+    std::size_t m_journalBytes = 0; // records since the last compaction
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_quit = false;
+    std::thread m_writer;
+};
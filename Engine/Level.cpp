@@ -0,0 +1,145 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+
+#include "Level.hpp"
+
+ChunkCoord chunkAt(sf::Vector2f worldPos){
+    return {(int)std::floor(worldPos.x / CHUNKSIZE), (int)std::floor(worldPos.y / CHUNKSIZE)};
+}
+
+sf::FloatRect chunkBounds(ChunkCoord coord){
+    return {{(float)coord.x * CHUNKSIZE, (float)coord.y * CHUNKSIZE}, {(float)CHUNKSIZE, (float)CHUNKSIZE}};
+}
+
+std::size_t Chunk::getMemoryUsage() const {
+    std::size_t bytes = sizeof(Chunk) + strokes.capacity() * sizeof(Stroke) + pieceStart.capacity() * sizeof(std::uint32_t)
+        + collision.capacity() * sizeof(CollisionCapsule) + indices.capacity();
+    for (const auto& stroke : strokes)
+        bytes += stroke.points.capacity() * sizeof(sf::Vector2f) + stroke.widths.capacity() + stroke.alphas.capacity()
+            + (stroke.curve.capacity() + stroke.handles.capacity()) * sizeof(sf::Vector2f);
+    return bytes;
+}
+
+void Chunk::addPiece(Stroke piece, std::uint32_t start){
+    strokes.push_back(std::move(piece));
+    pieceStart.push_back(start);
+}
+
+// the pieces of one stroke that are still growing, one per chunk. a piece stays open while
+// consecutive steps along the stroke touch its chunk, and goes into the chunk as soon as one doesn't
+class PieceAccumulator {
+public:
+    PieceAccumulator(const Stroke& stroke, ChunkMap& chunks) : m_stroke(stroke), m_chunks(chunks) {}
+
+    // a step touching chunks lo..hi that adds the points [from, to). a chunk it touches first starts
+    // its piece at start instead, to keep the point the step leads in from
+    void step(ChunkCoord lo, ChunkCoord hi, std::size_t start, std::size_t from, std::size_t to){
+        const auto& points = m_stroke.points;
+        for (auto it = m_open.begin(); it != m_open.end();){
+            const ChunkCoord& c = it->first;
+            if (c.x < lo.x || c.x > hi.x || c.y < lo.y || c.y > hi.y){
+                close(c, it->second);
+                it = m_open.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (int cy = lo.y; cy <= hi.y; cy++){
+            for (int cx = lo.x; cx <= hi.x; cx++){
+                auto it = m_open.find({cx, cy});
+                if (it == m_open.end()){
+                    OpenPiece piece;
+                    piece.stroke.id = m_stroke.id;
+                    piece.stroke.color = m_stroke.color;
+                    piece.stroke.thickness = m_stroke.thickness;
+                    piece.stroke.points.assign(points.begin() + start, points.begin() + from);
+                    piece.start = (std::uint32_t)start;
+                    it = m_open.emplace(ChunkCoord{cx, cy}, std::move(piece)).first;
+                }
+                it->second.stroke.points.insert(it->second.stroke.points.end(), points.begin() + from, points.begin() + to);
+            }
+        }
+    }
+
+    void finish(){
+        for (auto& [c, piece] : m_open)
+            close(c, piece);
+        m_open.clear();
+    }
+
+private:
+    struct OpenPiece {
+        Stroke stroke;
+        std::uint32_t start;
+    };
+
+    void close(ChunkCoord c, OpenPiece& piece){
+        Chunk& chunk = m_chunks[c];
+        chunk.coord = c;
+        copyStrokeStyle(m_stroke, piece.stroke, piece.start);
+        chunk.addPiece(std::move(piece.stroke), piece.start);
+    }
+
+    const Stroke& m_stroke;
+    ChunkMap& m_chunks;
+    std::unordered_map<ChunkCoord, OpenPiece, ChunkCoordHash> m_open;
+};
+
+// rectangles go whole to every chunk they touch, each chunk gets its runs of consecutive ones
+static void splitFill(const Stroke& stroke, ChunkMap& chunks){
+    PieceAccumulator pieces(stroke, chunks);
+    for (std::size_t i = 0; i + 1 < stroke.points.size(); i += 2)
+        pieces.step(chunkAt(stroke.points[i]), chunkAt(stroke.points[i + 1]), i, i, i + 2);
+    pieces.finish();
+}
+
+void splitIntoChunks(const std::vector<Stroke>& strokes, ChunkMap& chunks){
+    for (const auto& stroke : strokes){
+        if (stroke.stamp == BrushStamp::Fill){
+            splitFill(stroke, chunks);
+            continue;
+        }
+        float r = stroke.thickness / 2.f;
+        if (!stroke.handles.empty()){
+            // a shape that fits in one chunk goes whole, so its collision comes from the primitive
+            sf::FloatRect bounds = stroke.getBounds();
+            ChunkCoord lo = chunkAt(bounds.position);
+            if (lo == chunkAt(bounds.position + bounds.size)){
+                Chunk& chunk = chunks[lo];
+                chunk.coord = lo;
+                chunk.addPiece(stroke, 0);
+                continue;
+            }
+        }
+        if (stroke.points.size() == 1){
+            sf::Vector2f p = stroke.points[0];
+            ChunkCoord lo = chunkAt(p - sf::Vector2f(r, r));
+            ChunkCoord hi = chunkAt(p + sf::Vector2f(r, r));
+            for (int cy = lo.y; cy <= hi.y; cy++){
+                for (int cx = lo.x; cx <= hi.x; cx++){
+                    Chunk& chunk = chunks[{cx, cy}];
+                    chunk.coord = {cx, cy};
+                    chunk.addPiece(stroke, 0);
+                }
+            }
+            continue;
+        }
+        // each segment carries its first point into any chunk it enters
+        PieceAccumulator pieces(stroke, chunks);
+        for (std::size_t i = 1; i < stroke.points.size(); i++){
+            sf::Vector2f a = stroke.points[i - 1];
+            sf::Vector2f b = stroke.points[i];
+            ChunkCoord lo = chunkAt({std::min(a.x, b.x) - r, std::min(a.y, b.y) - r});
+            ChunkCoord hi = chunkAt({std::max(a.x, b.x) + r, std::max(a.y, b.y) + r});
+            pieces.step(lo, hi, i - 1, i, i + 1);
+        }
+        pieces.finish();
+    }
+}
+
+void compileChunkCollision(Chunk& chunk){
+    chunk.collision.clear();
+    for (const auto& stroke : chunk.strokes)
+        compileCollision(stroke, chunk.collision);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Collision.hpp"
+#include "Stroke.hpp"
+
+#define CHUNKSIZE 512 // world units per chunk side, also the baked texture size
+
+struct ChunkCoord {
+    int x;
+    int y;
+    bool operator==(const ChunkCoord& other) const { return x == other.x && y == other.y; }
+    bool operator!=(const ChunkCoord& other) const { return !(*this == other); }
+};
+
+struct ChunkCoordHash {
+    std::size_t operator()(const ChunkCoord& c) const {
+        return std::hash<long long>()(((long long)c.x << 32) ^ (unsigned int)c.y);
+    }
+};
+
+ChunkCoord chunkAt(sf::Vector2f worldPos);
+sf::FloatRect chunkBounds(ChunkCoord coord);
+
+// everything that has to be resident for a chunk to be drawn and collided with
+struct Chunk {
+    ChunkCoord coord{0, 0};
+    std::vector<Stroke> strokes;              // pieces of strokes overlapping this chunk
+    std::vector<std::uint32_t> pieceStart;    // index of each piece's first point in its parent stroke
+    std::vector<CollisionCapsule> collision;  // compiled from strokes
+    std::vector<std::uint8_t> indices;        // baked CHUNKSIZE x CHUNKSIZE palette indices from the level, often empty
+
+    void addPiece(Stroke piece, std::uint32_t start);
+
+    std::size_t getMemoryUsage() const;
+};
+
+using ChunkMap = std::unordered_map<ChunkCoord, Chunk, ChunkCoordHash>;
+
+// cuts strokes into runs of segments per chunk; a segment goes to every chunk its
+// thickened bounds touch so the baked textures line up seamlessly at the borders
+void splitIntoChunks(const std::vector<Stroke>& strokes, ChunkMap& chunks);
+void compileChunkCollision(Chunk& chunk);
+
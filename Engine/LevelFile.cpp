@@ -0,0 +1,630 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "LevelFile.hpp"
+#include "ShadowRaster.hpp"
+
+using namespace LevelFormat;
+
+MappedFile::~MappedFile(){
+    close();
+}
+
+bool MappedFile::open(const std::string& path){
+    close();
+#ifdef _WIN32
+    // shared for delete too, so a save can still replace the file while it's mapped
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0){
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping){
+        CloseHandle(file);
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data){
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_size = (std::size_t)size.QuadPart;
+    m_data = static_cast<const std::uint8_t*>(data);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0){
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (data == MAP_FAILED)
+        return false;
+    m_size = (std::size_t)st.st_size;
+    m_data = static_cast<const std::uint8_t*>(data);
+#endif
+    return true;
+}
+
+void MappedFile::close(){
+    if (!m_data)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+    m_file = nullptr;
+    m_mapping = nullptr;
+#else
+    munmap(const_cast<std::uint8_t*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool syncFile(const std::string& path){
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    bool ok = FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+    return ok;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+bool replaceFile(const std::string& from, const std::string& to){
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (std::rename(from.c_str(), to.c_str()) != 0)
+        return false;
+    // the rename itself only survives a crash once the directory holding it is on disk
+    std::size_t slash = to.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : to.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+void ChunkView::decodeStroke(std::uint32_t index, std::vector<sf::Vector2f>& out) const {
+    const StrokeRecord& record = strokes[index];
+    const PointDelta* deltas = points + record.pointOffset;
+    std::int32_t x = record.startX;
+    std::int32_t y = record.startY;
+    out.resize(record.pointCount);
+    for (std::uint32_t i = 0; i < record.pointCount; i++){
+        x += deltas[i].dx;
+        y += deltas[i].dy;
+        out[i] = {(float)x / LEVEL_QUANTIZE, (float)y / LEVEL_QUANTIZE};
+    }
+}
+
+void ChunkView::decodeStyle(std::uint32_t index, Stroke& out) const {
+    out.stamp = BrushStamp::Solid;
+    out.widths.clear();
+    out.alphas.clear();
+    if (!styles)
+        return;
+    const StrokeStyle& style = styles[index];
+    const PointStyle* point = pointStyles + style.styleOffset;
+    std::uint32_t count = strokes[index].pointCount;
+    out.stamp = (BrushStamp)style.stamp;
+    if (style.flags & LEVEL_STYLE_WIDTHS){
+        out.widths.resize(count);
+        for (std::uint32_t i = 0; i < count; i++)
+            out.widths[i] = point[i].width;
+    }
+    if (style.flags & LEVEL_STYLE_ALPHAS){
+        out.alphas.resize(count);
+        for (std::uint32_t i = 0; i < count; i++)
+            out.alphas[i] = point[i].alpha;
+    }
+}
+
+bool LevelFile::open(const std::string& path){
+    close();
+    if (!m_file.open(path))
+        return false;
+    const std::uint8_t* data = m_file.getData();
+    std::size_t size = m_file.getSize();
+
+    FileHeader header;
+    if (size < sizeof(header)){
+        close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    std::uint64_t directoryBytes = (std::uint64_t)header.chunkCount * sizeof(DirectoryEntry);
+    if (std::memcmp(header.magic, LEVEL_MAGIC, 4) != 0 || header.version < 1 || header.version > LEVEL_VERSION
+        || header.quantize != LEVEL_QUANTIZE || header.directoryOffset % 8 != 0
+        || header.directoryOffset > size || directoryBytes > size - header.directoryOffset){
+        close();
+        return false;
+    }
+    m_strokeCount = header.strokeCount;
+    m_sequence = header.sequence;
+
+    // the directory is validated once here so the per chunk accessors can trust it
+    const DirectoryEntry* directory = reinterpret_cast<const DirectoryEntry*>(data + header.directoryOffset);
+    std::uint64_t totalPoints = 0; // no piece can start past the points of the whole file
+    for (std::uint32_t i = 0; i < header.chunkCount; i++)
+        totalPoints += directory[i].pointCount;
+    for (std::uint32_t i = 0; i < header.chunkCount; i++){
+        const DirectoryEntry& entry = directory[i];
+        std::uint64_t strokeBytes = (std::uint64_t)entry.strokeCount * sizeof(StrokeRecord);
+        std::uint64_t pointBytes = (std::uint64_t)entry.pointCount * sizeof(PointDelta);
+        std::uint64_t collisionBytes = (std::uint64_t)entry.collisionCount * sizeof(CollisionCapsule);
+        if (entry.offset % 8 != 0 || entry.offset > size || entry.size > size - entry.offset
+            || strokeBytes + pointBytes + collisionBytes > entry.size){
+            close();
+            return false;
+        }
+        ChunkView view;
+        view.coord = {entry.x, entry.y};
+        view.strokes = reinterpret_cast<const StrokeRecord*>(data + entry.offset);
+        view.strokeCount = entry.strokeCount;
+        view.points = reinterpret_cast<const PointDelta*>(data + entry.offset + strokeBytes);
+        view.pointCount = entry.pointCount;
+        view.collision = reinterpret_cast<const CollisionCapsule*>(data + entry.offset + strokeBytes + pointBytes);
+        view.collisionCount = entry.collisionCount;
+        std::uint64_t pointStyleCount = 0;
+        if (header.version >= 2){
+            std::uint64_t base = strokeBytes + pointBytes + collisionBytes;
+            std::uint64_t styleBytes = (std::uint64_t)entry.strokeCount * sizeof(StrokeStyle);
+            if (styleBytes > entry.size - base){
+                close();
+                return false;
+            }
+            view.styles = reinterpret_cast<const StrokeStyle*>(data + entry.offset + base);
+            view.pointStyles = reinterpret_cast<const PointStyle*>(data + entry.offset + base + styleBytes);
+            pointStyleCount = (entry.size - base - styleBytes) / sizeof(PointStyle);
+        }
+        for (std::uint32_t s = 0; s < view.strokeCount; s++){
+            const StrokeRecord& record = view.strokes[s];
+            if (record.pointOffset > view.pointCount || record.pointCount > view.pointCount - record.pointOffset
+                || (std::uint64_t)record.firstIndex + record.pointCount > totalPoints){
+                close();
+                return false;
+            }
+            if (view.styles){
+                const StrokeStyle& style = view.styles[s];
+                if (style.stamp >= BRUSH_STAMP_VALUES || (style.flags != 0
+                    && (style.styleOffset > pointStyleCount || record.pointCount > pointStyleCount - style.styleOffset))){
+                    close();
+                    return false;
+                }
+            }
+        }
+        m_coords.push_back(view.coord);
+        m_chunks[view.coord] = view;
+    }
+
+    if (header.version >= 3 && header.headerSize >= sizeof(FileHeader) + sizeof(RasterHeader)){
+        RasterHeader rasters;
+        std::memcpy(&rasters, data + sizeof(FileHeader), sizeof(rasters));
+        std::uint64_t paletteBytes = (std::uint64_t)rasters.paletteSize * sizeof(std::uint32_t);
+        std::uint64_t entryBytes = (std::uint64_t)rasters.rasterCount * sizeof(RasterEntry);
+        if (rasters.paletteSize > LEVEL_PALETTE_SIZE || rasters.paletteOffset > size || paletteBytes > size - rasters.paletteOffset
+            || rasters.rasterOffset % 8 != 0 || rasters.rasterOffset > size || entryBytes > size - rasters.rasterOffset){
+            close();
+            return false;
+        }
+        for (std::uint32_t i = 0; i < rasters.paletteSize; i++){
+            std::uint32_t color;
+            std::memcpy(&color, data + rasters.paletteOffset + i * sizeof(color), sizeof(color));
+            m_palette.push_back(sf::Color(color));
+        }
+        const RasterEntry* entries = reinterpret_cast<const RasterEntry*>(data + rasters.rasterOffset);
+        for (std::uint32_t i = 0; i < rasters.rasterCount; i++){
+            const RasterEntry& entry = entries[i];
+            if (entry.offset > size || entry.size > size - entry.offset || entry.size % 2 != 0){
+                close();
+                return false;
+            }
+            m_rasters[{entry.x, entry.y}] = entry;
+        }
+    }
+    return true;
+}
+
+void LevelFile::close(){
+    m_file.close();
+    m_strokeCount = 0;
+    m_sequence = 0;
+    m_coords.clear();
+    m_chunks.clear();
+    m_palette.clear();
+    m_rasters.clear();
+}
+
+bool LevelFile::getChunkView(ChunkCoord coord, ChunkView& view) const {
+    auto it = m_chunks.find(coord);
+    if (it == m_chunks.end())
+        return false;
+    view = it->second;
+    return true;
+}
+
+bool LevelFile::loadChunk(ChunkCoord coord, Chunk& chunk) const {
+    ChunkView view;
+    if (!getChunkView(coord, view))
+        return false;
+    chunk.coord = coord;
+    chunk.strokes.resize(view.strokeCount);
+    chunk.pieceStart.resize(view.strokeCount);
+    for (std::uint32_t i = 0; i < view.strokeCount; i++){
+        const StrokeRecord& record = view.strokes[i];
+        Stroke& stroke = chunk.strokes[i];
+        stroke.id = record.id;
+        stroke.color = sf::Color(record.color);
+        stroke.thickness = record.thickness;
+        view.decodeStroke(i, stroke.points);
+        view.decodeStyle(i, stroke);
+        chunk.pieceStart[i] = record.firstIndex;
+    }
+    chunk.collision.assign(view.collision, view.collision + view.collisionCount);
+    if (!loadChunkIndices(coord, chunk.indices))
+        chunk.indices.clear();
+    return true;
+}
+
+bool LevelFile::loadChunkIndices(ChunkCoord coord, std::vector<std::uint8_t>& indices) const {
+    auto it = m_rasters.find(coord);
+    if (it == m_rasters.end())
+        return false;
+    const std::uint8_t* runs = m_file.getData() + it->second.offset;
+    const std::size_t total = (std::size_t)CHUNKSIZE * CHUNKSIZE;
+    indices.resize(total);
+    std::size_t filled = 0;
+    for (std::uint32_t i = 0; i + 1 < it->second.size; i += 2){
+        std::size_t length = (std::size_t)runs[i] + 1;
+        std::uint8_t index = runs[i + 1];
+        if (length > total - filled || index >= m_palette.size())
+            return false;
+        std::memset(indices.data() + filled, index, length);
+        filled += length;
+    }
+    return filled == total;
+}
+
+bool LevelFile::loadStrokes(std::vector<Stroke>& strokes) const {
+    struct PieceRef {
+        std::uint32_t firstIndex;
+        const ChunkView* view;
+        std::uint32_t index;
+    };
+    std::map<std::uint32_t, std::vector<PieceRef>> byId; // ids are in draw order
+    for (const auto& coord : m_coords){
+        const ChunkView& view = m_chunks.at(coord);
+        for (std::uint32_t i = 0; i < view.strokeCount; i++)
+            byId[view.strokes[i].id].push_back({view.strokes[i].firstIndex, &view, i});
+    }
+    // pieces are stitched in stroke order, each one adding whatever goes past the previous ones.
+    // a piece missing from a damaged file closes up instead of leaving points at the origin
+    strokes.reserve(strokes.size() + byId.size());
+    Stroke piece;
+    for (auto& [id, pieces] : byId){
+        std::sort(pieces.begin(), pieces.end(), [](const PieceRef& a, const PieceRef& b){ return a.firstIndex < b.firstIndex; });
+        const StrokeRecord& first = pieces[0].view->strokes[pieces[0].index];
+        Stroke stroke;
+        stroke.id = id;
+        stroke.color = sf::Color(first.color);
+        stroke.thickness = first.thickness;
+        for (const PieceRef& ref : pieces){
+            ref.view->decodeStroke(ref.index, piece.points);
+            ref.view->decodeStyle(ref.index, piece);
+            std::size_t have = stroke.points.size();
+            std::size_t skip = ref.firstIndex < have ? have - ref.firstIndex : 0;
+            if (skip >= piece.points.size())
+                continue;
+            stroke.stamp = piece.stamp;
+            stroke.points.insert(stroke.points.end(), piece.points.begin() + skip, piece.points.end());
+            if (!piece.widths.empty()){
+                stroke.widths.resize(have, 255);
+                stroke.widths.insert(stroke.widths.end(), piece.widths.begin() + skip, piece.widths.end());
+            }
+            if (!piece.alphas.empty()){
+                stroke.alphas.resize(have, 255);
+                stroke.alphas.insert(stroke.alphas.end(), piece.alphas.begin() + skip, piece.alphas.end());
+            }
+        }
+        if (!stroke.widths.empty())
+            stroke.widths.resize(stroke.points.size(), 255);
+        if (!stroke.alphas.empty())
+            stroke.alphas.resize(stroke.points.size(), 255);
+        strokes.push_back(std::move(stroke));
+    }
+    return true;
+}
+
+static std::int32_t quantize(float v){
+    return (std::int32_t)std::lround(v * LEVEL_QUANTIZE);
+}
+
+// deltas are 16 bit, so split any segment that is too long for one
+static Stroke fitDeltas(const Stroke& stroke){
+    const float maxStep = 32000.f / LEVEL_QUANTIZE;
+    Stroke out = stroke;
+    out.points.clear();
+    out.widths.clear();
+    out.alphas.clear();
+    if (stroke.stamp == BrushStamp::Fill){
+        // corners can't be interpolated: big rectangles are cut into tiles, and long jumps between
+        // them are bridged with empty rectangles, which draw and collide with nothing
+        auto bridgeTo = [&out, maxStep](sf::Vector2f to){
+            while (!out.points.empty()){
+                sf::Vector2f from = out.points.back();
+                sf::Vector2f d = to - from;
+                float longest = std::max(std::abs(d.x), std::abs(d.y));
+                if (longest <= maxStep)
+                    break;
+                sf::Vector2f step = from + d * (maxStep / longest);
+                out.points.push_back(step);
+                out.points.push_back(step);
+            }
+        };
+        for (std::size_t i = 0; i + 1 < stroke.points.size(); i += 2){
+            sf::Vector2f a = stroke.points[i];
+            sf::Vector2f b = stroke.points[i + 1];
+            for (float y = a.y; ; y += maxStep){
+                for (float x = a.x; ; x += maxStep){
+                    bridgeTo({x, y});
+                    out.points.push_back({x, y});
+                    out.points.push_back({std::min(x + maxStep, b.x), std::min(y + maxStep, b.y)});
+                    if (x + maxStep >= b.x)
+                        break;
+                }
+                if (y + maxStep >= b.y)
+                    break;
+            }
+        }
+        return out;
+    }
+    auto lerp = [](std::uint8_t a, std::uint8_t b, float t){ return (std::uint8_t)std::lround(a + (b - a) * t); };
+    for (std::size_t i = 0; i < stroke.points.size(); i++){
+        if (i > 0){
+            sf::Vector2f a = stroke.points[i - 1];
+            sf::Vector2f d = stroke.points[i] - a;
+            int parts = (int)std::ceil(std::max(std::abs(d.x), std::abs(d.y)) / maxStep);
+            for (int k = 1; k < parts; k++){
+                float t = (float)k / parts;
+                out.points.push_back(a + d * t);
+                if (!stroke.widths.empty())
+                    out.widths.push_back(lerp(stroke.widths[i - 1], stroke.widths[i], t));
+                if (!stroke.alphas.empty())
+                    out.alphas.push_back(lerp(stroke.alphas[i - 1], stroke.alphas[i], t));
+            }
+        }
+        out.points.push_back(stroke.points[i]);
+        if (!stroke.widths.empty())
+            out.widths.push_back(stroke.widths[i]);
+        if (!stroke.alphas.empty())
+            out.alphas.push_back(stroke.alphas[i]);
+    }
+    return out;
+}
+
+template <typename T>
+static void writeRaw(std::ofstream& out, const T* values, std::size_t count){
+    out.write(reinterpret_cast<const char*>(values), count * sizeof(T));
+}
+
+static void pad(std::ofstream& out, std::uint64_t& offset){
+    static const char zeros[8] = {};
+    std::uint64_t padding = (8 - offset % 8) % 8;
+    out.write(zeros, padding);
+    offset += padding;
+}
+
+// chunks whose every piece the GPU would draw in one flat colour, which is what an index can hold
+static bool isIndexable(const Chunk& chunk){
+    for (const auto& stroke : chunk.strokes){
+        if ((stroke.stamp != BrushStamp::Solid && stroke.stamp != BrushStamp::Fill) || !stroke.alphas.empty() || stroke.color.a != 255)
+            return false;
+    }
+    return !chunk.strokes.empty();
+}
+
+static void encodeRuns(const std::vector<std::uint8_t>& indices, std::vector<std::uint8_t>& out){
+    out.clear();
+    for (std::size_t i = 0; i < indices.size();){
+        std::size_t run = 1;
+        while (run < 256 && i + run < indices.size() && indices[i + run] == indices[i])
+            run++;
+        out.push_back((std::uint8_t)(run - 1));
+        out.push_back(indices[i]);
+        i += run;
+    }
+}
+
+bool saveLevelFile(const std::string& path, const std::vector<Stroke>& strokes, std::uint32_t sequence, bool rasters){
+    std::vector<Stroke> fitted;
+    fitted.reserve(strokes.size());
+    for (const auto& stroke : strokes)
+        fitted.push_back(fitDeltas(stroke));
+    ChunkMap chunks;
+    splitIntoChunks(fitted, chunks);
+
+    // stable chunk order so identical drawings produce identical files
+    std::vector<Chunk*> ordered;
+    for (auto& [coord, chunk] : chunks){
+        compileChunkCollision(chunk);
+        ordered.push_back(&chunk);
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const Chunk* a, const Chunk* b){
+        return a->coord.y != b->coord.y ? a->coord.y < b->coord.y : a->coord.x < b->coord.x;
+    });
+
+    // written next to the target and renamed over it, so a crash never leaves half a level behind
+    std::string tempPath = path + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    FileHeader header{};
+    std::memcpy(header.magic, LEVEL_MAGIC, 4);
+    header.version = LEVEL_VERSION;
+    header.headerSize = sizeof(FileHeader) + sizeof(RasterHeader);
+    header.quantize = LEVEL_QUANTIZE;
+    header.chunkCount = (std::uint32_t)ordered.size();
+    header.strokeCount = (std::uint32_t)strokes.size();
+    header.sequence = sequence;
+    RasterHeader rasterHeader{};
+    writeRaw(out, &header, 1);
+    writeRaw(out, &rasterHeader, 1);
+    std::uint64_t offset = sizeof(FileHeader) + sizeof(RasterHeader);
+
+    std::vector<DirectoryEntry> directory;
+    std::vector<StrokeRecord> records;
+    std::vector<PointDelta> deltas;
+    std::vector<StrokeStyle> styles;
+    std::vector<PointStyle> pointStyles;
+    for (const Chunk* chunk : ordered){
+        records.clear();
+        deltas.clear();
+        styles.clear();
+        pointStyles.clear();
+        for (std::size_t i = 0; i < chunk->strokes.size(); i++){
+            const Stroke& stroke = chunk->strokes[i];
+            StrokeRecord record{};
+            record.id = stroke.id;
+            record.firstIndex = chunk->pieceStart[i];
+            record.color = stroke.color.toInteger();
+            record.thickness = stroke.thickness;
+            record.pointOffset = (std::uint32_t)deltas.size();
+            record.pointCount = (std::uint32_t)stroke.points.size();
+            if (!stroke.points.empty()){
+                record.startX = quantize(stroke.points[0].x);
+                record.startY = quantize(stroke.points[0].y);
+            }
+            std::int32_t x = record.startX;
+            std::int32_t y = record.startY;
+            for (const auto& p : stroke.points){
+                std::int32_t qx = quantize(p.x);
+                std::int32_t qy = quantize(p.y);
+                deltas.push_back({(std::int16_t)(qx - x), (std::int16_t)(qy - y)});
+                x = qx;
+                y = qy;
+            }
+            records.push_back(record);
+            StrokeStyle style{};
+            style.stamp = (std::uint8_t)stroke.stamp;
+            style.flags = (stroke.widths.empty() ? 0 : LEVEL_STYLE_WIDTHS) | (stroke.alphas.empty() ? 0 : LEVEL_STYLE_ALPHAS);
+            style.styleOffset = (std::uint32_t)pointStyles.size();
+            if (style.flags != 0){
+                for (std::size_t p = 0; p < stroke.points.size(); p++)
+                    pointStyles.push_back({stroke.widths.empty() ? (std::uint8_t)255 : stroke.widths[p], stroke.alphas.empty() ? (std::uint8_t)255 : stroke.alphas[p]});
+            }
+            styles.push_back(style);
+        }
+        DirectoryEntry entry{};
+        entry.x = chunk->coord.x;
+        entry.y = chunk->coord.y;
+        entry.offset = offset;
+        entry.strokeCount = (std::uint32_t)records.size();
+        entry.pointCount = (std::uint32_t)deltas.size();
+        entry.collisionCount = (std::uint32_t)chunk->collision.size();
+        writeRaw(out, records.data(), records.size());
+        writeRaw(out, deltas.data(), deltas.size());
+        writeRaw(out, chunk->collision.data(), chunk->collision.size());
+        writeRaw(out, styles.data(), styles.size());
+        writeRaw(out, pointStyles.data(), pointStyles.size());
+        entry.size = (std::uint32_t)(records.size() * sizeof(StrokeRecord) + deltas.size() * sizeof(PointDelta)
+            + chunk->collision.size() * sizeof(CollisionCapsule) + styles.size() * sizeof(StrokeStyle) + pointStyles.size() * sizeof(PointStyle));
+        offset += entry.size;
+        pad(out, offset);
+        directory.push_back(entry);
+    }
+    header.directoryOffset = offset;
+    writeRaw(out, directory.data(), directory.size());
+    offset += directory.size() * sizeof(DirectoryEntry);
+
+    if (rasters){
+        // every indexable chunk is drawn into one indexed raster, so they share its palette. a chunk
+        // is left out if it has a colour that didn't get an index of its own
+        ShadowRaster raster(sf::Color::Transparent, ShadowFormat::Indexed);
+        std::vector<RasterEntry> entries;
+        std::vector<std::uint8_t> indices((std::size_t)CHUNKSIZE * CHUNKSIZE);
+        std::vector<std::uint8_t> runs;
+        for (const Chunk* chunk : ordered){
+            if (!isIndexable(*chunk))
+                continue;
+            bool exact = true;
+            for (const auto& stroke : chunk->strokes)
+                exact &= raster.getPalette()[raster.getIndex(stroke.color)] == stroke.color;
+            if (!exact)
+                continue;
+            raster.clear();
+            for (const auto& stroke : chunk->strokes)
+                raster.drawStroke(stroke);
+            sf::FloatRect bounds = chunkBounds(chunk->coord);
+            raster.readIndices(sf::IntRect(sf::Vector2i(bounds.position), {CHUNKSIZE, CHUNKSIZE}), indices.data());
+            encodeRuns(indices, runs);
+            RasterEntry entry{};
+            entry.x = chunk->coord.x;
+            entry.y = chunk->coord.y;
+            entry.offset = offset;
+            entry.size = (std::uint32_t)runs.size();
+            writeRaw(out, runs.data(), runs.size());
+            offset += runs.size();
+            entries.push_back(entry);
+        }
+        pad(out, offset);
+        rasterHeader.paletteOffset = offset;
+        rasterHeader.paletteSize = (std::uint32_t)raster.getPalette().size();
+        for (const sf::Color& color : raster.getPalette()){
+            std::uint32_t value = color.toInteger();
+            writeRaw(out, &value, 1);
+        }
+        offset += raster.getPalette().size() * sizeof(std::uint32_t);
+        pad(out, offset);
+        rasterHeader.rasterOffset = offset;
+        rasterHeader.rasterCount = (std::uint32_t)entries.size();
+        writeRaw(out, entries.data(), entries.size());
+    }
+    out.seekp(0);
+    writeRaw(out, &header, 1);
+    writeRaw(out, &rasterHeader, 1);
+    out.close();
+    if (!out || !syncFile(tempPath))
+        return false;
+
+    return replaceFile(tempPath, path);
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Level.hpp"
+
+// .pzl level file, little endian:
+//   FileHeader
+//   chunk sections, each 8 byte aligned: StrokeRecord[n], PointDelta[points], CollisionCapsule[collision],
+//     then since version 2 StrokeStyle[n], PointStyle[points of the strokes that vary]
+//   DirectoryEntry[chunkCount] at header.directoryOffset
+//   since version 3, a RasterHeader right after the FileHeader (headerSize covers it), pointing at a
+//     palette and at RasterEntry[rasterCount]: chunks drawn only in opaque, untextured colours also
+//     carry their baked pixels as run length coded palette indices, so they can be drawn without
+//     baking and with a quarter of the texture memory (see ChunkStreamer)
+// points are quantized to 1/LEVEL_QUANTIZE units and stored as deltas from the previous point of the
+// same piece, the first delta is relative to the record's start position
+
+#define LEVEL_MAGIC "PZLV"
+#define LEVEL_VERSION 3
+#define LEVEL_QUANTIZE 8
+#define LEVEL_STYLE_WIDTHS 1
+#define LEVEL_STYLE_ALPHAS 2
+#define LEVEL_PALETTE_SIZE 256
+
+namespace LevelFormat {
+    struct FileHeader {
+        char magic[4];
+        std::uint16_t version;
+        std::uint16_t headerSize;
+        std::uint32_t quantize;        // steps per world unit
+        std::uint32_t chunkCount;
+        std::uint32_t strokeCount;     // strokes before splitting
+        std::uint32_t sequence;        // last journal record folded into this file, 0 for plain saves
+        std::uint64_t directoryOffset;
+    };
+
+    struct DirectoryEntry {
+        std::int32_t x;
+        std::int32_t y;
+        std::uint64_t offset;
+        std::uint32_t size;
+        std::uint32_t strokeCount;
+        std::uint32_t pointCount;
+        std::uint32_t collisionCount;
+    };
+
+    struct StrokeRecord {
+        std::uint32_t id;
+        std::uint32_t firstIndex;  // where this piece starts in the original stroke
+        std::uint32_t color;       // sf::Color::toInteger
+        float thickness;
+        std::int32_t startX;       // quantized
+        std::int32_t startY;
+        std::uint32_t pointOffset; // into the chunk's PointDelta array
+        std::uint32_t pointCount;
+    };
+
+    struct PointDelta {
+        std::int16_t dx;
+        std::int16_t dy;
+    };
+
+    struct StrokeStyle {
+        std::uint8_t stamp;        // BrushStamp
+        std::uint8_t flags;        // LEVEL_STYLE_*, without either the stroke has no PointStyles
+        std::uint16_t reserved;
+        std::uint32_t styleOffset; // into the chunk's PointStyle array, one per point
+    };
+
+    struct PointStyle {
+        std::uint8_t width; // Stroke::widths / alphas, 255 when the stroke doesn't vary it
+        std::uint8_t alpha;
+    };
+
+    struct RasterHeader {
+        std::uint64_t paletteOffset; // std::uint32_t colours (sf::Color::toInteger), [0] is transparent
+        std::uint64_t rasterOffset;  // RasterEntry[rasterCount]
+        std::uint32_t paletteSize;
+        std::uint32_t rasterCount;
+    };
+
+    // a chunk's CHUNKSIZE x CHUNKSIZE indices, row major, as (run length - 1, index) byte pairs
+    struct RasterEntry {
+        std::int32_t x;
+        std::int32_t y;
+        std::uint64_t offset;
+        std::uint32_t size;
+        std::uint32_t reserved;
+    };
+
+    static_assert(sizeof(FileHeader) == 32, "level header layout changed");
+    static_assert(sizeof(DirectoryEntry) == 32, "level directory layout changed");
+    static_assert(sizeof(StrokeRecord) == 32, "level stroke record layout changed");
+    static_assert(sizeof(CollisionCapsule) == 20, "collision capsule layout changed");
+    static_assert(sizeof(StrokeStyle) == 8, "level stroke style layout changed");
+    static_assert(sizeof(PointStyle) == 2, "level point style layout changed");
+    static_assert(sizeof(RasterHeader) == 24, "level raster header layout changed");
+    static_assert(sizeof(RasterEntry) == 24, "level raster entry layout changed");
+}
+
+// read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    const std::uint8_t* getData() const { return m_data; }
+    std::size_t getSize() const { return m_size; }
+
+private:
+    const std::uint8_t* m_data = nullptr;
+    std::size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+// flushes a closed file's contents to disk, used before renaming something over a good copy
+bool syncFile(const std::string& path);
+
+// moves from over to in one step, an existing file included, and flushes the move to disk
+bool replaceFile(const std::string& from, const std::string& to);
+
+// zero-copy view of one chunk section inside a mapped level
+struct ChunkView {
+    ChunkCoord coord{0, 0};
+    const LevelFormat::StrokeRecord* strokes = nullptr;
+    std::uint32_t strokeCount = 0;
+    const LevelFormat::PointDelta* points = nullptr;
+    std::uint32_t pointCount = 0;
+    const CollisionCapsule* collision = nullptr;
+    std::uint32_t collisionCount = 0;
+    const LevelFormat::StrokeStyle* styles = nullptr; // null in version 1 files, everything is solid
+    const LevelFormat::PointStyle* pointStyles = nullptr;
+
+    void decodeStroke(std::uint32_t index, std::vector<sf::Vector2f>& out) const;
+    void decodeStyle(std::uint32_t index, Stroke& out) const; // stamp, widths and alphas for the record's points
+};
+
+class LevelFile {
+public:
+    bool open(const std::string& path); // maps the file and validates the header and directory
+    void close();
+    bool isOpen() const { return m_file.getData() != nullptr; }
+
+    const std::vector<ChunkCoord>& getChunkCoords() const { return m_coords; }
+    std::uint32_t getStrokeCount() const { return m_strokeCount; }
+    std::uint32_t getSequence() const { return m_sequence; }
+    bool getChunkView(ChunkCoord coord, ChunkView& view) const;
+    bool loadChunk(ChunkCoord coord, Chunk& chunk) const; // decodes strokes and indices, collision is already compiled
+    // the chunk's baked palette indices, false when the level has none for it
+    bool loadChunkIndices(ChunkCoord coord, std::vector<std::uint8_t>& indices) const;
+    const std::vector<sf::Color>& getPalette() const { return m_palette; } // empty without rasters
+    bool loadStrokes(std::vector<Stroke>& strokes) const; // stitches pieces back into whole strokes
+
+private:
+    MappedFile m_file;
+    std::uint32_t m_strokeCount = 0;
+    std::uint32_t m_sequence = 0;
+    std::vector<ChunkCoord> m_coords;
+    std::unordered_map<ChunkCoord, ChunkView, ChunkCoordHash> m_chunks;
+    std::vector<sf::Color> m_palette;
+    std::unordered_map<ChunkCoord, LevelFormat::RasterEntry, ChunkCoordHash> m_rasters;
+};
+
+// rasters bakes the chunks that can be indexed into the file as well, which costs a CPU raster of
+// each; the journal's compactions leave it off
+bool saveLevelFile(const std::string& path, const std::vector<Stroke>& strokes, std::uint32_t sequence = 0, bool rasters = false);
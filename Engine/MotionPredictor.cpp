@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cmath>
+
+#include "MotionPredictor.hpp"
+
+#define PREDICTION_VELOCITY_TAU 0.02f     // seconds, smoothing of the velocity
+#define PREDICTION_ACCELERATION_TAU 0.04f // acceleration is noisier, so smoothed more
+
+void MotionPredictor::reset(){
+    m_samples = 0;
+    m_velocity = sf::Vector2f();
+    m_acceleration = sf::Vector2f();
+    m_pending = false;
+}
+
+void MotionPredictor::addSample(sf::Vector2f pos, float time){
+    if (m_samples > 0 && time <= m_time)
+        return;
+    if (m_pending && time >= m_guessTime){
+        // where the pointer was at the guessed moment, on the way between the two samples
+        float t = (m_guessTime - m_time) / (time - m_time);
+        score(m_position + (pos - m_position) * std::clamp(t, 0.f, 1.f));
+    }
+    if (m_samples > 0){
+        float dt = time - m_time;
+        sf::Vector2f velocity = (pos - m_position) / dt;
+        // a long gap means the pointer paused, don't treat the jump as acceleration
+        if (dt > PREDICTION_STALE_AFTER || m_samples == 1){
+            m_acceleration = sf::Vector2f();
+            m_velocity = velocity;
+        } else {
+            float blend = 1.f - std::exp(-dt / PREDICTION_VELOCITY_TAU);
+            sf::Vector2f filtered = m_velocity + (velocity - m_velocity) * blend;
+            sf::Vector2f acceleration = (filtered - m_velocity) / dt;
+            m_acceleration += (acceleration - m_acceleration) * (1.f - std::exp(-dt / PREDICTION_ACCELERATION_TAU));
+            m_velocity = filtered;
+        }
+    }
+    m_position = pos;
+    m_time = time;
+    m_samples++;
+}
+
+sf::Vector2f MotionPredictor::predict(float now, float latency){
+    if (m_samples < 2 || now - m_time > PREDICTION_STALE_AFTER)
+        return m_position;
+    float ahead = std::min(now + latency - m_time, PREDICTION_MAX_AHEAD);
+    if (ahead <= 0.f)
+        return m_position;
+    sf::Vector2f offset = m_velocity * ahead + m_acceleration * (0.5f * ahead * ahead);
+    // acceleration can't more than double the distance plain velocity would cover, which keeps
+    // sudden stops from flinging the tail out
+    float limit = std::sqrt(m_velocity.x * m_velocity.x + m_velocity.y * m_velocity.y) * ahead * 2.f;
+    float length = std::sqrt(offset.x * offset.x + offset.y * offset.y);
+    if (length > limit && length > 0.f)
+        offset *= limit / length;
+    // one guess is scored at a time, the rest are only drawn
+    if (!m_pending){
+        m_pending = true;
+        m_guess = m_position + offset;
+        m_guessTime = m_time + ahead;
+    }
+    return m_position + offset;
+}
+
+void MotionPredictor::score(sf::Vector2f actual){
+    m_pending = false;
+    sf::Vector2f d = actual - m_guess;
+    float error = std::sqrt(d.x * d.x + d.y * d.y);
+    m_stats.count++;
+    m_stats.meanError += (error - m_stats.meanError) / m_stats.count;
+    m_squaredSum += error * error;
+    m_stats.rmsError = std::sqrt(m_squaredSum / m_stats.count);
+    m_stats.maxError = std::max(m_stats.maxError, error);
+}
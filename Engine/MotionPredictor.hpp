@@ -0,0 +1,43 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+
+#define PREDICTION_MAX_AHEAD 0.05f   // seconds, further than this the guess is worse than nothing
+#define PREDICTION_STALE_AFTER 0.05f // seconds without a sample before the pointer counts as stopped
+
+struct PredictionStats {
+    std::uint32_t count = 0; // predictions scored against where the pointer really went
+    float meanError = 0.f;   // world units
+    float rmsError = 0.f;
+    float maxError = 0.f;
+};
+
+// guesses where the pointer will be a moment from now, from exponentially filtered velocity and
+// acceleration, so ink can be drawn up to there before the samples arrive. every guess is scored
+// once the real position for that moment is known
+class MotionPredictor {
+public:
+    void reset(); // keeps the stats
+    void addSample(sf::Vector2f pos, float time); // time in seconds, increasing
+    // the position at now + latency, or the last sample when there's nothing to go on
+    sf::Vector2f predict(float now, float latency);
+
+    const PredictionStats& getStats() const { return m_stats; }
+    void resetStats(){ m_stats = PredictionStats(); m_squaredSum = 0.f; }
+
+private:
+    void score(sf::Vector2f actual);
+
+    std::uint32_t m_samples = 0;
+    sf::Vector2f m_position;
+    sf::Vector2f m_velocity;     // units per second, filtered
+    sf::Vector2f m_acceleration; // units per second², filtered
+    float m_time = 0.f;
+
+    bool m_pending = false; // the guess being scored, waiting for a sample at or past its time
+    sf::Vector2f m_guess;
+    float m_guessTime = 0.f;
+
+    PredictionStats m_stats;
+    float m_squaredSum = 0.f;
+};
@@ -0,0 +1,25 @@
+#include <cmath>
+
+#include "OneEuroFilter.hpp"
+
+float OneEuroFilter::alpha(float cutoff) const {
+    float tau = 1.f / (2.f * 3.14159265f * cutoff);
+    return 1.f / (1.f + tau * m_settings.rate);
+}
+
+void OneEuroFilter::reset(sf::Vector2f pos){
+    m_value = pos;
+    m_derivative = sf::Vector2f();
+}
+
+sf::Vector2f OneEuroFilter::filter(sf::Vector2f pos){
+    if (!m_settings.enabled){
+        m_value = pos;
+        return pos;
+    }
+    sf::Vector2f derivative = (pos - m_value) * m_settings.rate;
+    m_derivative += (derivative - m_derivative) * alpha(m_settings.derivativeCutoff);
+    float speed = std::sqrt(m_derivative.x * m_derivative.x + m_derivative.y * m_derivative.y);
+    m_value += (pos - m_value) * alpha(m_settings.minCutoff + m_settings.beta * speed);
+    return m_value;
+}
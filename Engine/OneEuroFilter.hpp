@@ -0,0 +1,29 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+
+// One Euro filter (Casiez et al. 2012): a low pass whose cutoff rises with speed, so a slow hand
+// loses its jitter and a fast one doesn't lag. samples count as 1/rate seconds apart whenever they
+// really came, like the builder's speed, so a replay at any rate smooths the same way
+struct OneEuroSettings {
+    bool enabled = true;
+    float minCutoff = 1.f;         // Hz, smoothing when still, lower is smoother
+    float beta = 0.01f;            // cutoff added per unit/second of speed, higher lags less
+    float derivativeCutoff = 1.f;  // Hz, for the speed estimate itself
+    float rate = 120.f;            // samples per second
+};
+
+class OneEuroFilter {
+public:
+    void setSettings(const OneEuroSettings& settings){ m_settings = settings; }
+    const OneEuroSettings& getSettings() const { return m_settings; }
+
+    void reset(sf::Vector2f pos);
+    sf::Vector2f filter(sf::Vector2f pos); // passes pos through untouched when disabled
+
+private:
+    float alpha(float cutoff) const;
+
+    OneEuroSettings m_settings;
+    sf::Vector2f m_value;
+    sf::Vector2f m_derivative; // filtered, units per second
+};
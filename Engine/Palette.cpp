@@ -0,0 +1,255 @@
+#include <SFML/Graphics.hpp>
+#include <TGUI/TGUI.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Palette.hpp"
+
+#define PALETTE_DISC_SIZE 64u
+
+Palette::Palette(float radius, float spacing)
+    : tgui::ClickableWidget(StaticWidgetType, true), m_radius(radius), m_spacing(spacing),
+      m_atlasImage({PALETTE_DISC_SIZE, PALETTE_DISC_SIZE}, sf::Color::Transparent)
+{
+    // antialiased white disc, tinted per swatch by the vertex colour
+    float center = PALETTE_DISC_SIZE / 2.f;
+    for (unsigned int y = 0; y < PALETTE_DISC_SIZE; y++){
+        for (unsigned int x = 0; x < PALETTE_DISC_SIZE; x++){
+            float distance = std::hypot(x + 0.5f - center, y + 0.5f - center);
+            float coverage = std::clamp(center - 0.5f - distance, 0.f, 1.f);
+            m_atlasImage.setPixel({x, y}, sf::Color(255, 255, 255, (std::uint8_t)(coverage * 255)));
+        }
+    }
+}
+
+Palette::Palette(const Palette& other)
+    : tgui::ClickableWidget(other), onSwatchClick(other.onSwatchClick), m_model(other.m_model), m_radius(other.m_radius), m_spacing(other.m_spacing),
+      m_nextX(other.m_nextX), m_width(other.m_width), m_columns(other.m_columns), m_column(other.m_column), m_row(other.m_row),
+      m_outlineThickness(other.m_outlineThickness), m_outlineColor(other.m_outlineColor), m_swatches(other.m_swatches),
+      m_vertices(other.m_vertices), m_indices(other.m_indices), m_atlasImage(other.m_atlasImage), m_atlas(other.m_atlas)
+{
+    // the copy needs its own observer, the hover stays with the original
+    if (m_model)
+        m_observer = m_model->addObserver([this](PaletteModel::Change change, std::size_t index, std::size_t previous){ onModelChanged(change, index, previous); });
+    if (other.m_hovered != PALETTE_NO_SELECTION)
+        writeSwatch(other.m_hovered);
+}
+
+Palette::~Palette(){
+    if (m_model)
+        m_model->removeObserver(m_observer);
+}
+
+Palette::Ptr Palette::create(float radius, float spacing){
+    return std::make_shared<Palette>(radius, spacing);
+}
+
+void Palette::setModel(std::shared_ptr<PaletteModel> model){
+    if (m_model)
+        m_model->removeObserver(m_observer);
+    clearSwatches();
+    m_model = std::move(model);
+    if (!m_model)
+        return;
+    m_observer = m_model->addObserver([this](PaletteModel::Change change, std::size_t index, std::size_t previous){ onModelChanged(change, index, previous); });
+    for (std::size_t i = 0; i < m_model->getColorCount(); i++)
+        addSwatch();
+}
+
+void Palette::onModelChanged(PaletteModel::Change change, std::size_t index, std::size_t previous){
+    switch (change){
+        case PaletteModel::Change::Added:
+            addSwatch();
+            break;
+        case PaletteModel::Change::Recolored:
+            writeSwatch(index);
+            break;
+        case PaletteModel::Change::Selected:
+            if (previous != PALETTE_NO_SELECTION)
+                writeSwatch(previous);
+            if (index != PALETTE_NO_SELECTION)
+                writeSwatch(index);
+            break;
+        case PaletteModel::Change::Cleared:
+            clearSwatches();
+            break;
+    }
+}
+
+void Palette::addSwatch(){
+    float extent = m_radius + m_outlineThickness;
+    if (m_columns > 0 && m_column == m_columns){
+        m_row++;
+        m_column = 0;
+        m_nextX = 0.f;
+    }
+    Swatch swatch;
+    swatch.row = m_row;
+    swatch.center = {m_nextX + extent, m_row * (extent * 2.f + m_spacing) + extent};
+    m_nextX += extent * 2.f + m_spacing;
+    m_column++;
+    m_width = std::max(m_width, m_nextX - m_spacing);
+    m_swatches.push_back(swatch);
+    m_vertices.resize(m_swatches.size() * 12);
+    unsigned int base = (unsigned int)(m_swatches.size() - 1) * 12;
+    for (unsigned int quad = 0; quad < 3; quad++){
+        unsigned int v = base + quad * 4;
+        for (unsigned int index : {v, v + 1, v + 2, v, v + 2, v + 3})
+            m_indices.push_back(index);
+    }
+    setSize({m_width, (m_row + 1) * (extent * 2.f + m_spacing) - m_spacing});
+    writeSwatch(m_swatches.size() - 1);
+}
+
+void Palette::clearSwatches(){
+    m_swatches.clear();
+    m_vertices.clear();
+    m_indices.clear();
+    m_nextX = 0.f;
+    m_width = 0.f;
+    m_column = 0;
+    m_row = 0;
+    m_hovered = PALETTE_NO_SELECTION;
+    setSize({0.f, 0.f});
+}
+
+void Palette::addSpacing(float width){
+    m_nextX += width;
+}
+
+void Palette::setColumns(std::size_t columns){
+    m_columns = columns;
+}
+
+void Palette::setOutline(sf::Color color, float thickness){
+    m_outlineColor = color;
+    m_outlineThickness = thickness;
+    if (m_model && m_model->getSelected() < m_swatches.size())
+        writeSwatch(m_model->getSelected());
+}
+
+void Palette::setSwatchIcon(std::size_t index, const sf::Image& icon){
+    if (index >= m_swatches.size())
+        return;
+    // icons go in a row to the right of the disc
+    sf::Vector2u oldSize = m_atlasImage.getSize();
+    sf::Vector2u iconSize = icon.getSize();
+    sf::Image grown({oldSize.x + iconSize.x, std::max(oldSize.y, iconSize.y)}, sf::Color::Transparent);
+    if (!grown.copy(m_atlasImage, {0, 0}) || !grown.copy(icon, {oldSize.x, 0}))
+        return;
+    m_atlasImage = std::move(grown);
+    m_atlas = nullptr;
+    m_swatches[index].iconRect = sf::FloatRect({(float)oldSize.x, 0.f}, sf::Vector2f(iconSize));
+    // the atlas changed size, and with it every swatch's texture coordinates
+    for (std::size_t i = 0; i < m_swatches.size(); i++)
+        writeSwatch(i);
+}
+
+void Palette::writeSwatch(std::size_t index){
+    const Swatch& swatch = m_swatches[index];
+    sf::Color color = m_model->getColor(index);
+    if (index == m_hovered){
+        // nudge towards grey so black and white swatches react too
+        auto nudge = [](std::uint8_t channel){ return (std::uint8_t)(channel < 128 ? channel + 16 : channel - 16); };
+        color = sf::Color(nudge(color.r), nudge(color.g), nudge(color.b), color.a);
+    }
+    sf::Vector2f atlasSize(m_atlasImage.getSize());
+    auto quad = [this, &atlasSize](std::size_t first, sf::Vector2f center, sf::Vector2f half, sf::FloatRect texture, sf::Color color){
+        tgui::Vertex::Color tint(color.r, color.g, color.b, color.a);
+        sf::Vector2f t0 = {texture.position.x / atlasSize.x, texture.position.y / atlasSize.y};
+        sf::Vector2f t1 = {(texture.position.x + texture.size.x) / atlasSize.x, (texture.position.y + texture.size.y) / atlasSize.y};
+        m_vertices[first] = tgui::Vertex({center.x - half.x, center.y - half.y}, tint, {t0.x, t0.y});
+        m_vertices[first + 1] = tgui::Vertex({center.x + half.x, center.y - half.y}, tint, {t1.x, t0.y});
+        m_vertices[first + 2] = tgui::Vertex({center.x + half.x, center.y + half.y}, tint, {t1.x, t1.y});
+        m_vertices[first + 3] = tgui::Vertex({center.x - half.x, center.y + half.y}, tint, {t0.x, t1.y});
+    };
+    sf::FloatRect disc({0.f, 0.f}, {(float)PALETTE_DISC_SIZE, (float)PALETTE_DISC_SIZE});
+    std::size_t first = index * 12;
+    float outline = m_radius + m_outlineThickness;
+    quad(first, swatch.center, {outline, outline}, disc, index == m_model->getSelected() ? m_outlineColor : sf::Color::Transparent);
+    quad(first + 4, swatch.center, {m_radius, m_radius}, disc, color);
+    quad(first + 8, swatch.center, swatch.iconRect.size / 2.f, swatch.iconRect, swatch.iconRect.size.x > 0 ? sf::Color::White : sf::Color::Transparent);
+}
+
+void Palette::rebuildAtlas(){
+    sf::Vector2u size = m_atlasImage.getSize();
+    auto pixels = std::make_unique<std::uint8_t[]>(size.x * size.y * 4);
+    std::memcpy(pixels.get(), m_atlasImage.getPixelsPtr(), size.x * size.y * 4);
+    m_atlas = tgui::getBackend()->createTexture();
+    m_atlas->load({size.x, size.y}, std::move(pixels), true);
+}
+
+std::size_t Palette::swatchAt(tgui::Vector2f local) const {
+    // swatches are laid out row by row, left to right, so only the two around the mouse in its row can be hit
+    if (local.y < 0.f)
+        return PALETTE_NO_SELECTION;
+    std::size_t row = (std::size_t)(local.y / (2.f * (m_radius + m_outlineThickness) + m_spacing));
+    auto it = std::lower_bound(m_swatches.begin(), m_swatches.end(), local.x, [row](const Swatch& swatch, float x){
+        return swatch.row < row || (swatch.row == row && swatch.center.x < x);
+    });
+    for (int step = 0; step < 2; step++, --it){
+        if (it != m_swatches.end()){
+            float dx = local.x - it->center.x;
+            float dy = local.y - it->center.y;
+            if (dx * dx + dy * dy <= m_radius * m_radius)
+                return it - m_swatches.begin();
+        }
+        if (it == m_swatches.begin())
+            break;
+    }
+    return PALETTE_NO_SELECTION;
+}
+
+bool Palette::isMouseOnWidget(tgui::Vector2f pos) const {
+    return swatchAt(pos - getPosition()) != PALETTE_NO_SELECTION;
+}
+
+bool Palette::leftMousePressed(tgui::Vector2f pos){
+    tgui::ClickableWidget::leftMousePressed(pos);
+    std::size_t index = swatchAt(pos - getPosition());
+    if (index != PALETTE_NO_SELECTION){
+        m_model->select(index);
+        onSwatchClick.emit(this, (unsigned int)index);
+    }
+    return true;
+}
+
+void Palette::mouseMoved(tgui::Vector2f pos){
+    tgui::ClickableWidget::mouseMoved(pos);
+    std::size_t index = swatchAt(pos - getPosition());
+    if (index == m_hovered)
+        return;
+    std::size_t previous = m_hovered;
+    m_hovered = index;
+    if (previous != PALETTE_NO_SELECTION)
+        writeSwatch(previous);
+    if (index != PALETTE_NO_SELECTION)
+        writeSwatch(index);
+}
+
+void Palette::mouseNoLongerOnWidget(){
+    tgui::ClickableWidget::mouseNoLongerOnWidget();
+    std::size_t previous = m_hovered;
+    m_hovered = PALETTE_NO_SELECTION;
+    if (previous != PALETTE_NO_SELECTION)
+        writeSwatch(previous);
+}
+
+void Palette::draw(tgui::BackendRenderTarget& target, tgui::RenderStates states) const {
+    if (m_vertices.empty())
+        return;
+    if (!m_atlas)
+        const_cast<Palette*>(this)->rebuildAtlas(); // needs the gui backend, which may not exist when swatches are added
+    target.drawVertexArray(states, m_vertices.data(), m_vertices.size(), m_indices.data(), m_indices.size(), m_atlas);
+}
+
+tgui::Signal& Palette::getSignal(tgui::String signalName){
+    if (signalName == onSwatchClick.getName())
+        return onSwatchClick;
+    return tgui::ClickableWidget::getSignal(std::move(signalName));
+}
+
+tgui::Widget::Ptr Palette::clone() const {
+    return std::make_shared<Palette>(*this);
+}
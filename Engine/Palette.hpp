@@ -0,0 +1,80 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <TGUI/TGUI.hpp>
+#include <memory>
+#include <vector>
+
+#include "PaletteModel.hpp"
+
+// view of a PaletteModel: round swatches drawn from one vertex array and one texture atlas (a disc
+// plus any icons), straight into the gui's target. hover and selection only rewrite the vertex
+// colours of the swatches involved, there are no per swatch widgets or offscreen textures
+class Palette : public tgui::ClickableWidget {
+public:
+    using Ptr = std::shared_ptr<Palette>;
+    static constexpr const char StaticWidgetType[] = "Palette";
+
+    Palette(float radius = 20.f, float spacing = 10.f);
+    Palette(const Palette& other);
+    ~Palette() override;
+    Palette& operator=(const Palette&) = delete;
+    static Ptr create(float radius = 20.f, float spacing = 10.f);
+
+    // lays out one swatch per colour of the model, and follows it from then on
+    void setModel(std::shared_ptr<PaletteModel> model);
+    const std::shared_ptr<PaletteModel>& getModel() const { return m_model; }
+
+    // layout, takes effect for swatches added afterwards
+    void addSpacing(float width); // extra gap before the next swatch
+    void setColumns(std::size_t columns); // swatches per row, 0 keeps one row
+    void setOutline(sf::Color color, float thickness);
+
+    void setSwatchIcon(std::size_t index, const sf::Image& icon); // drawn centred at its own size
+    sf::Vector2f getSwatchCenter(std::size_t index) const { return m_swatches[index].center; }
+
+    tgui::SignalUInt onSwatchClick = {"SwatchClicked"}; // index of the clicked swatch, after selecting it
+
+    bool isMouseOnWidget(tgui::Vector2f pos) const override;
+    bool leftMousePressed(tgui::Vector2f pos) override;
+    void mouseMoved(tgui::Vector2f pos) override;
+    void mouseNoLongerOnWidget() override;
+    void draw(tgui::BackendRenderTarget& target, tgui::RenderStates states) const override;
+    tgui::Signal& getSignal(tgui::String signalName) override;
+
+protected:
+    tgui::Widget::Ptr clone() const override;
+
+private:
+    struct Swatch {
+        sf::Vector2f center;
+        std::size_t row;
+        sf::FloatRect iconRect; // in the atlas, empty without an icon
+    };
+
+    void onModelChanged(PaletteModel::Change change, std::size_t index, std::size_t previous);
+    void addSwatch();
+    void clearSwatches();
+    std::size_t swatchAt(tgui::Vector2f local) const;
+    void writeSwatch(std::size_t index); // rewrites the swatch's 12 vertices
+    void rebuildAtlas();
+
+    std::shared_ptr<PaletteModel> m_model;
+    std::size_t m_observer = 0;
+
+    float m_radius;
+    float m_spacing;
+    float m_nextX = 0.f;
+    float m_width = 0.f;
+    std::size_t m_columns = 0;
+    std::size_t m_column = 0;
+    std::size_t m_row = 0;
+    float m_outlineThickness = 3.f;
+    sf::Color m_outlineColor = sf::Color::White;
+    std::size_t m_hovered = PALETTE_NO_SELECTION;
+
+    std::vector<Swatch> m_swatches;
+    std::vector<tgui::Vertex> m_vertices;   // outline, disc and icon quad per swatch
+    std::vector<unsigned int> m_indices;
+    sf::Image m_atlasImage;                 // disc in the top left, icons to its right
+    std::shared_ptr<tgui::BackendTexture> m_atlas;
+};
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "PaletteModel.hpp"
+
+std::size_t PaletteModel::addColor(sf::Color color){
+    m_colors.push_back(color);
+    notify(Change::Added, m_colors.size() - 1, PALETTE_NO_SELECTION);
+    return m_colors.size() - 1;
+}
+
+void PaletteModel::setColor(std::size_t index, sf::Color color){
+    if (index >= m_colors.size() || m_colors[index] == color)
+        return;
+    m_colors[index] = color;
+    notify(Change::Recolored, index, PALETTE_NO_SELECTION);
+}
+
+void PaletteModel::clear(){
+    m_colors.clear();
+    m_selected = PALETTE_NO_SELECTION;
+    notify(Change::Cleared, PALETTE_NO_SELECTION, PALETTE_NO_SELECTION);
+}
+
+void PaletteModel::select(std::size_t index){
+    if (index >= m_colors.size())
+        index = PALETTE_NO_SELECTION;
+    if (index == m_selected)
+        return;
+    std::size_t previous = m_selected;
+    m_selected = index;
+    notify(Change::Selected, index, previous);
+}
+
+void PaletteModel::pushRecent(sf::Color color, std::size_t limit){
+    if (limit == 0)
+        return;
+    std::size_t slot = std::find(m_colors.begin(), m_colors.end(), color) - m_colors.begin();
+    if (slot == m_colors.size()){
+        if (m_colors.size() < limit){
+            addColor(color);
+        } else {
+            slot = std::min(limit, m_colors.size()) - 1; // the oldest goes
+            if (m_selected == slot)
+                select(PALETTE_NO_SELECTION);
+            m_colors[slot] = color;
+        }
+    }
+    // shift everything in front of the slot back by one, the selection moves with its colour
+    std::rotate(m_colors.begin(), m_colors.begin() + slot, m_colors.begin() + slot + 1);
+    for (std::size_t i = 0; i <= slot; i++)
+        notify(Change::Recolored, i, PALETTE_NO_SELECTION);
+    if (m_selected != PALETTE_NO_SELECTION && m_selected <= slot){
+        std::size_t previous = m_selected;
+        m_selected = m_selected == slot ? 0 : m_selected + 1;
+        notify(Change::Selected, m_selected, previous);
+    }
+}
+
+std::size_t PaletteModel::addObserver(Observer observer){
+    m_observers.emplace_back(m_nextObserverId, std::move(observer));
+    return m_nextObserverId++;
+}
+
+void PaletteModel::removeObserver(std::size_t id){
+    m_observers.erase(std::remove_if(m_observers.begin(), m_observers.end(), [id](const auto& entry){ return entry.first == id; }), m_observers.end());
+}
+
+void PaletteModel::notify(Change change, std::size_t index, std::size_t previous){
+    for (const auto& entry : m_observers)
+        entry.second(change, index, previous);
+}
+
+bool PaletteModel::loadFromFile(const std::string& path){
+    std::ifstream file(path);
+    if (!file)
+        return false;
+    std::vector<sf::Color> colors;
+    std::string line;
+    while (std::getline(file, line)){
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line[0] == ';')
+            continue;
+        unsigned int value = 0;
+        int length = 0;
+        if (std::sscanf(line.c_str(), "#%x%n", &value, &length) != 1)
+            return false;
+        if (length == 7)
+            value = (value << 8) | 0xFF; // #rrggbb, opaque
+        else if (length != 9)
+            return false;
+        colors.push_back(sf::Color(value));
+    }
+    clear();
+    for (const sf::Color& color : colors)
+        addColor(color);
+    return true;
+}
+
+bool PaletteModel::saveToFile(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+        return false;
+    char line[16];
+    for (const sf::Color& color : m_colors){
+        std::snprintf(line, sizeof(line), "#%08x\n", color.toInteger());
+        file << line;
+    }
+    return (bool)file;
+}
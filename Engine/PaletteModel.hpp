@@ -0,0 +1,49 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define PALETTE_NO_SELECTION static_cast<std::size_t>(-1)
+
+// the colours of a palette and which one is selected. observers hear about each change with the
+// indices it touched, so a view only repaints those swatches however many colours there are
+class PaletteModel {
+public:
+    enum class Change {
+        Added,     // index is the new colour
+        Recolored, // index changed colour
+        Selected,  // index is the new selection, previous the old one (either may be PALETTE_NO_SELECTION)
+        Cleared    // every colour was removed
+    };
+    using Observer = std::function<void(Change change, std::size_t index, std::size_t previous)>;
+
+    std::size_t addColor(sf::Color color);
+    void setColor(std::size_t index, sf::Color color);
+    sf::Color getColor(std::size_t index) const { return m_colors[index]; }
+    std::size_t getColorCount() const { return m_colors.size(); }
+    void clear();
+
+    void select(std::size_t index); // out of range clears the selection
+    std::size_t getSelected() const { return m_selected; }
+
+    // most recently used first: moves the colour to the front if present, otherwise adds it there
+    // and drops the oldest beyond limit. this recolours in place, so it costs one notification per slot
+    void pushRecent(sf::Color color, std::size_t limit);
+
+    std::size_t addObserver(Observer observer); // returns an id for removeObserver
+    void removeObserver(std::size_t id);
+
+    // one #rrggbbaa colour per line, blank lines and lines starting with ';' are skipped
+    bool loadFromFile(const std::string& path);
+    bool saveToFile(const std::string& path) const;
+
+private:
+    void notify(Change change, std::size_t index, std::size_t previous);
+
+    std::vector<sf::Color> m_colors;
+    std::size_t m_selected = PALETTE_NO_SELECTION;
+    std::vector<std::pair<std::size_t, Observer>> m_observers;
+    std::size_t m_nextObserverId = 0;
+};
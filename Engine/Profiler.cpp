@@ -0,0 +1,220 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+#include "Profiler.hpp"
+
+namespace {
+    struct Lane {
+        std::atomic<bool> active{false}; // a live thread owns it
+        char name[32] = {};
+        ProfileZone zones[PROFILER_LANE_ZONES];
+        std::atomic<std::uint64_t> head{0}; // zones ever written, only the owner stores
+
+        // owner only
+        const char* stackName[PROFILER_MAX_DEPTH];
+        std::uint64_t stackStart[PROFILER_MAX_DEPTH];
+        std::uint32_t depth = 0;
+
+        // frame thread only
+        std::uint64_t frameCursor = 0;
+    };
+
+    Lane g_lanes[PROFILER_MAX_LANES];
+    std::atomic<int> g_laneCount{0};
+    const auto g_epoch = std::chrono::steady_clock::now();
+
+    // hands the lane back when its thread exits
+    struct LaneHandle {
+        Lane* lane = nullptr;
+        ~LaneHandle(){
+            if (lane)
+                lane->active.store(false, std::memory_order_release);
+        }
+    };
+    thread_local LaneHandle t_lane;
+
+    ProfileFrame g_frames[PROFILER_HISTORY];
+    std::size_t g_frameCount = 0;
+    std::size_t g_frameNext = 0;
+    std::uint64_t g_lastFrame = 0;
+    int g_frameLane = -1;
+    ProfileZone g_scratch[PROFILER_LANE_ZONES];
+
+    std::mutex g_claimMutex; // only taken the first time a thread records
+
+    Lane* claimLane(const char* name){
+        std::lock_guard<std::mutex> lock(g_claimMutex);
+        // a lane with the same name whose thread finished keeps the history readable under one label
+        int count = g_laneCount.load(std::memory_order_relaxed);
+        for (int i = 0; i < count; i++){
+            if (!g_lanes[i].active.load(std::memory_order_acquire) && std::strncmp(g_lanes[i].name, name, sizeof(g_lanes[i].name) - 1) == 0){
+                g_lanes[i].active.store(true, std::memory_order_release);
+                return &g_lanes[i];
+            }
+        }
+        if (count == PROFILER_MAX_LANES)
+            return nullptr; // out of lanes, this thread goes unrecorded
+        Lane& lane = g_lanes[count];
+        std::strncpy(lane.name, name, sizeof(lane.name) - 1);
+        lane.active.store(true, std::memory_order_release);
+        g_laneCount.store(count + 1, std::memory_order_release);
+        return &lane;
+    }
+
+    Lane* currentLane(){
+        if (!t_lane.lane)
+            t_lane.lane = claimLane("thread");
+        return t_lane.lane;
+    }
+
+    void push(Lane& lane, const char* name, std::uint64_t start, std::uint64_t end, std::uint32_t depth, std::int64_t value){
+        std::uint64_t head = lane.head.load(std::memory_order_relaxed);
+        ProfileZone& zone = lane.zones[head & (PROFILER_LANE_ZONES - 1)];
+        zone.name = name;
+        zone.start = start;
+        zone.end = end;
+        zone.depth = depth;
+        zone.value = value;
+        lane.head.store(head + 1, std::memory_order_release);
+    }
+}
+
+namespace Profiler {
+    std::uint64_t now(){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_epoch).count();
+    }
+
+    void setThreadName(const char* name){
+        if (t_lane.lane){
+            if (std::strncmp(t_lane.lane->name, name, sizeof(t_lane.lane->name) - 1) == 0)
+                return;
+            t_lane.lane->active.store(false, std::memory_order_release);
+        }
+        t_lane.lane = claimLane(name);
+    }
+
+    void beginZone(const char* name){
+        Lane* lane = currentLane();
+        if (!lane)
+            return;
+        if (lane->depth < PROFILER_MAX_DEPTH){
+            lane->stackName[lane->depth] = name;
+            lane->stackStart[lane->depth] = now();
+        }
+        lane->depth++;
+    }
+
+    void endZone(){
+        Lane* lane = t_lane.lane;
+        if (!lane || lane->depth == 0)
+            return;
+        lane->depth--;
+        if (lane->depth >= PROFILER_MAX_DEPTH)
+            return;
+        push(*lane, lane->stackName[lane->depth], lane->stackStart[lane->depth], now(), lane->depth, 0);
+    }
+
+    void counter(const char* name, std::int64_t value){
+        Lane* lane = currentLane();
+        if (!lane)
+            return;
+        std::uint64_t time = now();
+        push(*lane, name, time, time, PROFILER_COUNTER_DEPTH, value);
+    }
+
+    std::size_t readZones(int laneIndex, std::uint64_t& cursor, ProfileZone* out, std::size_t capacity, std::size_t& count){
+        count = 0;
+        if (laneIndex < 0 || laneIndex >= getLaneCount())
+            return 0;
+        Lane& lane = g_lanes[laneIndex];
+        std::uint64_t head = lane.head.load(std::memory_order_acquire);
+        std::size_t lost = 0;
+        if (head - cursor > PROFILER_LANE_ZONES){
+            lost = (std::size_t)(head - cursor - PROFILER_LANE_ZONES);
+            cursor = head - PROFILER_LANE_ZONES;
+        }
+        std::uint64_t first = cursor;
+        for (; cursor < head && count < capacity; cursor++)
+            out[count++] = lane.zones[cursor & (PROFILER_LANE_ZONES - 1)];
+        // the owner may have lapped us while copying, drop whatever it overwrote
+        std::uint64_t newHead = lane.head.load(std::memory_order_acquire);
+        if (newHead > first + PROFILER_LANE_ZONES){
+            std::size_t overwritten = (std::size_t)(newHead - PROFILER_LANE_ZONES - first);
+            overwritten = overwritten < count ? overwritten : count;
+            std::memmove(out, out + overwritten, (count - overwritten) * sizeof(ProfileZone));
+            count -= overwritten;
+            lost += overwritten;
+        }
+        return lost;
+    }
+
+    void frame(){
+        Lane* own = currentLane();
+        std::uint64_t time = now();
+        ProfileFrame& frame = g_frames[g_frameNext];
+        frame = ProfileFrame();
+        frame.ms = g_lastFrame ? (time - g_lastFrame) / 1e6f : 0.f;
+        g_lastFrame = time;
+        g_frameLane = own ? (int)(own - g_lanes) : -1;
+
+        int lanes = getLaneCount();
+        for (int i = 0; i < lanes; i++){
+            std::size_t count;
+            readZones(i, g_lanes[i].frameCursor, g_scratch, PROFILER_LANE_ZONES, count);
+            float childMs = 0.f; // children finish before their parent, so they're known by the time it arrives
+            for (std::size_t z = 0; z < count; z++){
+                const ProfileZone& zone = g_scratch[z];
+                float ms = (zone.end - zone.start) / 1e6f;
+                if (zone.depth == 0)
+                    frame.laneBusyMs[i] += ms;
+                // phases are the frame thread's top two levels, the parent only keeps its own time
+                if (i != g_frameLane || zone.depth > 1)
+                    continue;
+                if (zone.depth == 1)
+                    childMs += ms;
+                else {
+                    ms -= childMs;
+                    childMs = 0.f;
+                }
+                int phase = 0;
+                while (phase < frame.phaseCount && frame.phases[phase].name != zone.name)
+                    phase++;
+                if (phase == frame.phaseCount){
+                    if (phase == PROFILER_MAX_PHASES)
+                        continue;
+                    frame.phases[frame.phaseCount++] = {zone.name, 0.f};
+                }
+                frame.phases[phase].ms += ms;
+            }
+        }
+        g_frameNext = (g_frameNext + 1) % PROFILER_HISTORY;
+        if (g_frameCount < PROFILER_HISTORY)
+            g_frameCount++;
+    }
+
+    int getLaneCount(){
+        return g_laneCount.load(std::memory_order_acquire);
+    }
+
+    const char* getLaneName(int lane){
+        return lane >= 0 && lane < getLaneCount() ? g_lanes[lane].name : "";
+    }
+
+    std::uint64_t getLaneHead(int lane){
+        return lane >= 0 && lane < getLaneCount() ? g_lanes[lane].head.load(std::memory_order_acquire) : 0;
+    }
+
+    std::size_t getFrameCount(){
+        return g_frameCount;
+    }
+
+    const ProfileFrame& getFrame(std::size_t index){
+        return g_frames[(g_frameNext + PROFILER_HISTORY - g_frameCount + index) % PROFILER_HISTORY];
+    }
+
+    int getFrameLane(){
+        return g_frameLane;
+    }
+}
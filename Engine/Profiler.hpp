@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// scoped zone timers. every thread writes finished zones into its own fixed ring (a lane), so
+// recording never locks or allocates; readers copy zones out with their own cursor.
+// built with PIZARRA_PROFILING undefined, the macros below compile to nothing
+#define PROFILER_MAX_LANES 16
+#define PROFILER_LANE_ZONES 4096 // power of two
+#define PROFILER_MAX_DEPTH 32
+#define PROFILER_HISTORY 240     // frames kept for the overlay
+#define PROFILER_MAX_PHASES 8    // distinct zones per frame in the frame thread's top two levels
+#define PROFILER_COUNTER_DEPTH 0xFFFFFFFFu // marks a counter sample in a lane
+
+struct ProfileZone {
+    const char* name; // string literal, compared by pointer
+    std::uint64_t start; // nanoseconds since the profiler started
+    std::uint64_t end;
+    std::uint32_t depth; // PROFILER_COUNTER_DEPTH for counters
+    std::int64_t value;  // counters only
+};
+
+struct ProfilePhase {
+    const char* name;
+    float ms;
+};
+
+struct ProfileFrame {
+    float ms = 0.f;
+    ProfilePhase phases[PROFILER_MAX_PHASES];
+    int phaseCount = 0;
+    float laneBusyMs[PROFILER_MAX_LANES] = {}; // top level zone time of every lane during the frame
+};
+
+namespace Profiler {
+    std::uint64_t now();
+    void setThreadName(const char* name); // picks this thread's lane, reusing one a finished thread left behind
+    void beginZone(const char* name);
+    void endZone();
+    void counter(const char* name, std::int64_t value);
+
+    // on the thread that owns the frame loop, once per frame
+    void frame();
+
+    int getLaneCount();
+    const char* getLaneName(int lane);
+    std::uint64_t getLaneHead(int lane); // zones ever written, a cursor here skips everything so far
+    // copies zones written since cursor, returns how many were overwritten before they could be read
+    std::size_t readZones(int lane, std::uint64_t& cursor, ProfileZone* out, std::size_t capacity, std::size_t& count);
+
+    // oldest first, at most PROFILER_HISTORY
+    std::size_t getFrameCount();
+    const ProfileFrame& getFrame(std::size_t index);
+    int getFrameLane(); // lane of the thread calling frame(), -1 before the first frame
+
+    // streams every zone and counter recorded from now on to a chrome trace event json file
+    // (chrome://tracing, ui.perfetto.dev) from a background thread
+    bool startTrace(const std::string& path);
+    void stopTrace();
+    bool isTracing();
+}
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name){ Profiler::beginZone(name); }
+    ~ProfileScope(){ Profiler::endZone(); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef PIZARRA_PROFILING
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+#define PROFILE_FRAME() Profiler::frame()
+#define PROFILE_COUNTER(name, value) Profiler::counter(name, (std::int64_t)(value))
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#endif
@@ -0,0 +1,136 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "FrameArena.hpp"
+#include "ProfilerOverlay.hpp"
+#include "RenderStats.hpp"
+
+#define OVERLAY_BAR_WIDTH 2.f
+#define OVERLAY_LANE_HEIGHT 3.f
+
+static const sf::Color PHASE_COLORS[] = {
+    sf::Color(230, 80, 70), sf::Color(90, 170, 240), sf::Color(120, 210, 100), sf::Color(240, 200, 60),
+    sf::Color(200, 110, 230), sf::Color(80, 210, 200), sf::Color(240, 140, 60), sf::Color(180, 180, 180)
+};
+
+static void appendRect(sf::VertexArray& vertices, sf::Vector2f topLeft, sf::Vector2f size, sf::Color color){
+    sf::Vector2f a = topLeft, b = topLeft + sf::Vector2f(size.x, 0.f), c = topLeft + size, d = topLeft + sf::Vector2f(0.f, size.y);
+    vertices.append({a, color});
+    vertices.append({b, color});
+    vertices.append({c, color});
+    vertices.append({a, color});
+    vertices.append({c, color});
+    vertices.append({d, color});
+}
+
+ProfilerOverlay::ProfilerOverlay(sf::Vector2f position, float height, float msPerHeight)
+    : m_position(position), m_height(height), m_msPerHeight(msPerHeight)
+{
+    m_background.setFillColor(sf::Color(0, 0, 0, 160));
+}
+
+sf::Color ProfilerOverlay::colorFor(const char* name){
+    for (std::size_t i = 0; i < m_names.size(); i++)
+        if (m_names[i] == name || std::strcmp(m_names[i], name) == 0)
+            return PHASE_COLORS[i % (sizeof(PHASE_COLORS) / sizeof(sf::Color))];
+    m_names.push_back(name);
+    return PHASE_COLORS[(m_names.size() - 1) % (sizeof(PHASE_COLORS) / sizeof(sf::Color))];
+}
+
+void ProfilerOverlay::update(){
+    if (!m_visible)
+        return;
+    float scale = m_height / m_msPerHeight;
+    int lanes = Profiler::getLaneCount();
+    int frameLane = Profiler::getFrameLane();
+    float width = PROFILER_HISTORY * OVERLAY_BAR_WIDTH;
+    float lanesHeight = (lanes > 1 ? lanes - 1 : 0) * OVERLAY_LANE_HEIGHT;
+    m_background.setPosition(m_position - sf::Vector2f(4.f, 4.f));
+    m_background.setSize({width + 8.f, m_height + lanesHeight + 10.f});
+
+    m_bars.clear();
+    std::size_t count = Profiler::getFrameCount();
+    float x = m_position.x + (PROFILER_HISTORY - count) * OVERLAY_BAR_WIDTH;
+    for (std::size_t i = 0; i < count; i++, x += OVERLAY_BAR_WIDTH){
+        const ProfileFrame& frame = Profiler::getFrame(i);
+        float bottom = m_position.y + m_height;
+        // the untracked rest of the frame in grey, phases stacked on top of it from the bottom
+        float tracked = 0.f;
+        for (int p = 0; p < frame.phaseCount; p++){
+            float h = std::min(frame.phases[p].ms * scale, bottom - m_position.y);
+            appendRect(m_bars, {x, bottom - h}, {OVERLAY_BAR_WIDTH, h}, colorFor(frame.phases[p].name));
+            bottom -= h;
+            tracked += frame.phases[p].ms;
+        }
+        float rest = std::min(std::max(frame.ms - tracked, 0.f) * scale, bottom - m_position.y);
+        appendRect(m_bars, {x, bottom - rest}, {OVERLAY_BAR_WIDTH, rest}, sf::Color(90, 90, 90));
+
+        float y = m_position.y + m_height + 2.f;
+        for (int lane = 0; lane < lanes; lane++){
+            if (lane == frameLane)
+                continue;
+            float busy = frame.ms > 0.f ? std::min(frame.laneBusyMs[lane] / frame.ms, 1.f) : 0.f;
+            appendRect(m_bars, {x, y}, {OVERLAY_BAR_WIDTH, OVERLAY_LANE_HEIGHT - 1.f}, sf::Color(255, 255, 255, (std::uint8_t)(40 + busy * 215)));
+            y += OVERLAY_LANE_HEIGHT;
+        }
+    }
+
+    float y60 = m_position.y + m_height - 1000.f / 60.f * scale;
+    float y30 = m_position.y + m_height - 1000.f / 30.f * scale;
+    m_budget60 = sw::Line({m_position.x, y60}, {m_position.x + width, y60}, 1.f, sf::Color(120, 255, 120, 200));
+    m_budget30 = sw::Line({m_position.x, y30}, {m_position.x + width, y30}, 1.f, sf::Color(255, 120, 120, 200));
+}
+
+std::string ProfilerOverlay::getSummary() const {
+    std::size_t count = Profiler::getFrameCount();
+    if (count == 0)
+        return "no frames recorded";
+    float total = 0.f, worst = 0.f;
+    std::vector<float> phaseMs(m_names.size(), 0.f);
+    for (std::size_t i = 0; i < count; i++){
+        const ProfileFrame& frame = Profiler::getFrame(i);
+        total += frame.ms;
+        worst = std::max(worst, frame.ms);
+        for (int p = 0; p < frame.phaseCount; p++)
+            for (std::size_t n = 0; n < m_names.size(); n++)
+                if (m_names[n] == frame.phases[p].name || std::strcmp(m_names[n], frame.phases[p].name) == 0)
+                    phaseMs[n] += frame.phases[p].ms;
+    }
+    char line[96];
+    std::snprintf(line, sizeof(line), "frame %.2f ms avg, %.2f ms worst\n", total / count, worst);
+    std::string summary = line;
+    const RenderStats& render = RenderStats::getLastFrame();
+    std::snprintf(line, sizeof(line), "%u draws, %llu vertices, %u binds, %u target switches\n",
+        render.drawCalls, (unsigned long long)render.vertices, render.textureBinds, render.targetSwitches);
+    summary += line;
+    const FrameArena::Stats& arena = FrameArena::getLastFrameStats();
+    std::snprintf(line, sizeof(line), "%llu heap allocations, arena %zu/%zu KB, %u fallbacks\n",
+        (unsigned long long)arena.heapAllocations, arena.used >> 10, arena.capacity >> 10, arena.fallbacks);
+    summary += line;
+    for (std::size_t n = 0; n < m_names.size(); n++){
+        sf::Color color = PHASE_COLORS[n % (sizeof(PHASE_COLORS) / sizeof(sf::Color))];
+        std::snprintf(line, sizeof(line), "<color=#%02x%02x%02x>%s</color> %.2f ms\n", color.r, color.g, color.b, m_names[n], phaseMs[n] / count);
+        summary += line;
+    }
+    for (int lane = 0; lane < Profiler::getLaneCount(); lane++){
+        if (lane == Profiler::getFrameLane())
+            continue;
+        float busy = 0.f;
+        for (std::size_t i = 0; i < count; i++)
+            busy += Profiler::getFrame(i).laneBusyMs[lane];
+        std::snprintf(line, sizeof(line), "[%s] %.2f ms\n", Profiler::getLaneName(lane), busy / count);
+        summary += line;
+    }
+    return summary;
+}
+
+void ProfilerOverlay::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    if (!m_visible)
+        return;
+    target.draw(m_background, states);
+    target.draw(m_bars, states);
+    target.draw(m_budget60, states);
+    target.draw(m_budget30, states);
+}
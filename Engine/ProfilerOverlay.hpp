@@ -0,0 +1,38 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <SelbaWard.hpp>
+#include <string>
+#include <vector>
+
+#include "Profiler.hpp"
+
+// the last frames as stacked bars, one colour per top level zone of the frame thread, with a thin
+// strip under each bar for every other thread's busy time and guides at 60 and 30 fps
+class ProfilerOverlay : public sf::Drawable {
+public:
+    ProfilerOverlay(sf::Vector2f position = {10.f, 10.f}, float height = 100.f, float msPerHeight = 40.f);
+
+    void toggle(){ m_visible = !m_visible; }
+    void setVisible(bool visible){ m_visible = visible; }
+    bool isVisible() const { return m_visible; }
+    void setPosition(sf::Vector2f position){ m_position = position; }
+
+    // rebuilds the bars from the profiler history, call after PROFILE_FRAME()
+    void update();
+    // averages per phase over the history, with colour tags for a tgui::RichTextLabel legend
+    std::string getSummary() const;
+
+private:
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+    sf::Color colorFor(const char* name);
+
+    sf::Vector2f m_position;
+    float m_height;
+    float m_msPerHeight;
+    bool m_visible = false;
+    sf::VertexArray m_bars{sf::PrimitiveType::Triangles};
+    sf::RectangleShape m_background;
+    sw::Line m_budget60;
+    sw::Line m_budget30;
+    std::vector<const char*> m_names; // colour index is the position in here
+};
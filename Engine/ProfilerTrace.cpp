@@ -0,0 +1,140 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Profiler.hpp"
+
+// the trace writer drains the lanes with cursors of its own, so the overlay keeps working while it runs
+namespace {
+    struct TraceWriter {
+        std::FILE* file = nullptr;
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool quit = false;
+        std::uint64_t cursors[PROFILER_MAX_LANES];
+        char laneNames[PROFILER_MAX_LANES][32];
+        bool firstEvent = true;
+        ProfileZone scratch[PROFILER_LANE_ZONES];
+    };
+
+    std::mutex g_traceMutex; // start/stop
+    std::unique_ptr<TraceWriter> g_trace;
+    std::atomic<bool> g_tracing{false};
+
+    // closes a trace left running at exit before its thread would be destroyed still joinable
+    struct TraceShutdown {
+        ~TraceShutdown(){ Profiler::stopTrace(); }
+    } g_traceShutdown;
+
+    void writeString(std::FILE* file, const char* text){
+        std::fputc('"', file);
+        for (; *text; text++){
+            if (*text == '"' || *text == '\\')
+                std::fputc('\\', file);
+            if ((unsigned char)*text >= 0x20)
+                std::fputc(*text, file);
+        }
+        std::fputc('"', file);
+    }
+
+    void beginEvent(TraceWriter& trace){
+        std::fputs(trace.firstEvent ? "\n" : ",\n", trace.file);
+        trace.firstEvent = false;
+    }
+
+    void drain(TraceWriter& trace){
+        int lanes = Profiler::getLaneCount();
+        for (int lane = 0; lane < lanes; lane++){
+            // thread names go out as metadata, again if a finished thread's lane was taken over
+            const char* name = Profiler::getLaneName(lane);
+            if (std::strncmp(trace.laneNames[lane], name, sizeof(trace.laneNames[lane]) - 1) != 0){
+                std::strncpy(trace.laneNames[lane], name, sizeof(trace.laneNames[lane]) - 1);
+                beginEvent(trace);
+                std::fprintf(trace.file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", lane);
+                writeString(trace.file, trace.laneNames[lane]);
+                std::fputs("}}", trace.file);
+            }
+
+            std::size_t count;
+            std::size_t lost = Profiler::readZones(lane, trace.cursors[lane], trace.scratch, PROFILER_LANE_ZONES, count);
+            if (lost > 0){
+                beginEvent(trace);
+                std::fprintf(trace.file, "{\"name\":\"%zu zones lost\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                    lost, lane, count > 0 ? trace.scratch[0].start / 1e3 : Profiler::now() / 1e3);
+            }
+            for (std::size_t i = 0; i < count; i++){
+                const ProfileZone& zone = trace.scratch[i];
+                beginEvent(trace);
+                std::fputs("{\"name\":", trace.file);
+                writeString(trace.file, zone.name);
+                if (zone.depth == PROFILER_COUNTER_DEPTH)
+                    std::fprintf(trace.file, ",\"ph\":\"C\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"value\":%lld}}",
+                        lane, zone.start / 1e3, (long long)zone.value);
+                else
+                    std::fprintf(trace.file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        lane, zone.start / 1e3, (zone.end - zone.start) / 1e3);
+            }
+        }
+        std::fflush(trace.file);
+    }
+
+    void traceLoop(TraceWriter* trace){
+        std::unique_lock<std::mutex> lock(trace->mutex);
+        while (!trace->quit){
+            // lanes hold 4096 zones, draining 20 times a second keeps well ahead of them
+            trace->wake.wait_for(lock, std::chrono::milliseconds(50), [trace](){ return trace->quit; });
+            drain(*trace);
+        }
+    }
+}
+
+namespace Profiler {
+    bool startTrace(const std::string& path){
+        std::lock_guard<std::mutex> lock(g_traceMutex);
+        if (g_trace)
+            return true;
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        g_trace = std::make_unique<TraceWriter>();
+        g_trace->file = file;
+        // only what happens from now on
+        for (int lane = 0; lane < PROFILER_MAX_LANES; lane++){
+            g_trace->cursors[lane] = getLaneHead(lane);
+            g_trace->laneNames[lane][0] = '\0';
+        }
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+        beginEvent(*g_trace);
+        std::fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Pizarra\"}}", file);
+        g_trace->thread = std::thread(traceLoop, g_trace.get());
+        g_tracing.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void stopTrace(){
+        std::lock_guard<std::mutex> lock(g_traceMutex);
+        if (!g_trace)
+            return;
+        {
+            std::lock_guard<std::mutex> traceLock(g_trace->mutex);
+            g_trace->quit = true;
+        }
+        g_trace->wake.notify_all();
+        g_trace->thread.join();
+        drain(*g_trace);
+        std::fputs("\n]}\n", g_trace->file);
+        std::fclose(g_trace->file);
+        g_trace.reset();
+        g_tracing.store(false, std::memory_order_release);
+    }
+
+    bool isTracing(){
+        return g_tracing.load(std::memory_order_acquire);
+    }
+}
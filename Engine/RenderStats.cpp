@@ -0,0 +1,82 @@
+#include <SFML/Graphics.hpp>
+
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+
+static RenderStats s_current;
+static RenderStats s_lastFrame;
+static const sf::RenderTarget* s_lastTarget = nullptr;
+static const sf::Texture* s_lastTexture = nullptr;
+
+const RenderStats& RenderStats::getCurrent(){
+    return s_current;
+}
+
+const RenderStats& RenderStats::getLastFrame(){
+    return s_lastFrame;
+}
+
+void RenderStats::endFrame(){
+    PROFILE_COUNTER("draw calls", s_current.drawCalls);
+    PROFILE_COUNTER("vertices", s_current.vertices);
+    PROFILE_COUNTER("texture binds", s_current.textureBinds);
+    PROFILE_COUNTER("target switches", s_current.targetSwitches);
+    s_lastFrame = s_current;
+    s_current = RenderStats();
+}
+
+DrawCost drawCost(const sf::Drawable&, const sf::RenderStates& states){
+    return {1, 0, states.texture};
+}
+
+DrawCost drawCost(const sf::VertexArray& vertices, const sf::RenderStates& states){
+    return {1, vertices.getVertexCount(), states.texture};
+}
+
+DrawCost drawCost(const sf::VertexBuffer& buffer, const sf::RenderStates& states){
+    return {1, buffer.getVertexCount(), states.texture};
+}
+
+DrawCost drawCost(const sf::Sprite& sprite, const sf::RenderStates&){
+    return {1, 4, &sprite.getTexture()};
+}
+
+DrawCost drawCost(const sf::Shape& shape, const sf::RenderStates&){
+    // a triangle fan for the fill (centre + closing point) and a strip for the outline, if any
+    std::size_t points = shape.getPointCount();
+    if (shape.getOutlineThickness() == 0.f)
+        return {1, points + 2, shape.getTexture()};
+    return {2, points + 2 + (points + 1) * 2, shape.getTexture()};
+}
+
+void CountingTarget::touch(){
+    if (s_lastTarget != &m_target){
+        s_current.targetSwitches++;
+        s_lastTarget = &m_target;
+        s_lastTexture = nullptr; // every target keeps its own bindings
+    }
+}
+
+void CountingTarget::count(const DrawCost& cost){
+    touch();
+    s_current.drawCalls += cost.drawCalls;
+    s_current.vertices += cost.vertices;
+    if (cost.texture && cost.texture != s_lastTexture)
+        s_current.textureBinds++;
+    s_lastTexture = cost.texture;
+}
+
+void CountingTarget::draw(const sf::Vertex* vertices, std::size_t vertexCount, sf::PrimitiveType type, const sf::RenderStates& states){
+    count({1, vertexCount, states.texture});
+    m_target.draw(vertices, vertexCount, type, states);
+}
+
+void CountingTarget::draw(const sf::VertexBuffer& buffer, std::size_t firstVertex, std::size_t vertexCount, const sf::RenderStates& states){
+    count({1, vertexCount, states.texture});
+    m_target.draw(buffer, firstVertex, vertexCount, states);
+}
+
+void CountingTarget::clear(sf::Color color){
+    touch();
+    m_target.clear(color);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+
+// per frame draw counters. sf::RenderTarget::draw isn't virtual, so nothing can hook the draws a
+// drawable makes on its own; instead the counting wrapper estimates each draw from what it's
+// handed, with drawCost overloads for the types that say how many vertices they submit
+struct RenderStats {
+    std::uint32_t drawCalls = 0;
+    std::uint64_t vertices = 0;
+    std::uint32_t textureBinds = 0;   // draws whose texture differs from the one before
+    std::uint32_t targetSwitches = 0; // draws or clears on a different target than the one before
+
+    // main thread only, like all rendering
+    static const RenderStats& getCurrent(); // so far this frame
+    static const RenderStats& getLastFrame();
+    static void endFrame(); // publishes the counters to the profiler and starts a new frame
+};
+
+struct DrawCost {
+    std::uint32_t drawCalls;
+    std::size_t vertices;
+    const sf::Texture* texture;
+};
+
+DrawCost drawCost(const sf::Drawable& drawable, const sf::RenderStates& states); // one draw, vertices unknown
+DrawCost drawCost(const sf::VertexArray& vertices, const sf::RenderStates& states);
+DrawCost drawCost(const sf::VertexBuffer& buffer, const sf::RenderStates& states);
+DrawCost drawCost(const sf::Sprite& sprite, const sf::RenderStates& states);
+DrawCost drawCost(const sf::Shape& shape, const sf::RenderStates& states);
+
+class CountingTarget {
+public:
+    explicit CountingTarget(sf::RenderTarget& target) : m_target(target) {}
+
+    template <typename T>
+    void draw(const T& drawable, const sf::RenderStates& states = sf::RenderStates::Default){
+        count(drawCost(drawable, states));
+        m_target.draw(drawable, states);
+    }
+    void draw(const sf::Vertex* vertices, std::size_t vertexCount, sf::PrimitiveType type, const sf::RenderStates& states = sf::RenderStates::Default);
+    void draw(const sf::VertexBuffer& buffer, std::size_t firstVertex, std::size_t vertexCount, const sf::RenderStates& states = sf::RenderStates::Default);
+    void clear(sf::Color color = sf::Color::Black);
+
+    sf::RenderTarget& getTarget(){ return m_target; }
+
+private:
+    void count(const DrawCost& cost);
+    void touch(); // counts a switch when the previous draw went elsewhere
+
+    sf::RenderTarget& m_target;
+};
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Selection.hpp"
+#include "Simd.hpp"
+
+namespace {
+    // crossing test against one edge: the edge straddles the point's row and crosses it to the
+    // point's right. horizontal edges never straddle, so their slope doesn't matter
+    struct Edge {
+        float ax, ay, by, slope;
+    };
+
+    void buildEdges(const std::vector<sf::Vector2f>& polygon, std::vector<Edge>& edges){
+        edges.clear();
+        for (std::size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++){
+            sf::Vector2f a = polygon[i], b = polygon[j];
+            edges.push_back({a.x, a.y, b.y, b.y != a.y ? (b.x - a.x) / (b.y - a.y) : 0.f});
+        }
+    }
+
+    bool insideScalar(sf::Vector2f p, const std::vector<Edge>& edges){
+        bool inside = false;
+        for (const Edge& e : edges){
+            if ((e.ay > p.y) != (e.by > p.y) && p.x < e.ax + (p.y - e.ay) * e.slope)
+                inside = !inside;
+        }
+        return inside;
+    }
+
+#ifdef PIZARRA_SSE2
+    // bit i set when points[i] is inside
+    int inside4(const sf::Vector2f* points, const std::vector<Edge>& edges){
+        __m128 px = _mm_setr_ps(points[0].x, points[1].x, points[2].x, points[3].x);
+        __m128 py = _mm_setr_ps(points[0].y, points[1].y, points[2].y, points[3].y);
+        __m128 inside = _mm_setzero_ps();
+        for (const Edge& e : edges){
+            __m128 ay = _mm_set1_ps(e.ay);
+            __m128 straddles = _mm_xor_ps(_mm_cmpgt_ps(ay, py), _mm_cmpgt_ps(_mm_set1_ps(e.by), py));
+            __m128 x = _mm_add_ps(_mm_set1_ps(e.ax), _mm_mul_ps(_mm_sub_ps(py, ay), _mm_set1_ps(e.slope)));
+            inside = _mm_xor_ps(inside, _mm_and_ps(straddles, _mm_cmplt_ps(px, x)));
+        }
+        return _mm_movemask_ps(inside);
+    }
+#endif
+
+    thread_local std::vector<Edge> t_edges;
+}
+
+void pointsInPolygon(const sf::Vector2f* points, std::size_t count, const std::vector<sf::Vector2f>& polygon, std::uint8_t* inside){
+    if (polygon.size() < 3){
+        std::fill(inside, inside + count, 0);
+        return;
+    }
+    buildEdges(polygon, t_edges);
+    std::size_t i = 0;
+#ifdef PIZARRA_SSE2
+    for (; i + 4 <= count; i += 4){
+        int mask = inside4(points + i, t_edges);
+        for (int k = 0; k < 4; k++)
+            inside[i + k] = (std::uint8_t)((mask >> k) & 1);
+    }
+#endif
+    for (; i < count; i++)
+        inside[i] = insideScalar(points[i], t_edges);
+}
+
+bool allInsidePolygon(const sf::Vector2f* points, std::size_t count, const std::vector<sf::Vector2f>& polygon){
+    if (polygon.size() < 3)
+        return false;
+    buildEdges(polygon, t_edges);
+    std::size_t i = 0;
+#ifdef PIZARRA_SSE2
+    for (; i + 4 <= count; i += 4)
+        if (inside4(points + i, t_edges) != 0xF)
+            return false;
+#endif
+    for (; i < count; i++)
+        if (!insideScalar(points[i], t_edges))
+            return false;
+    return true;
+}
+
+static bool contains(sf::FloatRect outer, sf::FloatRect inner){
+    return inner.position.x >= outer.position.x && inner.position.y >= outer.position.y
+        && inner.position.x + inner.size.x <= outer.position.x + outer.size.x
+        && inner.position.y + inner.size.y <= outer.position.y + outer.size.y;
+}
+
+void selectInRect(const std::vector<Stroke>& strokes, const StrokeIndex& index, sf::FloatRect area, std::vector<std::uint32_t>& out){
+    std::vector<std::uint32_t> near;
+    index.query(area, near);
+    out.clear();
+    for (std::uint32_t i : near)
+        if (i < strokes.size() && !strokes[i].points.empty() && contains(area, index.getBounds(i)))
+            out.push_back(i);
+}
+
+void selectInPolygon(const std::vector<Stroke>& strokes, const StrokeIndex& index, const std::vector<sf::Vector2f>& polygon, std::vector<std::uint32_t>& out){
+    out.clear();
+    if (polygon.size() < 3)
+        return;
+    sf::Vector2f min = polygon[0], max = polygon[0];
+    for (const auto& p : polygon){
+        min = {std::min(min.x, p.x), std::min(min.y, p.y)};
+        max = {std::max(max.x, p.x), std::max(max.y, p.y)};
+    }
+    sf::FloatRect area(min, max - min);
+    std::vector<std::uint32_t> near;
+    index.query(area, near);
+    for (std::uint32_t i : near){
+        if (i >= strokes.size())
+            continue;
+        // strokes that only cross the lasso mostly fail on their first few points
+        const Stroke& stroke = strokes[i];
+        if (!stroke.points.empty() && allInsidePolygon(stroke.points.data(), stroke.points.size(), polygon))
+            out.push_back(i);
+    }
+}
+
+sf::Vector2f GroupTransform::apply(sf::Vector2f p) const {
+    sf::Vector2f d = (p - pivot) * scale;
+    float c = std::cos(angle), s = std::sin(angle);
+    return pivot + offset + sf::Vector2f(d.x * c - d.y * s, d.x * s + d.y * c);
+}
+
+sf::Transform GroupTransform::getTransform() const {
+    sf::Transform transform;
+    transform.translate(pivot + offset);
+    transform.rotate(sf::radians(angle));
+    transform.scale({scale, scale});
+    transform.translate(-pivot);
+    return transform;
+}
+
+bool GroupTransform::isAxisAligned() const {
+    return std::abs(std::sin(2.f * angle)) < 1e-5f;
+}
+
+void transformStroke(Stroke& stroke, const GroupTransform& transform){
+    for (auto& p : stroke.points)
+        p = transform.apply(p);
+    for (auto& p : stroke.curve)
+        p = transform.apply(p);
+    stroke.thickness *= transform.scale;
+    if (stroke.stamp == BrushStamp::Fill){
+        // corners come back out in min, max order whichever way the rectangle was turned
+        for (std::size_t i = 0; i + 1 < stroke.points.size(); i += 2){
+            sf::Vector2f a = stroke.points[i], b = stroke.points[i + 1];
+            stroke.points[i] = {std::min(a.x, b.x), std::min(a.y, b.y)};
+            stroke.points[i + 1] = {std::max(a.x, b.x), std::max(a.y, b.y)};
+        }
+        return;
+    }
+    bool axisAligned = transform.isAxisAligned();
+    if (stroke.shape == StrokeShape::Rect && !axisAligned){
+        stroke.shape = StrokeShape::Polyline;
+        stroke.handles = stroke.points; // the corners, already turned
+        return;
+    }
+    if (stroke.shape == StrokeShape::Ellipse && !axisAligned){
+        stroke.shape = StrokeShape::Freehand;
+        stroke.handles.clear();
+        return;
+    }
+    for (auto& p : stroke.handles)
+        p = transform.apply(p);
+}
+
+void transformStrokes(std::vector<Stroke>& strokes, const std::vector<std::uint32_t>& indices, const GroupTransform& transform,
+    std::vector<Stroke>& before, std::vector<Stroke>& after){
+    before.reserve(before.size() + indices.size());
+    after.reserve(after.size() + indices.size());
+    for (std::uint32_t i : indices){
+        before.push_back(strokes[i]);
+        transformStroke(strokes[i], transform);
+        after.push_back(strokes[i]);
+    }
+}
+
+void eraseStrokes(std::vector<Stroke>& strokes, const std::vector<std::uint32_t>& indices, std::vector<Stroke>& erased){
+    erased.reserve(erased.size() + indices.size());
+    std::size_t kept = 0, next = 0;
+    for (std::size_t i = 0; i < strokes.size(); i++){
+        if (next < indices.size() && indices[next] == i){
+            erased.push_back(std::move(strokes[i]));
+            next++;
+            continue;
+        }
+        if (kept != i)
+            strokes[kept] = std::move(strokes[i]);
+        kept++;
+    }
+    strokes.resize(kept);
+}
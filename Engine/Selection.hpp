@@ -0,0 +1,43 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Stroke.hpp"
+#include "StrokeIndex.hpp"
+
+// whether each point is inside the polygon (even-odd rule), 1 or 0 into inside. SSE2 tests four
+// points against an edge at a time where the compiler targets it, with the same result as the scalar path
+void pointsInPolygon(const sf::Vector2f* points, std::size_t count, const std::vector<sf::Vector2f>& polygon, std::uint8_t* inside);
+// stops at the first point outside
+bool allInsidePolygon(const sf::Vector2f* points, std::size_t count, const std::vector<sf::Vector2f>& polygon);
+
+// the strokes entirely inside a rectangle, or inside a lasso's outline, as ascending indices. only
+// strokes the index finds near the area are tested
+void selectInRect(const std::vector<Stroke>& strokes, const StrokeIndex& index, sf::FloatRect area, std::vector<std::uint32_t>& out);
+void selectInPolygon(const std::vector<Stroke>& strokes, const StrokeIndex& index, const std::vector<sf::Vector2f>& polygon, std::vector<std::uint32_t>& out);
+
+// moves, uniformly scales and turns a group of strokes about its pivot: p' = pivot + offset + R(angle) * scale * (p - pivot)
+struct GroupTransform {
+    sf::Vector2f pivot;
+    sf::Vector2f offset;
+    float scale = 1.f;
+    float angle = 0.f; // radians
+
+    sf::Vector2f apply(sf::Vector2f p) const;
+    sf::Transform getTransform() const;
+    sf::Vector2f getCenter() const { return pivot + offset; } // where the pivot ends up
+    bool isIdentity() const { return offset == sf::Vector2f() && scale == 1.f && angle == 0.f; }
+    bool isAxisAligned() const; // turned by a multiple of a right angle, if at all
+};
+
+// rewrites a stroke through the transform: its points, curve and handles move and its thickness
+// scales. rectangles and ellipses turned off the axes become a polyline and a plain stroke, and
+// fill rectangles stay axis aligned, so fills should only be turned by right angles
+void transformStroke(Stroke& stroke, const GroupTransform& transform);
+// transformStroke on every stroke at indices, keeping each as it was and as it is now for a replace op
+void transformStrokes(std::vector<Stroke>& strokes, const std::vector<std::uint32_t>& indices, const GroupTransform& transform,
+    std::vector<Stroke>& before, std::vector<Stroke>& after);
+// moves the strokes at the ascending indices out of the list and into erased, in the same order
+void eraseStrokes(std::vector<Stroke>& strokes, const std::vector<std::uint32_t>& indices, std::vector<Stroke>& erased);
@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "ShadowRaster.hpp"
+#include "Simd.hpp"
+
+#define TILE_PIXELS (SHADOW_TILE_SIZE * SHADOW_TILE_SIZE)
+
+namespace {
+    int floorDiv(int v, int d){
+        return v >= 0 ? v / d : -((-v - 1) / d) - 1;
+    }
+
+    std::uint64_t tileKey(int tx, int ty){
+        return ((std::uint64_t)(std::uint32_t)tx << 32) | (std::uint32_t)ty;
+    }
+
+    // sf::BlendAlpha as SoftRaster does it: rgb = (src * a + dst * (255 - a) + 127) / 255, and alpha
+    // the same with src = 255. all four fit in 16 bits, and x / 255 == (x + 1 + (x >> 8)) >> 8 over
+    // that range, so the simd path can divide exactly
+    void blendPixels(std::uint8_t* p, int count, sf::Color color){
+        int i = 0;
+        if (color.a == 255){
+            std::uint8_t rgba[4] = {color.r, color.g, color.b, 255};
+            std::uint32_t packed;
+            std::memcpy(&packed, rgba, 4);
+#ifdef PIZARRA_SSE2
+            __m128i fill = _mm_set1_epi32((int)packed);
+            for (; i + 4 <= count; i += 4)
+                _mm_storeu_si128((__m128i*)(p + i * 4), fill);
+#endif
+            for (; i < count; i++)
+                std::memcpy(p + i * 4, &packed, 4);
+            return;
+        }
+        unsigned int a = color.a;
+        unsigned int ia = 255 - a;
+#ifdef PIZARRA_SSE2
+        __m128i zero = _mm_setzero_si128();
+        __m128i src = _mm_set_epi16((short)(255 * a), (short)(color.b * a), (short)(color.g * a), (short)(color.r * a),
+                                    (short)(255 * a), (short)(color.b * a), (short)(color.g * a), (short)(color.r * a));
+        src = _mm_add_epi16(src, _mm_set1_epi16(127));
+        __m128i inverse = _mm_set1_epi16((short)ia);
+        __m128i one = _mm_set1_epi16(1);
+        for (; i + 4 <= count; i += 4){
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + i * 4));
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), inverse), src);
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), inverse), src);
+            lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+            _mm_storeu_si128((__m128i*)(p + i * 4), _mm_packus_epi16(lo, hi));
+        }
+#endif
+        for (std::uint8_t* q = p + i * 4; i < count; i++, q += 4){
+            q[0] = (std::uint8_t)((color.r * a + q[0] * ia + 127) / 255);
+            q[1] = (std::uint8_t)((color.g * a + q[1] * ia + 127) / 255);
+            q[2] = (std::uint8_t)((color.b * a + q[2] * ia + 127) / 255);
+            q[3] = (std::uint8_t)(a + (q[3] * ia + 127) / 255);
+        }
+    }
+
+    // the rows a stroke's triangles may touch, a little generous: stamps are turned squares, so
+    // they reach past half the thickness
+    sf::IntRect pixelBounds(sf::FloatRect area){
+        int x0 = (int)std::floor(area.position.x) - 1;
+        int y0 = (int)std::floor(area.position.y) - 1;
+        int x1 = (int)std::ceil(area.position.x + area.size.x) + 1;
+        int y1 = (int)std::ceil(area.position.y + area.size.y) + 1;
+        return {{x0, y0}, {x1 - x0, y1 - y0}};
+    }
+
+    sf::FloatRect strokeReach(const Stroke& stroke){
+        sf::FloatRect bounds = stroke.getBounds();
+        float pad = stroke.thickness * 0.25f;
+        return {bounds.position - sf::Vector2f(pad, pad), bounds.size + sf::Vector2f(pad, pad) * 2.f};
+    }
+}
+
+ShadowRaster::ShadowRaster(sf::Color background, ShadowFormat format)
+    : m_background(background), m_format(format)
+{
+    m_palette.push_back(background);
+}
+
+std::uint8_t ShadowRaster::getIndex(sf::Color color){
+    for (std::size_t i = 0; i < m_palette.size(); i++)
+        if (m_palette[i] == color)
+            return (std::uint8_t)i;
+    if (m_palette.size() < SHADOW_PALETTE_SIZE){
+        m_palette.push_back(color);
+        return (std::uint8_t)(m_palette.size() - 1);
+    }
+    std::size_t nearest = 0;
+    int best = 1 << 30;
+    for (std::size_t i = 0; i < m_palette.size(); i++){
+        int dr = (int)m_palette[i].r - color.r, dg = (int)m_palette[i].g - color.g, db = (int)m_palette[i].b - color.b;
+        if (dr * dr + dg * dg + db * db < best){
+            best = dr * dr + dg * dg + db * db;
+            nearest = i;
+        }
+    }
+    return (std::uint8_t)nearest;
+}
+
+void ShadowRaster::clear(){
+    m_tiles.clear();
+    m_dirty.clear();
+    m_lastTile = nullptr;
+    m_version++;
+}
+
+void ShadowRaster::drawStroke(const Stroke& stroke){
+    m_scratch.clear();
+    tessellateStroke(stroke, m_scratch);
+    drawTriangles(m_scratch);
+    m_version++;
+}
+
+void ShadowRaster::rebuild(const std::vector<Stroke>& strokes){
+    clear();
+    for (const auto& stroke : strokes)
+        drawStroke(stroke);
+}
+
+void ShadowRaster::invalidate(const Stroke& stroke){
+    invalidate(strokeReach(stroke));
+}
+
+void ShadowRaster::invalidate(sf::FloatRect area){
+    sf::IntRect pixels = pixelBounds(area);
+    int tx0 = floorDiv(pixels.position.x, SHADOW_TILE_SIZE);
+    int ty0 = floorDiv(pixels.position.y, SHADOW_TILE_SIZE);
+    int tx1 = floorDiv(pixels.position.x + pixels.size.x, SHADOW_TILE_SIZE);
+    int ty1 = floorDiv(pixels.position.y + pixels.size.y, SHADOW_TILE_SIZE);
+    for (int ty = ty0; ty <= ty1; ty++)
+        for (int tx = tx0; tx <= tx1; tx++)
+            m_dirty.insert(tileKey(tx, ty));
+}
+
+void ShadowRaster::sync(const std::vector<Stroke>& strokes){
+    if (m_dirty.empty())
+        return;
+    // everything under the dirty tiles goes back to the background, and the strokes over them are
+    // drawn again with writes outside the dirty tiles dropped
+    int minX = 0, minY = 0, maxX = 0, maxY = 0;
+    bool first = true;
+    for (std::uint64_t key : m_dirty){
+        int tx = (int)(std::uint32_t)(key >> 32);
+        int ty = (int)(std::uint32_t)key;
+        if (first || tx < minX) minX = tx;
+        if (first || ty < minY) minY = ty;
+        if (first || tx > maxX) maxX = tx;
+        if (first || ty > maxY) maxY = ty;
+        first = false;
+        auto it = m_tiles.find(key);
+        if (it != m_tiles.end())
+            clearTile(*it->second);
+    }
+    sf::FloatRect dirtyArea({(float)minX * SHADOW_TILE_SIZE, (float)minY * SHADOW_TILE_SIZE},
+                            {(float)(maxX - minX + 1) * SHADOW_TILE_SIZE, (float)(maxY - minY + 1) * SHADOW_TILE_SIZE});
+    m_syncing = true;
+    m_lastTile = nullptr;
+    for (const auto& stroke : strokes){
+        if (!strokeReach(stroke).findIntersection(dirtyArea))
+            continue;
+        m_scratch.clear();
+        tessellateStroke(stroke, m_scratch);
+        drawTriangles(m_scratch);
+    }
+    m_syncing = false;
+    m_lastTile = nullptr;
+    // tiles the strokes left entirely are dropped again
+    for (std::uint64_t key : m_dirty){
+        auto it = m_tiles.find(key);
+        if (it == m_tiles.end())
+            continue;
+        // coverage, or indices, are all zero where nothing landed
+        const std::uint8_t* covered = it->second->data.data() + (m_format == ShadowFormat::Indexed ? 0 : TILE_PIXELS * 4);
+        if (std::find_if(covered, covered + TILE_PIXELS, [](std::uint8_t v){ return v != 0; }) == covered + TILE_PIXELS)
+            m_tiles.erase(it);
+    }
+    m_dirty.clear();
+    m_version++;
+}
+
+sf::Color ShadowRaster::getPixel(sf::Vector2i pos) const {
+    const Tile* tile = findTile(floorDiv(pos.x, SHADOW_TILE_SIZE), floorDiv(pos.y, SHADOW_TILE_SIZE));
+    if (!tile)
+        return m_background;
+    int lx = pos.x - floorDiv(pos.x, SHADOW_TILE_SIZE) * SHADOW_TILE_SIZE;
+    int ly = pos.y - floorDiv(pos.y, SHADOW_TILE_SIZE) * SHADOW_TILE_SIZE;
+    if (m_format == ShadowFormat::Indexed)
+        return m_palette[tile->data[ly * SHADOW_TILE_SIZE + lx]];
+    const std::uint8_t* p = tile->data.data() + (ly * SHADOW_TILE_SIZE + lx) * 4;
+    return sf::Color(p[0], p[1], p[2], p[3]);
+}
+
+bool ShadowRaster::isCovered(sf::Vector2i pos) const {
+    const Tile* tile = findTile(floorDiv(pos.x, SHADOW_TILE_SIZE), floorDiv(pos.y, SHADOW_TILE_SIZE));
+    if (!tile)
+        return false;
+    int lx = pos.x - floorDiv(pos.x, SHADOW_TILE_SIZE) * SHADOW_TILE_SIZE;
+    int ly = pos.y - floorDiv(pos.y, SHADOW_TILE_SIZE) * SHADOW_TILE_SIZE;
+    return tile->data[(m_format == ShadowFormat::Indexed ? 0 : TILE_PIXELS * 4) + ly * SHADOW_TILE_SIZE + lx] != 0;
+}
+
+void ShadowRaster::readPixels(sf::IntRect area, std::uint8_t* out) const {
+    std::uint8_t background[4] = {m_background.r, m_background.g, m_background.b, m_background.a};
+    for (int y = area.position.y; y < area.position.y + area.size.y; y++){
+        int ty = floorDiv(y, SHADOW_TILE_SIZE);
+        int ly = y - ty * SHADOW_TILE_SIZE;
+        // one copy per tile the row crosses
+        for (int x = area.position.x; x < area.position.x + area.size.x;){
+            int tx = floorDiv(x, SHADOW_TILE_SIZE);
+            int lx = x - tx * SHADOW_TILE_SIZE;
+            int count = std::min(SHADOW_TILE_SIZE - lx, area.position.x + area.size.x - x);
+            const Tile* tile = findTile(tx, ty);
+            if (tile && m_format == ShadowFormat::Indexed){
+                const std::uint8_t* index = tile->data.data() + ly * SHADOW_TILE_SIZE + lx;
+                for (int i = 0; i < count; i++){
+                    sf::Color c = m_palette[index[i]];
+                    out[i * 4] = c.r;
+                    out[i * 4 + 1] = c.g;
+                    out[i * 4 + 2] = c.b;
+                    out[i * 4 + 3] = c.a;
+                }
+            } else if (tile){
+                std::memcpy(out, tile->data.data() + (ly * SHADOW_TILE_SIZE + lx) * 4, (std::size_t)count * 4);
+            } else {
+                for (int i = 0; i < count; i++)
+                    std::memcpy(out + i * 4, background, 4);
+            }
+            out += count * 4;
+            x += count;
+        }
+    }
+}
+
+void ShadowRaster::readIndices(sf::IntRect area, std::uint8_t* out) const {
+    for (int y = area.position.y; y < area.position.y + area.size.y; y++){
+        int ty = floorDiv(y, SHADOW_TILE_SIZE);
+        int ly = y - ty * SHADOW_TILE_SIZE;
+        for (int x = area.position.x; x < area.position.x + area.size.x;){
+            int tx = floorDiv(x, SHADOW_TILE_SIZE);
+            int lx = x - tx * SHADOW_TILE_SIZE;
+            int count = std::min(SHADOW_TILE_SIZE - lx, area.position.x + area.size.x - x);
+            if (const Tile* tile = findTile(tx, ty))
+                std::memcpy(out, tile->data.data() + ly * SHADOW_TILE_SIZE + lx, count);
+            else
+                std::memset(out, 0, count);
+            out += count;
+            x += count;
+        }
+    }
+}
+
+sf::Image ShadowRaster::toImage(sf::IntRect area) const {
+    std::vector<std::uint8_t> pixels((std::size_t)area.size.x * area.size.y * 4);
+    readPixels(area, pixels.data());
+    sf::Image image;
+    image.resize(sf::Vector2u(area.size), pixels.data());
+    return image;
+}
+
+void ShadowRaster::drawTriangles(const sf::VertexArray& vertices){
+    const std::size_t vertexCount = vertices.getVertexCount();
+    sf::Color lastColor = m_background;
+    std::uint8_t lastIndex = 0;
+    for (std::size_t t = 0; t + 2 < vertexCount; t += 3){
+        sf::Vector2f v0 = vertices[t].position;
+        sf::Vector2f v1 = vertices[t + 1].position;
+        sf::Vector2f v2 = vertices[t + 2].position;
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (area == 0)
+            continue;
+        if (area < 0)
+            std::swap(v1, v2);
+        sf::Color color = vertices[t].color;
+        if (m_format == ShadowFormat::Indexed){
+            // a stroke is one colour, so the palette is searched about once per stroke
+            if (color != lastColor){
+                lastColor = color;
+                lastIndex = getIndex(color);
+            }
+            color = sf::Color(lastIndex, 0, 0); // fillSpan takes the index from r
+        }
+
+        int minY = (int)std::floor(std::min({v0.y, v1.y, v2.y}));
+        int maxY = (int)std::ceil(std::max({v0.y, v1.y, v2.y}));
+        float minX = std::min({v0.x, v1.x, v2.x});
+        float maxX = std::max({v0.x, v1.x, v2.x});
+        const sf::Vector2f edges[3][2] = {{v0, v1}, {v1, v2}, {v2, v0}};
+        // the left and right ends of each row's span, worked out as SoftRaster does it, bit for bit
+        for (int y = minY; y <= maxY; y += 4){
+            float left[4], right[4];
+            bool empty[4] = {false, false, false, false};
+#ifdef PIZARRA_SSE2
+            __m128 cy = _mm_add_ps(_mm_cvtepi32_ps(_mm_setr_epi32(y, y + 1, y + 2, y + 3)), _mm_set1_ps(0.5f));
+            __m128 l = _mm_set1_ps(minX);
+            __m128 r = _mm_set1_ps(maxX);
+            int emptyMask = 0;
+            for (const auto& edge : edges){
+                sf::Vector2f a = edge[0];
+                sf::Vector2f b = edge[1];
+                float dy = b.y - a.y;
+                float dx = b.x - a.x;
+                __m128 fromA = _mm_sub_ps(cy, _mm_set1_ps(a.y));
+                if (dy == 0){
+                    __m128 side = _mm_mul_ps(_mm_set1_ps(dx), fromA);
+                    emptyMask |= _mm_movemask_ps(_mm_cmplt_ps(side, _mm_setzero_ps()));
+                    if (dx < 0)
+                        emptyMask |= _mm_movemask_ps(_mm_cmpeq_ps(side, _mm_setzero_ps()));
+                    continue;
+                }
+                __m128 x = _mm_add_ps(_mm_set1_ps(a.x), _mm_div_ps(_mm_mul_ps(fromA, _mm_set1_ps(dx)), _mm_set1_ps(dy)));
+                if (dy > 0)
+                    r = _mm_min_ps(x, r);
+                else
+                    l = _mm_max_ps(x, l);
+            }
+            _mm_storeu_ps(left, l);
+            _mm_storeu_ps(right, r);
+            for (int i = 0; i < 4; i++)
+                empty[i] = (emptyMask >> i) & 1;
+#else
+            for (int i = 0; i < 4; i++){
+                float cy = (y + i) + 0.5f;
+                left[i] = minX;
+                right[i] = maxX;
+                for (const auto& edge : edges){
+                    sf::Vector2f a = edge[0];
+                    sf::Vector2f b = edge[1];
+                    float dy = b.y - a.y;
+                    float dx = b.x - a.x;
+                    if (dy == 0){
+                        float side = dx * (cy - a.y);
+                        if (side < 0 || (side == 0 && dx < 0))
+                            empty[i] = true;
+                        continue;
+                    }
+                    float x = a.x + (cy - a.y) * dx / dy;
+                    if (dy > 0)
+                        right[i] = std::min(right[i], x);
+                    else
+                        left[i] = std::max(left[i], x);
+                }
+            }
+#endif
+            for (int i = 0; i < 4 && y + i <= maxY; i++){
+                if (empty[i])
+                    continue;
+                // pixel centres in [left, right)
+                int x0 = (int)std::ceil(left[i] - 0.5f);
+                int x1 = (int)std::ceil(right[i] - 0.5f);
+                if (x0 < x1)
+                    fillSpan(y + i, x0, x1, color);
+            }
+        }
+    }
+}
+
+void ShadowRaster::fillSpan(int y, int x0, int x1, sf::Color color){
+    int ty = floorDiv(y, SHADOW_TILE_SIZE);
+    int ly = y - ty * SHADOW_TILE_SIZE;
+    while (x0 < x1){
+        int tx = floorDiv(x0, SHADOW_TILE_SIZE);
+        int lx = x0 - tx * SHADOW_TILE_SIZE;
+        int count = std::min(SHADOW_TILE_SIZE - lx, x1 - x0);
+        if (Tile* tile = tileAt(tx, ty, true)){
+            if (m_format == ShadowFormat::Indexed){
+                std::memset(tile->data.data() + ly * SHADOW_TILE_SIZE + lx, color.r, count);
+            } else {
+                blendPixels(tile->data.data() + (ly * SHADOW_TILE_SIZE + lx) * 4, count, color);
+                std::memset(tile->data.data() + TILE_PIXELS * 4 + ly * SHADOW_TILE_SIZE + lx, 255, count);
+            }
+        }
+        x0 += count;
+    }
+}
+
+ShadowRaster::Tile* ShadowRaster::tileAt(int tx, int ty, bool create){
+    std::uint64_t key = tileKey(tx, ty);
+    if (m_lastTile && m_lastKey == key)
+        return m_lastTile;
+    if (m_syncing && !m_dirty.count(key))
+        return nullptr;
+    auto it = m_tiles.find(key);
+    if (it == m_tiles.end()){
+        if (!create)
+            return nullptr;
+        auto tile = std::make_unique<Tile>();
+        tile->data.resize(getTileBytes());
+        clearTile(*tile);
+        it = m_tiles.emplace(key, std::move(tile)).first;
+    }
+    m_lastKey = key;
+    m_lastTile = it->second.get();
+    return m_lastTile;
+}
+
+const ShadowRaster::Tile* ShadowRaster::findTile(int tx, int ty) const {
+    auto it = m_tiles.find(tileKey(tx, ty));
+    return it == m_tiles.end() ? nullptr : it->second.get();
+}
+
+void ShadowRaster::clearTile(Tile& tile) const {
+    if (m_format == ShadowFormat::Indexed){
+        std::memset(tile.data.data(), 0, TILE_PIXELS);
+        return;
+    }
+    std::uint8_t background[4] = {m_background.r, m_background.g, m_background.b, m_background.a};
+    for (int i = 0; i < TILE_PIXELS; i++)
+        std::memcpy(tile.data.data() + i * 4, background, 4);
+    std::memset(tile.data.data() + TILE_PIXELS * 4, 0, TILE_PIXELS);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Stroke.hpp"
+
+#define SHADOW_TILE_SIZE 64 // pixels per tile side
+#define SHADOW_PALETTE_SIZE 256
+
+// Rgba keeps each pixel's colour and a coverage byte. Indexed keeps one byte, an index into the
+// raster's palette, a fifth of the memory: strokes are painted in their colour's index with no
+// blending (alpha is dropped), and index 0 is the background, so that's what's uncovered
+enum class ShadowFormat : std::uint8_t {
+    Rgba,
+    Indexed
+};
+
+// CPU copy of what the strokes look like, in world pixels, so eyedropper, fill, collision and export
+// read plain memory instead of waiting on copyToImage. the world is cut into tiles that only exist
+// where something was drawn; each holds RGBA plus a coverage byte that says whether any ink landed
+// on the pixel, or just palette indices (see ShadowFormat). strokes are scanline rasterized with the same rules as SoftRaster (and so as the GPU
+// draws untextured triangles), span edges four rows at a time and spans four pixels at a time with
+// SSE2 where the compiler targets it. stamps come out as plain quads of their colour.
+// adding a stroke draws it straight in; anything that takes strokes away invalidates what they
+// covered, and sync() redraws just those tiles from the stroke list
+class ShadowRaster {
+public:
+    explicit ShadowRaster(sf::Color background = sf::Color::White, ShadowFormat format = ShadowFormat::Rgba);
+
+    void clear();
+    void drawStroke(const Stroke& stroke);
+    void rebuild(const std::vector<Stroke>& strokes);
+
+    // marks the tiles under a stroke, or an area, to be redrawn by the next sync
+    void invalidate(const Stroke& stroke);
+    void invalidate(sf::FloatRect area);
+    // redraws invalidated tiles from the strokes that touch them, in list order
+    void sync(const std::vector<Stroke>& strokes);
+    bool isDirty() const { return !m_dirty.empty(); }
+
+    // background wherever nothing was drawn
+    sf::Color getPixel(sf::Vector2i pos) const;
+    bool isCovered(sf::Vector2i pos) const;
+    // RGBA rows of the area, tightly packed, into out (area.size.x * area.size.y * 4 bytes)
+    void readPixels(sf::IntRect area, std::uint8_t* out) const;
+    // palette indices of the area, one byte per pixel. Indexed format only
+    void readIndices(sf::IntRect area, std::uint8_t* out) const;
+    sf::Image toImage(sf::IntRect area) const;
+
+    ShadowFormat getFormat() const { return m_format; }
+    // colours get an index the first time they're drawn, the nearest one's once all are taken
+    std::uint8_t getIndex(sf::Color color);
+    const std::vector<sf::Color>& getPalette() const { return m_palette; } // [0] is the background
+
+    std::size_t getTileCount() const { return m_tiles.size(); }
+    std::size_t getResidentBytes() const { return m_tiles.size() * getTileBytes(); }
+    // changes whenever any pixel may have, for callers that keep copies
+    std::uint64_t getVersion() const { return m_version; }
+
+private:
+    // Rgba: the pixels, then the coverage. Indexed: the indices
+    struct Tile {
+        std::vector<std::uint8_t> data;
+    };
+
+    std::size_t getTileBytes() const { return (std::size_t)SHADOW_TILE_SIZE * SHADOW_TILE_SIZE * (m_format == ShadowFormat::Indexed ? 1 : 5); }
+    void drawTriangles(const sf::VertexArray& vertices);
+    void fillSpan(int y, int x0, int x1, sf::Color color);
+    Tile* tileAt(int tx, int ty, bool create);
+    const Tile* findTile(int tx, int ty) const;
+    void clearTile(Tile& tile) const;
+
+    sf::Color m_background;
+    ShadowFormat m_format;
+    std::vector<sf::Color> m_palette;
+    std::unordered_map<std::uint64_t, std::unique_ptr<Tile>> m_tiles;
+    std::unordered_set<std::uint64_t> m_dirty;
+    bool m_syncing = false;   // only dirty tiles are drawn to, and get created
+    std::uint64_t m_lastKey = 0;
+    Tile* m_lastTile = nullptr; // spans mostly land in the same tile as the one before
+    std::uint64_t m_version = 0;
+    sf::VertexArray m_scratch{sf::PrimitiveType::Triangles};
+};
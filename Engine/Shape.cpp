@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Shape.hpp"
+
+#define SHAPE_PI 3.14159265f
+
+// chords a circle of that radius needs over angle so none strays more than tolerance from it
+static int getArcSegments(float radius, float angle, float tolerance){
+    float step = radius > tolerance ? 2.f * std::acos(1.f - tolerance / radius) : SHAPE_PI / 2.f;
+    int segments = (int)std::ceil(std::abs(angle) / std::max(step, 1e-4f));
+    return std::clamp(segments, 1, SHAPE_MAX_SEGMENTS);
+}
+
+static float wrapAngle(float angle){
+    angle = std::fmod(angle, 2.f * SHAPE_PI);
+    return angle < 0.f ? angle + 2.f * SHAPE_PI : angle;
+}
+
+static void flattenArc(sf::Vector2f a, sf::Vector2f b, sf::Vector2f c, std::vector<sf::Vector2f>& out, float tolerance){
+    // the circle through all three, or a straight line when they're (nearly) collinear
+    float d = 2.f * (a.x * (b.y - c.y) + b.x * (c.y - a.y) + c.x * (a.y - b.y));
+    float span = std::max(std::hypot(c.x - a.x, c.y - a.y), std::hypot(b.x - a.x, b.y - a.y));
+    if (std::abs(d) <= 1e-4f * span * span){
+        out.push_back(a);
+        out.push_back(c);
+        return;
+    }
+    float aa = a.x * a.x + a.y * a.y, bb = b.x * b.x + b.y * b.y, cc = c.x * c.x + c.y * c.y;
+    sf::Vector2f center((aa * (b.y - c.y) + bb * (c.y - a.y) + cc * (a.y - b.y)) / d, (aa * (c.x - b.x) + bb * (a.x - c.x) + cc * (b.x - a.x)) / d);
+    float radius = std::hypot(a.x - center.x, a.y - center.y);
+    float start = std::atan2(a.y - center.y, a.x - center.x);
+    float sweep = wrapAngle(std::atan2(c.y - center.y, c.x - center.x) - start);
+    // whichever way round passes through b
+    if (wrapAngle(std::atan2(b.y - center.y, b.x - center.x) - start) > sweep)
+        sweep -= 2.f * SHAPE_PI;
+    int segments = getArcSegments(radius, sweep, tolerance);
+    out.push_back(a);
+    for (int i = 1; i < segments; i++){
+        float angle = start + sweep * i / segments;
+        out.push_back(center + sf::Vector2f(std::cos(angle), std::sin(angle)) * radius);
+    }
+    out.push_back(c);
+}
+
+bool isValidShape(StrokeShape shape, std::size_t handleCount){
+    switch (shape){
+        case StrokeShape::Freehand: return handleCount == 0;
+        case StrokeShape::Line:
+        case StrokeShape::Rect:
+        case StrokeShape::Ellipse: return handleCount == 2;
+        case StrokeShape::Arc: return handleCount == 3;
+        case StrokeShape::Polyline: return handleCount >= 2;
+    }
+    return false;
+}
+
+void flattenShape(StrokeShape shape, const std::vector<sf::Vector2f>& handles, std::vector<sf::Vector2f>& out, float tolerance){
+    if (!isValidShape(shape, handles.size()) || shape == StrokeShape::Freehand)
+        return;
+    switch (shape){
+        case StrokeShape::Line:
+        case StrokeShape::Polyline:
+            out.insert(out.end(), handles.begin(), handles.end());
+            break;
+        case StrokeShape::Rect: {
+            sf::Vector2f a = handles[0], b = handles[1];
+            out.insert(out.end(), {a, {b.x, a.y}, b, {a.x, b.y}, a});
+            break;
+        }
+        case StrokeShape::Ellipse: {
+            sf::Vector2f center = (handles[0] + handles[1]) / 2.f;
+            sf::Vector2f radii(std::abs(handles[1].x - handles[0].x) / 2.f, std::abs(handles[1].y - handles[0].y) / 2.f);
+            // an ellipse is a circle of its longer radius squashed along one axis, which only brings its chords closer
+            int segments = std::max(getArcSegments(std::max(radii.x, radii.y), 2.f * SHAPE_PI, tolerance), 8);
+            for (int i = 0; i < segments; i++){
+                float angle = 2.f * SHAPE_PI * i / segments;
+                out.push_back(center + sf::Vector2f(std::cos(angle) * radii.x, std::sin(angle) * radii.y));
+            }
+            out.push_back(out[out.size() - segments]);
+            break;
+        }
+        case StrokeShape::Arc:
+            flattenArc(handles[0], handles[1], handles[2], out, tolerance);
+            break;
+        default:
+            break;
+    }
+}
+
+Stroke makeShapeStroke(StrokeShape shape, std::vector<sf::Vector2f> handles, sf::Color color, float thickness){
+    Stroke stroke;
+    stroke.color = color;
+    stroke.thickness = thickness;
+    stroke.shape = shape;
+    stroke.handles = std::move(handles);
+    flattenShape(stroke.shape, stroke.handles, stroke.points);
+    return stroke;
+}
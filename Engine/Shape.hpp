@@ -0,0 +1,17 @@
+#pragma once
+#include <SFML/System/Vector2.hpp>
+#include <cstddef>
+#include <vector>
+
+#include "Stroke.hpp"
+
+#define SHAPE_MAX_SEGMENTS 4096 // chords a curved shape is flattened into at most
+
+// whether a shape takes that many handles
+bool isValidShape(StrokeShape shape, std::size_t handleCount);
+// appends points along the shape's outline, close enough that the polyline strays at most
+// tolerance from it. curves get more points the bigger they are, straight edges only their
+// corners, and closed shapes end on their first point
+void flattenShape(StrokeShape shape, const std::vector<sf::Vector2f>& handles, std::vector<sf::Vector2f>& out, float tolerance = 0.25f);
+// a solid stroke of the shape, its points flattened from the handles
+Stroke makeShapeStroke(StrokeShape shape, std::vector<sf::Vector2f> handles, sf::Color color, float thickness);
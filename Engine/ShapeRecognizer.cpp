@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ShapeRecognizer.hpp"
+
+namespace {
+    float dot(sf::Vector2f a, sf::Vector2f b){
+        return a.x * b.x + a.y * b.y;
+    }
+
+    float cross(sf::Vector2f a, sf::Vector2f b){
+        return a.x * b.y - a.y * b.x;
+    }
+
+    float length(sf::Vector2f v){
+        return std::sqrt(dot(v, v));
+    }
+
+    // an infinite line through point, direction is unit length
+    struct FitLine {
+        sf::Vector2f point;
+        sf::Vector2f direction;
+    };
+
+    struct FitError {
+        float rms = 0.f;
+        float max = 0.f;
+    };
+
+    // total least squares: through the centroid, along the points' principal axis
+    FitLine fitLine(const sf::Vector2f* points, std::size_t count){
+        sf::Vector2f centroid;
+        for (std::size_t i = 0; i < count; i++)
+            centroid += points[i];
+        centroid /= (float)count;
+        float sxx = 0.f, sxy = 0.f, syy = 0.f;
+        for (std::size_t i = 0; i < count; i++){
+            sf::Vector2f d = points[i] - centroid;
+            sxx += d.x * d.x;
+            sxy += d.x * d.y;
+            syy += d.y * d.y;
+        }
+        float angle = 0.5f * std::atan2(2.f * sxy, sxx - syy);
+        return {centroid, {std::cos(angle), std::sin(angle)}};
+    }
+
+    float distanceTo(const FitLine& line, sf::Vector2f p){
+        return std::abs(cross(line.direction, p - line.point));
+    }
+
+    sf::Vector2f project(const FitLine& line, sf::Vector2f p){
+        return line.point + line.direction * dot(p - line.point, line.direction);
+    }
+
+    // where two lines cross, or false when they're too close to parallel to say
+    bool intersect(const FitLine& a, const FitLine& b, sf::Vector2f& out){
+        float denominator = cross(a.direction, b.direction);
+        if (std::abs(denominator) < 0.2f)
+            return false;
+        out = a.point + a.direction * (cross(b.point - a.point, b.direction) / denominator);
+        return true;
+    }
+
+    void accumulate(FitError& error, float distance, std::size_t& count){
+        error.rms += distance * distance;
+        error.max = std::max(error.max, distance);
+        count++;
+    }
+
+    void finish(FitError& error, std::size_t count){
+        error.rms = count ? std::sqrt(error.rms / count) : 0.f;
+    }
+
+    // gaussian elimination with partial pivoting, a is n x n row major and b becomes the solution
+    bool solve(double* a, double* b, int n){
+        for (int col = 0; col < n; col++){
+            int pivot = col;
+            for (int row = col + 1; row < n; row++)
+                if (std::abs(a[row * n + col]) > std::abs(a[pivot * n + col]))
+                    pivot = row;
+            if (std::abs(a[pivot * n + col]) < 1e-12)
+                return false;
+            if (pivot != col){
+                for (int k = 0; k < n; k++)
+                    std::swap(a[col * n + k], a[pivot * n + k]);
+                std::swap(b[col], b[pivot]);
+            }
+            for (int row = col + 1; row < n; row++){
+                double f = a[row * n + col] / a[col * n + col];
+                for (int k = col; k < n; k++)
+                    a[row * n + k] -= f * a[col * n + k];
+                b[row] -= f * b[col];
+            }
+        }
+        for (int row = n - 1; row >= 0; row--){
+            for (int k = row + 1; k < n; k++)
+                b[row] -= a[row * n + k] * b[k];
+            b[row] /= a[row * n + row];
+        }
+        return true;
+    }
+
+    // the points around their centroid and scaled to about unit size, so the normal equations stay well conditioned
+    struct Normalized {
+        sf::Vector2f origin;
+        float scale;
+        double u(sf::Vector2f p) const { return (p.x - origin.x) / scale; }
+        double v(sf::Vector2f p) const { return (p.y - origin.y) / scale; }
+    };
+
+    // Kåsa's circle fit: least squares on x² + y² + Dx + Ey + F = 0, which is linear
+    bool fitCircle(const std::vector<sf::Vector2f>& points, const Normalized& n, sf::Vector2f& center, float& radius){
+        double a[9] = {}, b[3] = {};
+        for (const auto& p : points){
+            double f[3] = {n.u(p), n.v(p), 1.0};
+            double rhs = -(f[0] * f[0] + f[1] * f[1]);
+            for (int i = 0; i < 3; i++){
+                for (int j = 0; j < 3; j++)
+                    a[i * 3 + j] += f[i] * f[j];
+                b[i] += f[i] * rhs;
+            }
+        }
+        if (!solve(a, b, 3))
+            return false;
+        double cu = -b[0] / 2.0, cv = -b[1] / 2.0;
+        double r2 = cu * cu + cv * cv - b[2];
+        if (r2 <= 0.0)
+            return false;
+        center = n.origin + sf::Vector2f((float)cu, (float)cv) * n.scale;
+        radius = (float)std::sqrt(r2) * n.scale;
+        return true;
+    }
+
+    // least squares on Ax² + Cy² + Dx + Ey = 1, an ellipse whose axes are the world's
+    bool fitEllipse(const std::vector<sf::Vector2f>& points, const Normalized& n, sf::Vector2f& center, sf::Vector2f& radii){
+        double a[16] = {}, b[4] = {};
+        for (const auto& p : points){
+            double u = n.u(p), v = n.v(p);
+            double f[4] = {u * u, v * v, u, v};
+            for (int i = 0; i < 4; i++){
+                for (int j = 0; j < 4; j++)
+                    a[i * 4 + j] += f[i] * f[j];
+                b[i] += f[i];
+            }
+        }
+        if (!solve(a, b, 4) || b[0] <= 0.0 || b[1] <= 0.0)
+            return false;
+        double cu = -b[2] / (2.0 * b[0]), cv = -b[3] / (2.0 * b[1]);
+        double g = 1.0 + b[0] * cu * cu + b[1] * cv * cv;
+        if (g <= 0.0)
+            return false;
+        center = n.origin + sf::Vector2f((float)cu, (float)cv) * n.scale;
+        radii = sf::Vector2f((float)std::sqrt(g / b[0]), (float)std::sqrt(g / b[1])) * n.scale;
+        return true;
+    }
+
+    // Ramer-Douglas-Peucker, the indices of the points it keeps, ends included
+    void simplify(const std::vector<sf::Vector2f>& points, float epsilon, std::vector<std::size_t>& keep){
+        std::vector<bool> kept(points.size(), false);
+        kept.front() = kept.back() = true;
+        std::vector<std::pair<std::size_t, std::size_t>> stack{{0, points.size() - 1}};
+        while (!stack.empty()){
+            auto [first, last] = stack.back();
+            stack.pop_back();
+            sf::Vector2f chord = points[last] - points[first];
+            float chordLength = length(chord);
+            float farthest = 0.f;
+            std::size_t index = first;
+            for (std::size_t i = first + 1; i < last; i++){
+                sf::Vector2f d = points[i] - points[first];
+                float distance = chordLength > 0.f ? std::abs(cross(chord, d)) / chordLength : length(d);
+                if (distance > farthest){
+                    farthest = distance;
+                    index = i;
+                }
+            }
+            if (farthest > epsilon){
+                kept[index] = true;
+                stack.push_back({first, index});
+                stack.push_back({index, last});
+            }
+        }
+        keep.clear();
+        for (std::size_t i = 0; i < points.size(); i++)
+            if (kept[i])
+                keep.push_back(i);
+    }
+
+    float turnAngle(sf::Vector2f in, sf::Vector2f out){
+        return std::abs(std::atan2(cross(in, out), dot(in, out)));
+    }
+
+    // drops the simplified vertices that barely turn, the flattest first, until every one left is a
+    // corner. closed outlines can lose their first vertex too
+    void keepCorners(const std::vector<sf::Vector2f>& points, std::vector<std::size_t>& corners, bool closed){
+        while (corners.size() > 2){
+            std::size_t count = corners.size();
+            std::size_t flattest = 0;
+            float smallest = RECOGNIZE_CORNER_ANGLE;
+            for (std::size_t i = closed ? 0 : 1; i < (closed ? count : count - 1); i++){
+                sf::Vector2f p = points[corners[i]];
+                sf::Vector2f previous = points[corners[(i + count - 1) % count]];
+                sf::Vector2f next = points[corners[(i + 1) % count]];
+                float angle = turnAngle(p - previous, next - p);
+                if (angle < smallest){
+                    smallest = angle;
+                    flattest = i;
+                }
+            }
+            if (smallest >= RECOGNIZE_CORNER_ANGLE)
+                return;
+            corners.erase(corners.begin() + flattest);
+        }
+    }
+
+    // the points from one corner to the next, wrapping around a closed outline
+    void gatherSide(const std::vector<sf::Vector2f>& points, std::size_t from, std::size_t to, std::vector<sf::Vector2f>& out){
+        out.clear();
+        for (std::size_t i = from; i != to; i = (i + 1) % points.size())
+            out.push_back(points[i]);
+        out.push_back(points[to]);
+    }
+
+    // corners found on the simplified points, then every side refitted as a line through the
+    // points between its corners, and the corners moved to where neighbouring sides cross
+    bool fitPolyline(const std::vector<sf::Vector2f>& points, float tolerance, bool closed, ShapeGuess& out, std::vector<FitLine>& sides){
+        std::vector<std::size_t> corners;
+        simplify(points, tolerance * 2.f, corners);
+        if (closed)
+            corners.pop_back(); // the last point is back at the first
+        keepCorners(points, corners, closed);
+        std::size_t sideCount = closed ? corners.size() : corners.size() - 1;
+        if (sideCount < (closed ? 3u : 2u) || sideCount > RECOGNIZE_MAX_CORNERS)
+            return false;
+
+        sides.clear();
+        FitError error;
+        std::size_t count = 0;
+        std::vector<sf::Vector2f> side;
+        for (std::size_t i = 0; i < sideCount; i++){
+            gatherSide(points, corners[i], corners[(i + 1) % corners.size()], side);
+            sides.push_back(fitLine(side.data(), side.size()));
+            for (const auto& p : side)
+                accumulate(error, distanceTo(sides.back(), p), count);
+        }
+        finish(error, count);
+        if (error.rms > tolerance || error.max > tolerance * 3.f)
+            return false;
+
+        out.handles.clear();
+        if (!closed)
+            out.handles.push_back(project(sides.front(), points.front()));
+        for (std::size_t i = closed ? 0 : 1; i < corners.size(); i++){
+            if (!closed && i == corners.size() - 1)
+                break;
+            sf::Vector2f corner;
+            if (!intersect(sides[(i + sideCount - 1) % sideCount], sides[i % sideCount], corner))
+                corner = points[corners[i]];
+            out.handles.push_back(corner);
+        }
+        if (closed)
+            out.handles.push_back(out.handles.front());
+        else
+            out.handles.push_back(project(sides.back(), points.back()));
+        out.shape = StrokeShape::Polyline;
+        out.error = error.rms;
+        return true;
+    }
+
+    // a closed outline of four sides, each within RECOGNIZE_AXIS_ANGLE of an axis and alternating
+    bool fitRect(const std::vector<sf::Vector2f>& points, const std::vector<FitLine>& sides, float tolerance, ShapeGuess& out){
+        if (sides.size() != 4)
+            return false;
+        float lean = std::sin(RECOGNIZE_AXIS_ANGLE);
+        bool firstHorizontal = std::abs(sides[0].direction.y) <= lean;
+        for (std::size_t i = 0; i < 4; i++){
+            bool horizontal = (i % 2 == 0) == firstHorizontal;
+            if (std::abs(horizontal ? sides[i].direction.y : sides[i].direction.x) > lean)
+                return false;
+        }
+        // the sides pass through their points' centroids, so those give the least squares edges
+        float x[2], y[2];
+        for (std::size_t i = 0, h = 0, v = 0; i < 4; i++){
+            if ((i % 2 == 0) == firstHorizontal)
+                y[h++] = sides[i].point.y;
+            else
+                x[v++] = sides[i].point.x;
+        }
+        sf::Vector2f min(std::min(x[0], x[1]), std::min(y[0], y[1]));
+        sf::Vector2f max(std::max(x[0], x[1]), std::max(y[0], y[1]));
+        FitError error;
+        std::size_t count = 0;
+        for (const auto& p : points){
+            float dx = std::min(std::abs(p.x - min.x), std::abs(p.x - max.x));
+            float dy = std::min(std::abs(p.y - min.y), std::abs(p.y - max.y));
+            accumulate(error, std::min(dx, dy), count);
+        }
+        finish(error, count);
+        if (error.rms > tolerance || error.max > tolerance * 3.f)
+            return false;
+        out.shape = StrokeShape::Rect;
+        out.handles = {min, max};
+        out.error = error.rms;
+        return true;
+    }
+}
+
+ShapeGuess recognizeShape(const std::vector<sf::Vector2f>& points){
+    ShapeGuess guess;
+    if (points.size() < 3)
+        return guess;
+    sf::Vector2f min = points[0], max = points[0];
+    for (const auto& p : points){
+        min = {std::min(min.x, p.x), std::min(min.y, p.y)};
+        max = {std::max(max.x, p.x), std::max(max.y, p.y)};
+    }
+    float diagonal = length(max - min);
+    if (diagonal < RECOGNIZE_MIN_SIZE)
+        return guess;
+    float tolerance = std::max(diagonal * RECOGNIZE_TOLERANCE, 1.f);
+    bool closed = length(points.back() - points.front()) <= diagonal * RECOGNIZE_CLOSE_GAP;
+    Normalized normalized{(min + max) / 2.f, diagonal / 2.f};
+    std::vector<FitLine> sides;
+
+    if (!closed){
+        FitLine line = fitLine(points.data(), points.size());
+        FitError error;
+        std::size_t count = 0;
+        for (const auto& p : points)
+            accumulate(error, distanceTo(line, p), count);
+        finish(error, count);
+        if (error.rms <= tolerance && error.max <= tolerance * 3.f){
+            guess.shape = StrokeShape::Line;
+            guess.handles = {project(line, points.front()), project(line, points.back())};
+            guess.error = error.rms;
+            return guess;
+        }
+
+        sf::Vector2f center;
+        float radius;
+        if (fitCircle(points, normalized, center, radius) && radius < diagonal * 4.f){
+            error = FitError();
+            count = 0;
+            for (const auto& p : points)
+                accumulate(error, std::abs(length(p - center) - radius), count);
+            finish(error, count);
+            if (error.rms <= tolerance && error.max <= tolerance * 3.f){
+                auto onCircle = [&center, radius](sf::Vector2f p){
+                    sf::Vector2f d = p - center;
+                    float l = length(d);
+                    return l > 0.f ? center + d * (radius / l) : p;
+                };
+                guess.shape = StrokeShape::Arc;
+                guess.handles = {onCircle(points.front()), onCircle(points[points.size() / 2]), onCircle(points.back())};
+                guess.error = error.rms;
+                return guess;
+            }
+        }
+        if (fitPolyline(points, tolerance, false, guess, sides))
+            return guess;
+        return ShapeGuess();
+    }
+
+    bool polygon = fitPolyline(points, tolerance, true, guess, sides);
+    if (polygon && fitRect(points, sides, tolerance, guess))
+        return guess;
+    sf::Vector2f center, radii;
+    if (fitEllipse(points, normalized, center, radii)){
+        FitError error;
+        std::size_t count = 0;
+        for (const auto& p : points){
+            // along the ray from the centre, close to the true distance for anything round enough to pass
+            sf::Vector2f d = p - center;
+            float rho = std::sqrt((d.x / radii.x) * (d.x / radii.x) + (d.y / radii.y) * (d.y / radii.y));
+            accumulate(error, rho > 0.f ? length(d) * std::abs(1.f - 1.f / rho) : std::min(radii.x, radii.y), count);
+        }
+        finish(error, count);
+        // a circle also passes as a polygon with enough sides, but never as closely
+        if (error.rms <= tolerance && error.max <= tolerance * 3.f && (!polygon || error.rms < guess.error)){
+            guess.shape = StrokeShape::Ellipse;
+            guess.handles = {center - radii, center + radii};
+            guess.error = error.rms;
+            return guess;
+        }
+    }
+    if (polygon)
+        return guess;
+    return ShapeGuess();
+}
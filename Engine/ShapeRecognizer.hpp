@@ -0,0 +1,25 @@
+#pragma once
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+
+#include "Stroke.hpp"
+
+#define RECOGNIZE_TOLERANCE 0.03f   // how far a fit may stray on average, as a fraction of the stroke's diagonal
+#define RECOGNIZE_CLOSE_GAP 0.15f   // ends closer than this fraction of the diagonal make a closed stroke
+#define RECOGNIZE_MIN_SIZE 12.f     // world units across, smaller strokes are left as drawn
+#define RECOGNIZE_MAX_CORNERS 8
+#define RECOGNIZE_CORNER_ANGLE 0.5f // radians a simplified outline has to turn for a corner
+#define RECOGNIZE_AXIS_ANGLE 0.26f  // radians a side may lean and still make a rectangle
+
+// a primitive a freehand stroke looks like, with handles for makeShapeStroke
+struct ShapeGuess {
+    StrokeShape shape = StrokeShape::Freehand;
+    std::vector<sf::Vector2f> handles;
+    float error = 0.f; // rms distance of the stroke's points from the shape
+};
+
+// fits lines, circles and axis aligned ellipses by least squares, and finds corners on a simplified
+// copy of the points for rectangles and polylines, whose sides are then fitted as lines. the simplest
+// shape that fits wins, Freehand when none does. touches nothing but its arguments, so it can run on
+// any thread
+ShapeGuess recognizeShape(const std::vector<sf::Vector2f>& points);
@@ -0,0 +1,8 @@
+#pragma once
+
+// PIZARRA_SSE2 is defined wherever the compiler targets SSE2 (every x64 build, and x86 with it
+// enabled), with the intrinsics included. code using it keeps a plain loop for everything else
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PIZARRA_SSE2 1
+#endif
@@ -0,0 +1,137 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "SoftRaster.hpp"
+
+SoftRaster::SoftRaster(sf::Vector2u size, sf::Color color){
+    resize(size, color);
+}
+
+void SoftRaster::resize(sf::Vector2u size, sf::Color color){
+    m_size = size;
+    m_pixels.resize((std::size_t)size.x * size.y * 4);
+    clear(color);
+}
+
+void SoftRaster::clear(sf::Color color){
+    for (std::size_t i = 0; i < m_pixels.size(); i += 4){
+        m_pixels[i] = color.r;
+        m_pixels[i + 1] = color.g;
+        m_pixels[i + 2] = color.b;
+        m_pixels[i + 3] = color.a;
+    }
+}
+
+void SoftRaster::blendSpan(std::uint8_t* row, int x0, int x1, sf::Color color){
+    std::uint8_t* p = row + (std::size_t)x0 * 4;
+    if (color.a == 255){
+        for (int x = x0; x < x1; x++, p += 4){
+            p[0] = color.r;
+            p[1] = color.g;
+            p[2] = color.b;
+            p[3] = 255;
+        }
+        return;
+    }
+    // sf::BlendAlpha: rgb = src * srcA + dst * (1 - srcA), a = src + dst * (1 - srcA)
+    unsigned int a = color.a;
+    unsigned int ia = 255 - a;
+    for (int x = x0; x < x1; x++, p += 4){
+        p[0] = (std::uint8_t)((color.r * a + p[0] * ia + 127) / 255);
+        p[1] = (std::uint8_t)((color.g * a + p[1] * ia + 127) / 255);
+        p[2] = (std::uint8_t)((color.b * a + p[2] * ia + 127) / 255);
+        p[3] = (std::uint8_t)(a + (p[3] * ia + 127) / 255);
+    }
+}
+
+void SoftRaster::drawTriangles(const sf::Vertex* vertices, std::size_t vertexCount, sf::Vector2f offset){
+    for (std::size_t t = 0; t + 2 < vertexCount; t += 3){
+        sf::Vector2f v0 = vertices[t].position + offset;
+        sf::Vector2f v1 = vertices[t + 1].position + offset;
+        sf::Vector2f v2 = vertices[t + 2].position + offset;
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (area == 0)
+            continue;
+        if (area < 0)
+            std::swap(v1, v2); // always walk the edges the same way round
+        // strokes are one colour, the first vertex decides
+        sf::Color color = vertices[t].color;
+
+        int minY = std::max(0, (int)std::floor(std::min({v0.y, v1.y, v2.y})));
+        int maxY = std::min((int)m_size.y - 1, (int)std::ceil(std::max({v0.y, v1.y, v2.y})));
+        float minX = std::min({v0.x, v1.x, v2.x});
+        float maxX = std::max({v0.x, v1.x, v2.x});
+        const sf::Vector2f edges[3][2] = {{v0, v1}, {v1, v2}, {v2, v0}};
+        for (int y = minY; y <= maxY; y++){
+            // intersect the pixel centre row with the three edge half planes to get one span
+            float cy = y + 0.5f;
+            float left = minX;
+            float right = maxX;
+            bool empty = false;
+            for (const auto& edge : edges){
+                sf::Vector2f a = edge[0];
+                sf::Vector2f b = edge[1];
+                float dy = b.y - a.y;
+                float dx = b.x - a.x;
+                if (dy == 0){
+                    // horizontal edge: the row is inside or outside as a whole (top-left rule on the boundary)
+                    float side = dx * (cy - a.y);
+                    if (side < 0 || (side == 0 && dx < 0))
+                        empty = true;
+                    continue;
+                }
+                float x = a.x + (cy - a.y) * dx / dy;
+                if (dy > 0)
+                    right = std::min(right, x); // inside is to the left of downward edges
+                else
+                    left = std::max(left, x);
+            }
+            if (empty)
+                continue;
+            // pixel centres in [left, right)
+            int x0 = std::max(0, (int)std::ceil(left - 0.5f));
+            int x1 = std::min((int)m_size.x, (int)std::ceil(right - 0.5f));
+            if (x0 < x1)
+                blendSpan(&m_pixels[(std::size_t)y * m_size.x * 4], x0, x1, color);
+        }
+    }
+}
+
+void SoftRaster::drawTriangles(const sf::VertexArray& vertices, sf::Vector2f offset){
+    if (vertices.getVertexCount() > 0)
+        drawTriangles(&vertices[0], vertices.getVertexCount(), offset);
+}
+
+void SoftRaster::drawStroke(const Stroke& stroke, sf::Vector2f offset){
+    m_scratch.clear();
+    tessellateStroke(stroke, m_scratch, offset);
+    drawTriangles(m_scratch);
+}
+
+sf::Color SoftRaster::getPixel(unsigned int x, unsigned int y) const {
+    const std::uint8_t* p = &m_pixels[((std::size_t)y * m_size.x + x) * 4];
+    return sf::Color(p[0], p[1], p[2], p[3]);
+}
+
+sf::Image SoftRaster::toImage() const {
+    sf::Image image;
+    image.resize(m_size, m_pixels.data());
+    return image;
+}
+
+std::size_t SoftRaster::countDifferences(const SoftRaster& other, int tolerance) const {
+    if (other.m_size != m_size)
+        return (std::size_t)m_size.x * m_size.y;
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < m_pixels.size(); i += 4){
+        for (int c = 0; c < 4; c++){
+            if (std::abs((int)m_pixels[i + c] - (int)other.m_pixels[i + c]) > tolerance){
+                count++;
+                break;
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Stroke.hpp"
+
+// CPU triangle rasterizer producing the same pixels as drawing untextured triangles with
+// sf::BlendAlpha, so canvas output can be checked without a window or GPU. textures are ignored,
+// so stamped strokes come out as their quads
+class SoftRaster {
+public:
+    SoftRaster() = default;
+    SoftRaster(sf::Vector2u size, sf::Color color = sf::Color::White);
+
+    void resize(sf::Vector2u size, sf::Color color = sf::Color::White);
+    void clear(sf::Color color);
+    void drawTriangles(const sf::Vertex* vertices, std::size_t vertexCount, sf::Vector2f offset = {0.f, 0.f});
+    void drawTriangles(const sf::VertexArray& vertices, sf::Vector2f offset = {0.f, 0.f});
+    void drawStroke(const Stroke& stroke, sf::Vector2f offset = {0.f, 0.f});
+
+    sf::Vector2u getSize() const { return m_size; }
+    const std::uint8_t* getPixels() const { return m_pixels.data(); } // RGBA, row major
+    sf::Color getPixel(unsigned int x, unsigned int y) const;
+    sf::Image toImage() const;
+    // pixels where any channel differs by more than tolerance
+    std::size_t countDifferences(const SoftRaster& other, int tolerance = 0) const;
+
+private:
+    void blendSpan(std::uint8_t* row, int x0, int x1, sf::Color color);
+
+    sf::Vector2u m_size;
+    std::vector<std::uint8_t> m_pixels;
+    sf::VertexArray m_scratch{sf::PrimitiveType::Triangles}; // reused by drawStroke
+};
@@ -0,0 +1,54 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+
+#include "Profiler.hpp"
+#include "StreamVertexBuffer.hpp"
+
+StreamVertexBuffer::StreamVertexBuffer(sf::PrimitiveType type, std::size_t initialCapacity)
+    : m_buffer(type, sf::VertexBuffer::Usage::Stream), m_initialCapacity(initialCapacity)
+{
+}
+
+bool StreamVertexBuffer::grow(std::size_t needed){
+    std::size_t capacity = std::max({m_initialCapacity, m_capacity * 2, needed});
+    if (!m_buffer.create(capacity))
+        return false;
+    m_capacity = capacity;
+    m_count = 0; // create() drops the contents
+    return true;
+}
+
+void StreamVertexBuffer::sync(const sf::VertexArray& vertices){
+    m_source = &vertices;
+    m_lastUpload = 0;
+    if (!sf::VertexBuffer::isAvailable())
+        return;
+    std::size_t count = vertices.getVertexCount();
+    if (count < m_count)
+        m_count = 0;
+    if (count > m_capacity && !grow(count))
+        return;
+    if (count == m_count)
+        return;
+    if (m_buffer.update(&vertices[m_count], count - m_count, (unsigned int)m_count)){
+        m_lastUpload = count - m_count;
+        m_count = count;
+    }
+    PROFILE_COUNTER("stream vertices", m_lastUpload);
+}
+
+void StreamVertexBuffer::clear(){
+    m_count = 0;
+    m_lastUpload = 0;
+    m_source = nullptr;
+}
+
+void StreamVertexBuffer::draw(CountingTarget& target, const sf::RenderStates& states) const {
+    if (!sf::VertexBuffer::isAvailable()){
+        if (m_source)
+            target.draw(*m_source, states);
+        return;
+    }
+    if (m_count > 0)
+        target.draw(m_buffer, 0, m_count, states);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+
+#include "RenderStats.hpp"
+
+// GPU copy of a vertex list that only grows, like the stroke being drawn. sync() uploads just the
+// vertices appended since the last call; when the buffer is full it's recreated at twice the size
+// and filled once from the source, so uploads stay proportional to what was added. where vertex
+// buffers aren't available it draws the source array directly, as before
+class StreamVertexBuffer {
+public:
+    explicit StreamVertexBuffer(sf::PrimitiveType type = sf::PrimitiveType::Triangles, std::size_t initialCapacity = 4096);
+
+    void sync(const sf::VertexArray& vertices); // a source shorter than last time starts over
+    void clear();
+    void draw(CountingTarget& target, const sf::RenderStates& states = sf::RenderStates::Default) const;
+
+    std::size_t getVertexCount() const { return m_count; }
+    std::size_t getLastUpload() const { return m_lastUpload; } // vertices sent by the last sync
+
+private:
+    bool grow(std::size_t needed);
+
+    sf::VertexBuffer m_buffer;
+    std::size_t m_capacity = 0;
+    std::size_t m_initialCapacity;
+    std::size_t m_count = 0;
+    std::size_t m_lastUpload = 0;
+    const sf::VertexArray* m_source = nullptr; // for the fallback
+};
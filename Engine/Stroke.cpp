@@ -0,0 +1,240 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "Stroke.hpp"
+
+#define CAP_SEGMENTS 16
+
+sf::FloatRect Stroke::getBounds() const {
+    if (points.empty())
+        return {};
+    sf::Vector2f min = points[0];
+    sf::Vector2f max = points[0];
+    for (const auto& p : points){
+        min.x = std::min(min.x, p.x);
+        min.y = std::min(min.y, p.y);
+        max.x = std::max(max.x, p.x);
+        max.y = std::max(max.y, p.y);
+    }
+    float r = thickness / 2.f;
+    return {{min.x - r, min.y - r}, {max.x - min.x + thickness, max.y - min.y + thickness}};
+}
+
+void copyStrokeStyle(const Stroke& from, Stroke& to, std::size_t first){
+    to.stamp = from.stamp;
+    std::size_t count = to.points.size();
+    if (!from.widths.empty())
+        to.widths.assign(from.widths.begin() + first, from.widths.begin() + first + count);
+    else
+        to.widths.clear();
+    if (!from.alphas.empty())
+        to.alphas.assign(from.alphas.begin() + first, from.alphas.begin() + first + count);
+    else
+        to.alphas.clear();
+}
+
+// the same emitters serve sf::VertexArray and plain vertex vectors
+static void push(sf::VertexArray& vertices, const sf::Vertex& vertex){ vertices.append(vertex); }
+static void push(FrameVector<sf::Vertex>& vertices, const sf::Vertex& vertex){ vertices.push_back(vertex); }
+
+template <typename Vertices>
+static void emitThickLine(Vertices& vertices, sf::Vector2f a, sf::Vector2f b, float thickness, sf::Color color){
+    sf::Vector2f direction = b - a;
+    float len = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+    if (len == 0)
+        return; // degenerate segment, the caps cover it
+    sf::Vector2f normal(-direction.y / len, direction.x / len);
+    sf::Vector2f offset = normal * (thickness / 2.f);
+
+    push(vertices, sf::Vertex{a - offset, color});
+    push(vertices, sf::Vertex{b - offset, color});
+    push(vertices, sf::Vertex{b + offset, color});
+    push(vertices, sf::Vertex{b + offset, color});
+    push(vertices, sf::Vertex{a + offset, color});
+    push(vertices, sf::Vertex{a - offset, color});
+}
+
+template <typename Vertices>
+static void emitTaperedLine(Vertices& vertices, sf::Vector2f a, sf::Vector2f b, float widthA, float widthB, sf::Color colorA, sf::Color colorB){
+    sf::Vector2f direction = b - a;
+    float len = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+    if (len == 0)
+        return;
+    sf::Vector2f normal(-direction.y / len, direction.x / len);
+    sf::Vector2f offsetA = normal * (widthA / 2.f);
+    sf::Vector2f offsetB = normal * (widthB / 2.f);
+
+    push(vertices, sf::Vertex{a - offsetA, colorA});
+    push(vertices, sf::Vertex{b - offsetB, colorB});
+    push(vertices, sf::Vertex{b + offsetB, colorB});
+    push(vertices, sf::Vertex{b + offsetB, colorB});
+    push(vertices, sf::Vertex{a + offsetA, colorA});
+    push(vertices, sf::Vertex{a - offsetA, colorA});
+}
+
+template <typename Vertices>
+static void emitStamp(Vertices& vertices, sf::Vector2f center, float width, float angle, BrushStamp stamp, sf::Color color){
+    // half a texel in from the slot's edges so smoothing doesn't pull in the neighbouring stamp
+    float left = (float)stamp * BRUSH_STAMP_SIZE + 0.5f;
+    float right = left + BRUSH_STAMP_SIZE - 1.f;
+    float top = 0.5f;
+    float bottom = BRUSH_STAMP_SIZE - 0.5f;
+    sf::Vector2f along = sf::Vector2f(std::cos(angle), std::sin(angle)) * (width / 2.f);
+    sf::Vector2f across(-along.y, along.x);
+    sf::Vertex corners[4] = {
+        {center - along - across, color, {left, top}},
+        {center + along - across, color, {right, top}},
+        {center + along + across, color, {right, bottom}},
+        {center - along + across, color, {left, bottom}}
+    };
+    for (int i : {0, 1, 2, 2, 3, 0})
+        push(vertices, corners[i]);
+}
+
+template <typename Vertices>
+static void emitCap(Vertices& vertices, sf::Vector2f center, float radius, sf::Color color){
+    // unit circle is computed once, every cap after that is just a scale + translate
+    static const std::array<sf::Vector2f, CAP_SEGMENTS + 1> unitCircle = [](){
+        std::array<sf::Vector2f, CAP_SEGMENTS + 1> circle;
+        for (int i = 0; i <= CAP_SEGMENTS; i++){
+            float angle = 2.f * 3.14159265f * (float)i / CAP_SEGMENTS;
+            circle[i] = {std::cos(angle), std::sin(angle)};
+        }
+        return circle;
+    }();
+    for (int i = 0; i < CAP_SEGMENTS; i++){
+        push(vertices, sf::Vertex{center, color});
+        push(vertices, sf::Vertex{center + unitCircle[i] * radius, color});
+        push(vertices, sf::Vertex{center + unitCircle[i + 1] * radius, color});
+    }
+}
+
+// the wedge a turn from direction in to out opens on its outer side, as a fan with as many
+// triangles as the same angle of a cap
+template <typename Vertices>
+static void emitJoin(Vertices& vertices, sf::Vector2f center, sf::Vector2f in, sf::Vector2f out, float radius, sf::Color color){
+    float turn = std::atan2(in.x * out.y - in.y * out.x, in.x * out.x + in.y * out.y);
+    float len = std::sqrt(in.x * in.x + in.y * in.y);
+    if (turn == 0.f || len == 0.f || out == sf::Vector2f())
+        return;
+    sf::Vector2f edge = sf::Vector2f(in.y, -in.x) * (radius / len); // outside of a positive turn
+    if (turn < 0.f)
+        edge = -edge;
+    int steps = std::max(1, (int)std::ceil(std::abs(turn) * CAP_SEGMENTS / (2.f * 3.14159265f)));
+    sf::Vector2f previous = center + edge;
+    for (int i = 1; i <= steps; i++){
+        float angle = turn * i / steps;
+        float c = std::cos(angle), s = std::sin(angle);
+        sf::Vector2f next = center + sf::Vector2f(edge.x * c - edge.y * s, edge.x * s + edge.y * c);
+        push(vertices, sf::Vertex{center, color});
+        push(vertices, sf::Vertex{previous, color});
+        push(vertices, sf::Vertex{next, color});
+        previous = next;
+    }
+}
+
+// shapes are long runs of points that mostly turn a little, so their joints get wedges sized to
+// the turn, and only open ends get whole caps
+template <typename Vertices>
+static void emitOutline(Vertices& vertices, const std::vector<sf::Vector2f>& points, float thickness, sf::Color color, sf::Vector2f offset){
+    std::size_t n = points.size();
+    float radius = thickness / 2.f;
+    bool closed = n > 2 && points.front() == points.back();
+    if (!closed){
+        emitCap(vertices, points.front() + offset, radius, color);
+        if (n > 1)
+            emitCap(vertices, points.back() + offset, radius, color);
+    }
+    for (std::size_t i = 1; i < n; i++){
+        emitThickLine(vertices, points[i - 1] + offset, points[i] + offset, thickness, color);
+        if (i + 1 < n)
+            emitJoin(vertices, points[i] + offset, points[i] - points[i - 1], points[i + 1] - points[i], radius, color);
+    }
+    if (closed)
+        emitJoin(vertices, points[0] + offset, points[0] - points[n - 2], points[1] - points[0], radius, color);
+}
+
+float getStampAngle(BrushStamp stamp, sf::Vector2f from, sf::Vector2f to){
+    if (stamp == BrushStamp::Chisel || from == to)
+        return 0.f; // a chisel nib keeps its angle, that's what gives it thick and thin strokes
+    return std::atan2(to.y - from.y, to.x - from.x);
+}
+
+template <typename Vertices>
+static void emitStroke(const Stroke& stroke, Vertices& vertices, sf::Vector2f offset){
+    if (stroke.stamp == BrushStamp::Fill){
+        // texture coordinates stay at 0, 0, in the atlas's solid slot, so fills draw the same with the brush texture bound
+        for (std::size_t i = 0; i + 1 < stroke.points.size(); i += 2){
+            sf::Vector2f a = stroke.points[i] + offset;
+            sf::Vector2f b = stroke.points[i + 1] + offset;
+            sf::Vertex corners[4] = {{a, stroke.color}, {{b.x, a.y}, stroke.color}, {b, stroke.color}, {{a.x, b.y}, stroke.color}};
+            for (int k : {0, 1, 2, 2, 3, 0})
+                push(vertices, corners[k]);
+        }
+        return;
+    }
+    if (stroke.shape != StrokeShape::Freehand && stroke.stamp == BrushStamp::Solid && stroke.widths.empty() && stroke.alphas.empty()){
+        if (!stroke.points.empty())
+            emitOutline(vertices, stroke.points, stroke.thickness, stroke.color, offset);
+        return;
+    }
+    if (stroke.stamp != BrushStamp::Solid){
+        for (std::size_t i = 0; i < stroke.points.size(); i++)
+            emitStamp(vertices, stroke.points[i] + offset, stroke.getWidth(i),
+                getStampAngle(stroke.stamp, stroke.points[i > 0 ? i - 1 : 0], stroke.points[i]), stroke.stamp, stroke.getColor(i));
+        return;
+    }
+    if (!stroke.widths.empty() || !stroke.alphas.empty()){
+        // translucent points overlap their neighbours' caps, which darkens the joints a little like a marker
+        for (std::size_t i = 0; i < stroke.points.size(); i++){
+            emitCap(vertices, stroke.points[i] + offset, stroke.getWidth(i) / 2.f, stroke.getColor(i));
+            if (i > 0)
+                emitTaperedLine(vertices, stroke.points[i - 1] + offset, stroke.points[i] + offset, stroke.getWidth(i - 1), stroke.getWidth(i),
+                    stroke.getColor(i - 1), stroke.getColor(i));
+        }
+        return;
+    }
+    float radius = stroke.thickness / 2.f;
+    for (std::size_t i = 0; i < stroke.points.size(); i++){
+        emitCap(vertices, stroke.points[i] + offset, radius, stroke.color);
+        if (i > 0)
+            emitThickLine(vertices, stroke.points[i - 1] + offset, stroke.points[i] + offset, stroke.thickness, stroke.color);
+    }
+}
+
+void appendThickLine(sf::VertexArray& vertices, sf::Vector2f a, sf::Vector2f b, float thickness, sf::Color color){
+    emitThickLine(vertices, a, b, thickness, color);
+}
+
+void appendCap(sf::VertexArray& vertices, sf::Vector2f center, float radius, sf::Color color){
+    emitCap(vertices, center, radius, color);
+}
+
+void appendTaperedLine(sf::VertexArray& vertices, sf::Vector2f a, sf::Vector2f b, float widthA, float widthB, sf::Color colorA, sf::Color colorB){
+    emitTaperedLine(vertices, a, b, widthA, widthB, colorA, colorB);
+}
+
+void appendStamp(sf::VertexArray& vertices, sf::Vector2f center, float width, float angle, BrushStamp stamp, sf::Color color){
+    emitStamp(vertices, center, width, angle, stamp, color);
+}
+
+void tessellateStroke(const Stroke& stroke, sf::VertexArray& vertices, sf::Vector2f offset){
+    emitStroke(stroke, vertices, offset);
+}
+
+void tessellateStroke(const Stroke& stroke, FrameVector<sf::Vertex>& vertices, sf::Vector2f offset){
+    emitStroke(stroke, vertices, offset);
+}
+
+std::size_t getTessellatedVertexCount(const Stroke& stroke){
+    std::size_t points = stroke.points.size();
+    if (stroke.stamp == BrushStamp::Fill)
+        return points / 2 * 6;
+    if (stroke.stamp != BrushStamp::Solid)
+        return points * 6;
+    if (stroke.shape != StrokeShape::Freehand && stroke.widths.empty() && stroke.alphas.empty()) // a joint turns at most half a cap
+        return 2 * CAP_SEGMENTS * 3 + (points > 0 ? points - 1 : 0) * (6 + CAP_SEGMENTS / 2 * 3);
+    return points * CAP_SEGMENTS * 3 + (points > 0 ? points - 1 : 0) * 6; // upper bound, zero length segments emit nothing
+}
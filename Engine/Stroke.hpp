@@ -0,0 +1,78 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "FrameArena.hpp"
+
+// what each point of a stroke is drawn with. solid strokes are triangles, the others put one
+// textured quad per point, all from the brush atlas (see Brush.hpp). Fill isn't a stamp: its
+// points are pairs of opposite corners of the rectangles a bucket fill covers, drawn as they are
+enum class BrushStamp : std::uint8_t {
+    Solid = 0,
+    Airbrush,
+    Chalk,
+    Chisel,
+    Fill
+};
+
+#define BRUSH_STAMP_COUNT 4  // stamps in the atlas
+#define BRUSH_STAMP_VALUES 5 // valid BrushStamp values in saved data, Fill included
+#define BRUSH_STAMP_SIZE 64 // pixels per stamp in the brush atlas, which has them in one row
+
+// the analytic primitive a shape tool drew, and what its handles are (see Shape.hpp)
+enum class StrokeShape : std::uint8_t {
+    Freehand = 0, // no handles
+    Line,         // the two ends
+    Rect,         // two opposite corners, axis aligned
+    Ellipse,      // two opposite corners of its bounding box
+    Arc,          // the start, a point it passes through, and the end of a circular arc
+    Polyline      // its corners
+};
+
+#define STROKE_SHAPE_VALUES 6
+
+// a single committed brush stroke, in world coordinates
+struct Stroke {
+    std::uint32_t id = 0; // increases in draw order, pieces of a split stroke keep their parent's id
+    std::vector<sf::Vector2f> points;
+    sf::Color color = sf::Color::Black;
+    float thickness = 1.f; // the widest the stroke gets, collision and bounds use this
+    BrushStamp stamp = BrushStamp::Solid;
+    // per point scale of thickness and of color's alpha, n/255. empty means constant
+    std::vector<std::uint8_t> widths;
+    std::vector<std::uint8_t> alphas;
+    // Bézier control points the points were flattened from (see CurveFit.hpp), empty when the stroke
+    // wasn't fitted. pieces of a split stroke don't keep it
+    std::vector<sf::Vector2f> curve;
+    // shape tool strokes keep the primitive their points were flattened from. collision and
+    // history use it, pieces of a split stroke don't keep it unless the whole shape fits in one chunk
+    StrokeShape shape = StrokeShape::Freehand;
+    std::vector<sf::Vector2f> handles;
+
+    sf::FloatRect getBounds() const; // includes half the thickness on every side
+    float getWidth(std::size_t point) const { return widths.empty() ? thickness : thickness * widths[point] / 255.f; }
+    sf::Color getColor(std::size_t point) const {
+        return alphas.empty() ? color : sf::Color(color.r, color.g, color.b, (std::uint8_t)(color.a * alphas[point] / 255));
+    }
+};
+
+// copies from's stamp, and the style of its points [first, first + to.points.size()), onto a piece of it
+void copyStrokeStyle(const Stroke& from, Stroke& to, std::size_t first);
+
+// appends the quad for a segment from a to b as two triangles
+void appendThickLine(sf::VertexArray& vertices, sf::Vector2f a, sf::Vector2f b, float thickness, sf::Color color);
+// appends a round cap (triangle fan flattened into triangles)
+void appendCap(sf::VertexArray& vertices, sf::Vector2f center, float radius, sf::Color color);
+// segment whose ends have their own width and colour, for strokes with per point style
+void appendTaperedLine(sf::VertexArray& vertices, sf::Vector2f a, sf::Vector2f b, float widthA, float widthB, sf::Color colorA, sf::Color colorB);
+// one textured quad, width across, turned to angle (radians), with texture coordinates into the brush atlas
+void appendStamp(sf::VertexArray& vertices, sf::Vector2f center, float width, float angle, BrushStamp stamp, sf::Color color);
+// the angle a stamp at to is turned to, coming from the previous point (from == to for the first)
+float getStampAngle(BrushStamp stamp, sf::Vector2f from, sf::Vector2f to);
+// appends segments + caps for a whole stroke, or its stamps
+void tessellateStroke(const Stroke& stroke, sf::VertexArray& vertices, sf::Vector2f offset = {0.f, 0.f});
+// same into frame arena memory, for vertices that are drawn and dropped within the frame
+void tessellateStroke(const Stroke& stroke, FrameVector<sf::Vertex>& vertices, sf::Vector2f offset = {0.f, 0.f});
+// vertices tessellateStroke will append, to reserve up front
+std::size_t getTessellatedVertexCount(const Stroke& stroke);
@@ -0,0 +1,154 @@
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+
+#include "StrokeBuilder.hpp"
+
+void StrokeBuilder::begin(sf::Vector2f pos, sf::Color color, float thickness, float spacing, const Brush& brush, float pressure){
+    m_active = true;
+    m_color = color;
+    m_thickness = thickness;
+    m_spacing = spacing;
+    m_brush = brush;
+    m_speed = 0.f;
+    m_widthScale = brush.getScale(brush.width, 0.f, pressure);
+    m_alphaScale = brush.getScale(brush.opacity, 0.f, pressure);
+    m_points.clear();
+    m_widths.clear();
+    m_alphas.clear();
+    m_triangles.clear();
+    m_prediction.clear();
+    m_fitting = brush.stamp == BrushStamp::Solid && brush.width == Brush::Source::None && brush.opacity == Brush::Source::None;
+    if (m_fitting)
+        m_fitter.begin(pos);
+    m_lastPos = pos;
+    m_rawPos = pos;
+    m_pressure = pressure;
+    m_filter.reset(pos);
+    appendPoint(pos, m_widthScale, m_alphaScale);
+}
+
+void StrokeBuilder::appendPoint(sf::Vector2f pos, float widthScale, float alphaScale){
+    bool varyWidth = m_brush.width != Brush::Source::None;
+    bool varyAlpha = m_brush.opacity != Brush::Source::None;
+    if (varyWidth)
+        m_widths.push_back((std::uint8_t)std::lround(widthScale * 255.f));
+    if (varyAlpha)
+        m_alphas.push_back((std::uint8_t)std::lround(alphaScale * 255.f));
+    m_points.push_back(pos);
+    if (m_fitting && m_points.size() > 1)
+        m_fitter.addPoint(pos);
+
+    // same quantized values the finished stroke will be tessellated from
+    std::size_t last = m_points.size() - 1;
+    float width = varyWidth ? m_thickness * m_widths[last] / 255.f : m_thickness;
+    sf::Color color = m_color;
+    if (varyAlpha)
+        color.a = (std::uint8_t)(m_color.a * m_alphas[last] / 255);
+    if (m_brush.stamp != BrushStamp::Solid){
+        sf::Vector2f previous = last > 0 ? m_points[last - 1] : pos;
+        appendStamp(m_triangles, pos, width, getStampAngle(m_brush.stamp, previous, pos), m_brush.stamp, color);
+        return;
+    }
+    appendCap(m_triangles, pos, width / 2.f, color);
+    if (last == 0)
+        return;
+    if (!varyWidth && !varyAlpha){
+        appendThickLine(m_triangles, m_points[last - 1], pos, m_thickness, m_color);
+        return;
+    }
+    float previousWidth = varyWidth ? m_thickness * m_widths[last - 1] / 255.f : m_thickness;
+    sf::Color previousColor = m_color;
+    if (varyAlpha)
+        previousColor.a = (std::uint8_t)(m_color.a * m_alphas[last - 1] / 255);
+    appendTaperedLine(m_triangles, m_points[last - 1], pos, previousWidth, width, previousColor, color);
+}
+
+void StrokeBuilder::addSample(sf::Vector2f pos, float pressure){
+    if (!m_active || pos == m_rawPos)
+        return;
+    m_rawPos = pos;
+    m_pressure = pressure;
+    advanceTo(m_filter.filter(pos), pressure);
+}
+
+void StrokeBuilder::advanceTo(sf::Vector2f pos, float pressure){
+    float dist = std::hypot(pos.x - m_lastPos.x, pos.y - m_lastPos.y);
+    if (dist == 0)
+        return;
+    m_prediction.clear();
+    // speed is per sample rather than per second, so a replay at any rate draws the same stroke
+    m_speed = m_speed * 0.6f + dist * 0.4f;
+    float widthScale = m_brush.getScale(m_brush.width, m_speed, pressure);
+    float alphaScale = m_brush.getScale(m_brush.opacity, m_speed, pressure);
+    int steps = std::max(1, static_cast<int>(dist / m_spacing));
+    for (int i = 1; i <= steps; ++i){
+        float t = static_cast<float>(i) / steps;
+        appendPoint(m_lastPos + t * (pos - m_lastPos), m_widthScale + t * (widthScale - m_widthScale), m_alphaScale + t * (alphaScale - m_alphaScale));
+    }
+    m_lastPos = pos;
+    m_widthScale = widthScale;
+    m_alphaScale = alphaScale;
+}
+
+void StrokeBuilder::setPrediction(sf::Vector2f pos){
+    m_prediction.clear();
+    if (!m_active || m_points.empty() || pos == m_points.back())
+        return;
+    // carries on with the last point's width and colour, the same way appendPoint would draw it
+    std::size_t last = m_points.size() - 1;
+    sf::Vector2f from = m_points[last];
+    float width = m_widths.empty() ? m_thickness : m_thickness * m_widths[last] / 255.f;
+    sf::Color color = m_color;
+    if (!m_alphas.empty())
+        color.a = (std::uint8_t)(m_color.a * m_alphas[last] / 255);
+    if (m_brush.stamp != BrushStamp::Solid){
+        float dist = std::hypot(pos.x - from.x, pos.y - from.y);
+        int steps = std::max(1, static_cast<int>(dist / m_spacing));
+        sf::Vector2f previous = from;
+        for (int i = 1; i <= steps; ++i){
+            sf::Vector2f at = from + static_cast<float>(i) / steps * (pos - from);
+            appendStamp(m_prediction, at, width, getStampAngle(m_brush.stamp, previous, at), m_brush.stamp, color);
+            previous = at;
+        }
+        return;
+    }
+    appendThickLine(m_prediction, from, pos, width, color);
+    appendCap(m_prediction, pos, width / 2.f, color);
+}
+
+Stroke StrokeBuilder::finish(std::uint32_t id){
+    // the filter trails the pointer, close the gap so the stroke ends where the pointer let go
+    if (m_active)
+        advanceTo(m_rawPos, m_pressure);
+    Stroke stroke;
+    stroke.id = id;
+    stroke.color = m_color;
+    stroke.thickness = m_thickness;
+    stroke.stamp = m_brush.stamp;
+    stroke.points.swap(m_points);
+    stroke.widths.swap(m_widths);
+    stroke.alphas.swap(m_alphas);
+    if (m_fitting){
+        stroke.curve = m_fitter.finish();
+        std::vector<sf::Vector2f> flattened;
+        flattenCurve(stroke.curve, flattened);
+        // jitter that got past the filter can take more segments than it saves, keep the points then
+        if (!stroke.curve.empty() && flattened.size() < stroke.points.size())
+            stroke.points.swap(flattened);
+        else
+            stroke.curve.clear();
+    }
+    cancel();
+    return stroke;
+}
+
+void StrokeBuilder::cancel(){
+    m_active = false;
+    m_points.clear();
+    m_widths.clear();
+    m_alphas.clear();
+    m_triangles.clear();
+    m_prediction.clear();
+    m_fitting = false;
+}
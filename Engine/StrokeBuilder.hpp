@@ -0,0 +1,59 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "Brush.hpp"
+#include "CurveFit.hpp"
+#include "OneEuroFilter.hpp"
+#include "Stroke.hpp"
+
+// turns raw pointer samples into an evenly spaced stroke and its triangles, with no window or GPU involved.
+// samples go through a One Euro filter first, and the stroke still ends on the last real one.
+// plain solid strokes are also fitted with Béziers as they grow, and finish swaps their points for
+// the flattened curve, which needs far fewer of them
+class StrokeBuilder {
+public:
+    void begin(sf::Vector2f pos, sf::Color color, float thickness, float spacing, const Brush& brush = Brush(), float pressure = 1.f);
+    void addSample(sf::Vector2f pos, float pressure = 1.f); // interpolates points every spacing units up to pos
+    void setSmoothing(const OneEuroSettings& settings){ m_filter.setSettings(settings); } // from the next stroke on
+    Stroke finish(std::uint32_t id);   // hands over the stroke and goes back to idle
+    void cancel();
+
+    bool isActive() const { return m_active; }
+    const std::vector<sf::Vector2f>& getPoints() const { return m_points; }
+    const sf::VertexArray& getTriangles() const { return m_triangles; } // segments and caps (or stamps) so far
+    BrushStamp getStamp() const { return m_brush.stamp; }
+    bool isFitting() const { return m_fitting; }
+    const std::vector<sf::Vector2f>& getCurve() const { return m_fitter.getControlPoints(); } // closed segments so far
+
+    // provisional ink from the last point to where the pointer is expected to be, drawn after
+    // getTriangles(). it's never part of the stroke, and goes away with the next sample
+    void setPrediction(sf::Vector2f pos);
+    void clearPrediction(){ m_prediction.clear(); }
+    const sf::VertexArray& getPrediction() const { return m_prediction; }
+
+private:
+    void appendPoint(sf::Vector2f pos, float widthScale, float alphaScale);
+    void advanceTo(sf::Vector2f pos, float pressure);
+
+    bool m_active = false;
+    sf::Color m_color;
+    float m_thickness = 1.f;
+    float m_spacing = 1.f;
+    Brush m_brush;
+    float m_speed = 0.f; // smoothed distance between samples
+    float m_widthScale = 1.f;
+    float m_alphaScale = 1.f;
+    sf::Vector2f m_lastPos;
+    OneEuroFilter m_filter;
+    sf::Vector2f m_rawPos; // last sample before filtering
+    float m_pressure = 1.f;
+    std::vector<sf::Vector2f> m_points;
+    std::vector<std::uint8_t> m_widths; // only filled when the brush varies them
+    std::vector<std::uint8_t> m_alphas;
+    sf::VertexArray m_triangles{sf::PrimitiveType::Triangles};
+    sf::VertexArray m_prediction{sf::PrimitiveType::Triangles};
+    bool m_fitting = false; // solid brush with nothing varying
+    CurveFitter m_fitter;
+};
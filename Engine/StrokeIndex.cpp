@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cmath>
+
+#include "StrokeIndex.hpp"
+
+namespace {
+    std::uint64_t cellKey(int cx, int cy){
+        return ((std::uint64_t)(std::uint32_t)cx << 32) | (std::uint32_t)cy;
+    }
+
+    // the cells a rectangle covers, inclusive
+    void cellRange(sf::FloatRect area, int& x0, int& y0, int& x1, int& y1){
+        x0 = (int)std::floor(area.position.x / STROKE_INDEX_CELL);
+        y0 = (int)std::floor(area.position.y / STROKE_INDEX_CELL);
+        x1 = (int)std::floor((area.position.x + area.size.x) / STROKE_INDEX_CELL);
+        y1 = (int)std::floor((area.position.y + area.size.y) / STROKE_INDEX_CELL);
+    }
+}
+
+void StrokeIndex::clear(){
+    m_cells.clear();
+    m_oversized.clear();
+    m_bounds.clear();
+    m_seen.clear();
+    m_stale = false;
+}
+
+void StrokeIndex::sync(const std::vector<Stroke>& strokes){
+    if (m_stale || strokes.size() < m_bounds.size())
+        clear();
+    for (std::size_t i = m_bounds.size(); i < strokes.size(); i++)
+        insert((std::uint32_t)i, strokes[i].getBounds());
+}
+
+void StrokeIndex::insert(std::uint32_t index, sf::FloatRect bounds){
+    m_bounds.push_back(bounds);
+    m_seen.push_back(0);
+    int x0, y0, x1, y1;
+    cellRange(bounds, x0, y0, x1, y1);
+    if ((long long)(x1 - x0 + 1) * (y1 - y0 + 1) > STROKE_INDEX_MAX_CELLS){
+        m_oversized.push_back(index);
+        return;
+    }
+    for (int cy = y0; cy <= y1; cy++)
+        for (int cx = x0; cx <= x1; cx++)
+            m_cells[cellKey(cx, cy)].push_back(index);
+}
+
+void StrokeIndex::query(sf::FloatRect area, std::vector<std::uint32_t>& out) const {
+    out.clear();
+    if (++m_query == 0){
+        std::fill(m_seen.begin(), m_seen.end(), 0);
+        m_query = 1;
+    }
+    auto visit = [this, &area, &out](std::uint32_t index){
+        if (m_seen[index] == m_query)
+            return;
+        m_seen[index] = m_query;
+        if (m_bounds[index].findIntersection(area))
+            out.push_back(index);
+    };
+    int x0, y0, x1, y1;
+    cellRange(area, x0, y0, x1, y1);
+    // an area wider than the drawing walks the cells there are instead of the cells it covers
+    if ((long long)(x1 - x0 + 1) * (y1 - y0 + 1) <= (long long)m_cells.size()){
+        for (int cy = y0; cy <= y1; cy++){
+            for (int cx = x0; cx <= x1; cx++){
+                auto it = m_cells.find(cellKey(cx, cy));
+                if (it != m_cells.end())
+                    for (std::uint32_t index : it->second)
+                        visit(index);
+            }
+        }
+    } else {
+        for (const auto& [key, indices] : m_cells){
+            int cx = (int)(std::uint32_t)(key >> 32);
+            int cy = (int)(std::uint32_t)key;
+            if (cx >= x0 && cx <= x1 && cy >= y0 && cy <= y1)
+                for (std::uint32_t index : indices)
+                    visit(index);
+        }
+    }
+    for (std::uint32_t index : m_oversized)
+        visit(index);
+    std::sort(out.begin(), out.end());
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <SFML/Graphics/Rect.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Stroke.hpp"
+
+#define STROKE_INDEX_CELL 128        // world units per grid cell side
+#define STROKE_INDEX_MAX_CELLS 1024  // strokes covering more cells than this are kept in one list instead
+
+// a uniform grid over stroke bounds, so area queries only look at strokes near the area. strokes
+// are their place in the list: sync() indexes whatever was appended since the last call, and
+// anything that changes the list some other way invalidates it, rebuilt by the next sync
+class StrokeIndex {
+public:
+    void clear();
+    void invalidate(){ m_stale = true; }
+    void sync(const std::vector<Stroke>& strokes);
+
+    // strokes whose bounds touch area, each once, in list order
+    void query(sf::FloatRect area, std::vector<std::uint32_t>& out) const;
+    const sf::FloatRect& getBounds(std::uint32_t index) const { return m_bounds[index]; }
+
+    std::size_t getStrokeCount() const { return m_bounds.size(); }
+    std::size_t getCellCount() const { return m_cells.size(); }
+
+private:
+    void insert(std::uint32_t index, sf::FloatRect bounds);
+
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> m_cells;
+    std::vector<std::uint32_t> m_oversized;
+    std::vector<sf::FloatRect> m_bounds; // per stroke
+    bool m_stale = false;
+    mutable std::vector<std::uint32_t> m_seen; // per stroke, the last query that returned it
+    mutable std::uint32_t m_query = 0;
+};
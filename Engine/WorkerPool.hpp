@@ -0,0 +1,31 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a few threads for short jobs the UI shouldn't wait on, like recognizing a stroke's shape. jobs
+// start in the order they're submitted but may finish in any, and hand their results back through
+// whatever locking the caller keeps
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned int threads = 0); // 0 picks one less than the hardware has, at least one
+    ~WorkerPool();                                 // jobs not started yet are dropped, running ones finish
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void submit(std::function<void()> job);
+    std::size_t getThreadCount() const { return m_threads.size(); }
+
+private:
+    void workerLoop();
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::function<void()>> m_jobs;
+    bool m_quit = false;
+    std::vector<std::thread> m_threads;
+};
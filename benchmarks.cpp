@@ -0,0 +1,227 @@
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Engine/AllocationStats.hpp"
+#include "Engine/Collision.hpp"
+#include "Engine/LevelFile.hpp"
+#include "Engine/ShadowRaster.hpp"
+#include "Engine/SoftRaster.hpp"
+#include "Engine/StrokeBuilder.hpp"
+
+// micro-benchmarks for the stroke pipeline: segment + cap generation, resampling, tessellation,
+// baking and collision. reports ns per segment, heap allocations per stroke and vertices emitted
+// (capsules for the collision bench)
+
+struct Input {
+    std::string name;
+    std::vector<Stroke> strokes;  // already resampled, what the canvas commits
+    std::vector<std::vector<sf::Vector2f>> samples; // raw pointer samples the strokes were built from
+    std::size_t segments = 0;
+};
+
+struct Result {
+    double nsPerSegment;
+    double allocationsPerStroke;
+    double verticesPerStroke;
+};
+
+struct Options {
+    std::string filter;
+    std::string levelPath;
+    int iterations = 5;
+    bool gpu = false;
+    bool csv = false;
+};
+
+// a wavy stroke of the given length in samples, the way the mouse delivers them (a few px apart)
+static Input syntheticInput(int samplesPerStroke, float thickness, int strokeCount){
+    Input input;
+    input.name = std::to_string(samplesPerStroke) + "x" + std::to_string((int)thickness);
+    StrokeBuilder builder;
+    for (int s = 0; s < strokeCount; s++){
+        std::vector<sf::Vector2f> samples;
+        for (int i = 0; i < samplesPerStroke; i++){
+            float t = (float)i;
+            samples.push_back({20.f + t * 3.f, 250.f + std::sin(t * 0.05f + s) * 100.f});
+        }
+        builder.begin(samples[0], sf::Color::Black, thickness, 5.f);
+        for (std::size_t i = 1; i < samples.size(); i++)
+            builder.addSample(samples[i]);
+        input.strokes.push_back(builder.finish((std::uint32_t)s));
+        input.samples.push_back(std::move(samples));
+    }
+    for (const auto& stroke : input.strokes)
+        input.segments += stroke.points.empty() ? 0 : stroke.points.size() - 1;
+    return input;
+}
+
+static bool recordedInput(const std::string& path, Input& input){
+    LevelFile level;
+    if (!level.open(path) || !level.loadStrokes(input.strokes))
+        return false;
+    input.name = "recorded";
+    for (const auto& stroke : input.strokes){
+        input.samples.push_back(stroke.points);
+        input.segments += stroke.points.empty() ? 0 : stroke.points.size() - 1;
+    }
+    return true;
+}
+
+// runs body over every stroke of the input, keeps the best iteration
+static Result measure(const Input& input, int iterations, const std::function<std::size_t(std::size_t)>& body){
+    Result best{1e30, 0, 0};
+    for (int it = 0; it < iterations; it++){
+        std::size_t vertices = 0;
+        std::size_t allocationsBefore = AllocationStats::getCount();
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t s = 0; s < input.strokes.size(); s++)
+            vertices += body(s);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::size_t allocations = AllocationStats::getCount() - allocationsBefore;
+        double perSegment = ns / std::max<std::size_t>(1, input.segments);
+        if (perSegment < best.nsPerSegment){
+            best.nsPerSegment = perSegment;
+            best.allocationsPerStroke = (double)allocations / input.strokes.size();
+            best.verticesPerStroke = (double)vertices / input.strokes.size();
+        }
+    }
+    return best;
+}
+
+static void report(const Options& options, const std::string& bench, const Input& input, const Result& result){
+    if (options.csv){
+        std::printf("%s,%s,%.2f,%.2f,%.1f\n", bench.c_str(), input.name.c_str(), result.nsPerSegment, result.allocationsPerStroke, result.verticesPerStroke);
+        return;
+    }
+    std::printf("%-14s %-10s %10.2f ns/seg %8.2f allocs/stroke %10.1f verts/stroke\n", bench.c_str(), input.name.c_str(),
+        result.nsPerSegment, result.allocationsPerStroke, result.verticesPerStroke);
+}
+
+static void runInput(const Options& options, const Input& input, std::unique_ptr<sf::RenderTexture>& gpuTarget){
+    auto enabled = [&options](const std::string& bench){
+        return options.filter.empty() || bench.find(options.filter) != std::string::npos;
+    };
+    sf::VertexArray vertices(sf::PrimitiveType::Triangles);
+    auto tessellated = [&vertices, &input](std::size_t s){
+        vertices.clear();
+        tessellateStroke(input.strokes[s], vertices);
+        return vertices.getVertexCount();
+    };
+
+    if (enabled("thickline")){
+        report(options, "thickline", input, measure(input, options.iterations, [&](std::size_t s){
+            const Stroke& stroke = input.strokes[s];
+            vertices.clear();
+            for (std::size_t i = 1; i < stroke.points.size(); i++)
+                appendThickLine(vertices, stroke.points[i - 1], stroke.points[i], stroke.thickness, stroke.color);
+            return vertices.getVertexCount();
+        }));
+    }
+    if (enabled("caps")){
+        report(options, "caps", input, measure(input, options.iterations, [&](std::size_t s){
+            const Stroke& stroke = input.strokes[s];
+            vertices.clear();
+            for (const auto& p : stroke.points)
+                appendCap(vertices, p, stroke.thickness / 2.f, stroke.color);
+            return vertices.getVertexCount();
+        }));
+    }
+    if (enabled("tessellate"))
+        report(options, "tessellate", input, measure(input, options.iterations, tessellated));
+    if (enabled("resample")){
+        StrokeBuilder builder;
+        report(options, "resample", input, measure(input, options.iterations, [&](std::size_t s){
+            const auto& samples = input.samples[s];
+            builder.begin(samples[0], input.strokes[s].color, input.strokes[s].thickness, 5.f);
+            for (std::size_t i = 1; i < samples.size(); i++)
+                builder.addSample(samples[i]);
+            std::size_t count = builder.getTriangles().getVertexCount();
+            builder.finish(0);
+            return count;
+        }));
+    }
+    if (enabled("collision")){
+        std::vector<CollisionCapsule> capsules;
+        report(options, "collision", input, measure(input, options.iterations, [&](std::size_t s){
+            capsules.clear();
+            compileCollision(input.strokes[s], capsules);
+            return capsules.size();
+        }));
+    }
+    if (enabled("bake-soft")){
+        SoftRaster raster({800, 500});
+        report(options, "bake-soft", input, measure(input, options.iterations, [&](std::size_t s){
+            std::size_t count = tessellated(s);
+            raster.drawTriangles(vertices);
+            return count;
+        }));
+    }
+    if (enabled("bake-shadow")){
+        ShadowRaster shadow;
+        report(options, "bake-shadow", input, measure(input, options.iterations, [&](std::size_t s){
+            std::size_t count = tessellated(s);
+            shadow.drawStroke(input.strokes[s]); // tessellates again, like bake-soft's share of tessellated()
+            return count;
+        }));
+    }
+    if (options.gpu && enabled("bake-gpu")){
+        if (!gpuTarget)
+            gpuTarget = std::make_unique<sf::RenderTexture>(sf::Vector2u(800, 500));
+        report(options, "bake-gpu", input, measure(input, options.iterations, [&](std::size_t s){
+            std::size_t count = tessellated(s);
+            gpuTarget->draw(vertices);
+            gpuTarget->display();
+            return count;
+        }));
+    }
+}
+
+int main(int argc, char** argv){
+    Options options;
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (arg == "--level" && i + 1 < argc)
+            options.levelPath = argv[++i];
+        else if (arg == "--iterations" && i + 1 < argc)
+            options.iterations = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--gpu")
+            options.gpu = true; // needs a GL context, so off by default for build servers
+        else if (arg == "--csv")
+            options.csv = true;
+        else {
+            std::cout << "usage: PizarraBench [--filter name] [--level recorded.pzl] [--iterations n] [--gpu] [--csv]\n";
+            return 1;
+        }
+    }
+
+    std::vector<Input> inputs;
+    if (!options.levelPath.empty()){
+        Input recorded;
+        if (!recordedInput(options.levelPath, recorded)){
+            std::cout << "can't open " << options.levelPath << "\n";
+            return 1;
+        }
+        inputs.push_back(std::move(recorded));
+    } else {
+        for (int samples : {16, 128, 1024}){
+            for (float thickness : {2.f, 10.f, 40.f})
+                inputs.push_back(syntheticInput(samples, thickness, 64));
+        }
+    }
+
+    if (options.csv)
+        std::printf("bench,input,ns_per_segment,allocs_per_stroke,verts_per_stroke\n");
+    std::unique_ptr<sf::RenderTexture> gpuTarget;
+    for (const auto& input : inputs)
+        runInput(options, input, gpuTarget);
+    return 0;
+}
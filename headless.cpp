@@ -0,0 +1,282 @@
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Engine/Collision.hpp"
+#include "Engine/History.hpp"
+#include "Engine/InputRecorder.hpp"
+#include "Engine/Level.hpp"
+#include "Engine/LevelFile.hpp"
+#include "Engine/Selection.hpp"
+#include "Engine/ShadowRaster.hpp"
+#include "Engine/SoftRaster.hpp"
+#include "Engine/StrokeBuilder.hpp"
+
+// runs the stroke pipeline with no window or GPU: builds strokes from pointer samples, tessellates,
+// compiles collision, splits into chunks and rasterizes on the CPU, printing how long each step took.
+// the shadow raster is built as well and checked against the plain rasterizer, and undoing the delete
+// of a moved selection is checked to give back the canvas it was deleted from
+
+struct Options {
+    std::string levelPath;
+    std::string replayPath;
+    std::string outPath;
+    int syntheticStrokes = 0;
+    int samplesPerStroke = 120;
+    float thickness = 10.f;
+    sf::Vector2u size{800, 500};
+};
+
+static void usage(){
+    std::cout << "usage: PizarraHeadless [level.pzl] [--synthetic strokes] [--samples n] [--thickness t]\n"
+                 "                       [--replay input.pzr] [--size WxH] [--out canvas.png]\n";
+}
+
+static bool parseArgs(int argc, char** argv, Options& options){
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--synthetic" && hasValue)
+            options.syntheticStrokes = std::atoi(argv[++i]);
+        else if (arg == "--samples" && hasValue)
+            options.samplesPerStroke = std::atoi(argv[++i]);
+        else if (arg == "--thickness" && hasValue)
+            options.thickness = (float)std::atof(argv[++i]);
+        else if (arg == "--replay" && hasValue)
+            options.replayPath = argv[++i];
+        else if (arg == "--out" && hasValue)
+            options.outPath = argv[++i];
+        else if (arg == "--size" && hasValue){
+            unsigned int w, h;
+            if (std::sscanf(argv[++i], "%ux%u", &w, &h) != 2)
+                return false;
+            options.size = {w, h};
+        }
+        else if (arg[0] != '-')
+            options.levelPath = arg;
+        else
+            return false;
+    }
+    return !options.levelPath.empty() || !options.replayPath.empty() || options.syntheticStrokes > 0;
+}
+
+// plays a whiteboard recording against a canvas at the window's origin, the way DrawingCanvas
+// handles it. the brush panel isn't simulated, so every stroke uses the default black brush
+static bool replayStrokes(const Options& options, std::vector<Stroke>& strokes, std::size_t& events){
+    InputReplayer replayer;
+    if (!replayer.open(options.replayPath, InputReplayer::Mode::Fast))
+        return false;
+    StrokeBuilder builder;
+    bool drawing = false;
+    std::uint32_t nextId = strokes.empty() ? 0 : strokes.back().id + 1;
+    sf::FloatRect canvas({0.f, 0.f}, sf::Vector2f(options.size));
+    while (const std::optional event = replayer.next()){
+        if (replayer.getWindowId() != 1) // only the whiteboard (1) draws, the game (0) is skipped
+            continue;
+        if (const auto* button = event->getIf<sf::Event::MouseButtonPressed>()){
+            sf::Vector2f pos(button->position);
+            if (button->button == sf::Mouse::Button::Left && canvas.contains(pos)){
+                builder.begin(pos, sf::Color::Black, options.thickness, 5.f);
+                drawing = true;
+            }
+        }
+        else if (const auto* moved = event->getIf<sf::Event::MouseMoved>()){
+            if (drawing)
+                builder.addSample(sf::Vector2f(moved->position));
+        }
+        else if (event->getIf<sf::Event::MouseButtonReleased>()){
+            drawing = false;
+            if (builder.isActive())
+                strokes.push_back(builder.finish(nextId++));
+        }
+        else if (event->is<sf::Event::MouseLeft>())
+            drawing = false;
+        else if (const auto* key = event->getIf<sf::Event::KeyPressed>()){
+            if (key->code == sf::Keyboard::Key::C){
+                strokes.clear();
+                builder.cancel();
+            }
+            else if (key->control && key->code == sf::Keyboard::Key::Z && !key->shift && !strokes.empty())
+                strokes.pop_back(); // redo isn't simulated
+        }
+    }
+    events = replayer.getEventCount();
+    return true;
+}
+
+// wobbly lines across the canvas, fed in the way mouse samples arrive
+static void syntheticSamples(int strokeIndex, int samples, sf::Vector2u size, std::vector<sf::Vector2f>& out){
+    out.clear();
+    float y = (float)((strokeIndex * 37) % size.y);
+    float phase = strokeIndex * 0.7f;
+    for (int i = 0; i < samples; i++){
+        float t = (float)i / samples;
+        out.push_back({t * size.x, y + std::sin(phase + t * 12.f) * 40.f});
+    }
+}
+
+static SoftRaster renderStrokes(const std::vector<Stroke>& strokes, sf::Vector2u size){
+    SoftRaster raster(size);
+    sf::VertexArray triangles(sf::PrimitiveType::Triangles);
+    for (const auto& stroke : strokes)
+        tessellateStroke(stroke, triangles);
+    raster.drawTriangles(triangles);
+    return raster;
+}
+
+// the ops the whiteboard records when a moved selection is deleted: the move as a replace, then the
+// erase of the moved strokes. each non-additive op checkpoints the canvas right after it, so undoing
+// the erase has to bring the model back to the canvas the replace left, and undoing the replace to
+// the one before it. returns the pixels that disagree
+static std::size_t checkMovedErase(std::vector<Stroke> model, sf::Vector2u size, std::size_t& selectedCount){
+    std::vector<std::uint32_t> selected; // every other stroke, so some stay put under the moved ones
+    for (std::uint32_t i = 0; i < model.size(); i += 2)
+        selected.push_back(i);
+    selectedCount = selected.size();
+    if (selected.empty())
+        return 0;
+    GroupTransform transform;
+    transform.pivot = {size.x / 2.f, size.y / 2.f};
+    transform.offset = {size.x / 8.f, size.y / 16.f};
+    transform.scale = 0.75f; // no turn, fills only take right angles
+
+    SoftRaster original = renderStrokes(model, size);
+    HistoryOp replace;
+    replace.type = HistoryOp::Type::Replace;
+    replace.indices = selected;
+    std::vector<Stroke> after;
+    transformStrokes(model, selected, transform, replace.strokes, after);
+    replace.strokes.insert(replace.strokes.end(), after.begin(), after.end());
+    SoftRaster moved = renderStrokes(model, size);
+    HistoryOp erase;
+    erase.type = HistoryOp::Type::Erase;
+    erase.indices = selected;
+    eraseStrokes(model, selected, erase.strokes);
+
+    History::undoStrokes(erase, model);
+    std::size_t differ = renderStrokes(model, size).countDifferences(moved);
+    History::undoStrokes(replace, model);
+    return differ + renderStrokes(model, size).countDifferences(original);
+}
+
+template <typename F>
+static double timeMs(F&& f){
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv){
+    Options options;
+    if (!parseArgs(argc, argv, options)){
+        usage();
+        return 1;
+    }
+
+    std::vector<Stroke> strokes;
+    if (!options.levelPath.empty()){
+        LevelFile level;
+        double loadMs = timeMs([&](){
+            if (level.open(options.levelPath))
+                level.loadStrokes(strokes);
+        });
+        if (!level.isOpen()){
+            std::cout << "can't open " << options.levelPath << "\n";
+            return 1;
+        }
+        std::cout << "load        " << loadMs << " ms, " << strokes.size() << " strokes\n";
+    }
+
+    if (!options.replayPath.empty()){
+        std::size_t events = 0;
+        bool replayed = false;
+        double replayMs = timeMs([&](){
+            replayed = replayStrokes(options, strokes, events);
+        });
+        if (!replayed){
+            std::cout << "can't replay " << options.replayPath << "\n";
+            return 1;
+        }
+        std::cout << "replay      " << replayMs << " ms, " << events << " events, " << strokes.size() << " strokes\n";
+    }
+
+    // stroke building, from samples for synthetic input and by replaying the stored points otherwise
+    std::size_t points = 0;
+    std::size_t builderVertices = 0;
+    double buildMs = timeMs([&](){
+        StrokeBuilder builder;
+        std::vector<sf::Vector2f> samples;
+        std::vector<Stroke> built;
+        int count = options.syntheticStrokes > 0 ? options.syntheticStrokes : (int)strokes.size();
+        for (int i = 0; i < count; i++){
+            const Stroke* source = options.syntheticStrokes > 0 ? nullptr : &strokes[i];
+            if (source)
+                samples = source->points;
+            else
+                syntheticSamples(i, options.samplesPerStroke, options.size, samples);
+            if (samples.empty())
+                continue;
+            builder.begin(samples[0], source ? source->color : sf::Color::Black, source ? source->thickness : options.thickness, 5.f);
+            for (std::size_t s = 1; s < samples.size(); s++)
+                builder.addSample(samples[s]);
+            builderVertices += builder.getTriangles().getVertexCount();
+            built.push_back(builder.finish(source ? source->id : (std::uint32_t)i));
+            points += built.back().points.size();
+        }
+        if (options.syntheticStrokes > 0)
+            strokes = std::move(built);
+    });
+    std::cout << "build       " << buildMs << " ms, " << points << " points, " << builderVertices << " vertices\n";
+
+    sf::VertexArray triangles(sf::PrimitiveType::Triangles);
+    double tessellateMs = timeMs([&](){
+        for (const auto& stroke : strokes)
+            tessellateStroke(stroke, triangles);
+    });
+    std::cout << "tessellate  " << tessellateMs << " ms, " << triangles.getVertexCount() << " vertices\n";
+
+    std::vector<CollisionCapsule> collision;
+    double collisionMs = timeMs([&](){
+        for (const auto& stroke : strokes)
+            compileCollision(stroke, collision);
+    });
+    std::cout << "collision   " << collisionMs << " ms, " << collision.size() << " capsules\n";
+
+    ChunkMap chunks;
+    double chunkMs = timeMs([&](){
+        splitIntoChunks(strokes, chunks);
+    });
+    std::cout << "chunks      " << chunkMs << " ms, " << chunks.size() << " chunks\n";
+
+    SoftRaster raster(options.size);
+    double rasterMs = timeMs([&](){
+        raster.drawTriangles(triangles);
+    });
+    std::cout << "rasterize   " << rasterMs << " ms, " << options.size.x << "x" << options.size.y << "\n";
+
+    ShadowRaster shadow;
+    double shadowMs = timeMs([&](){
+        shadow.rebuild(strokes);
+    });
+    std::vector<std::uint8_t> shadowPixels((std::size_t)options.size.x * options.size.y * 4);
+    shadow.readPixels(sf::IntRect({0, 0}, sf::Vector2i(options.size)), shadowPixels.data());
+    std::size_t mismatched = 0;
+    for (std::size_t i = 0; i < shadowPixels.size(); i += 4)
+        mismatched += std::memcmp(&shadowPixels[i], raster.getPixels() + i, 4) != 0;
+    std::cout << "shadow      " << shadowMs << " ms, " << shadow.getTileCount() << " tiles, " << mismatched << " pixels differ\n";
+
+    std::size_t selectedCount = 0;
+    std::size_t undoMismatched = checkMovedErase(strokes, options.size, selectedCount);
+    std::cout << "undo erase  " << selectedCount << " moved strokes, " << undoMismatched << " pixels differ\n";
+
+    if (!options.outPath.empty() && !raster.toImage().saveToFile(options.outPath)){
+        std::cout << "can't write " << options.outPath << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -3,10 +3,19 @@
 #include <TGUI/Backend/SFML-Graphics.hpp>
 #include <SelbaWard.hpp>
 #include <iostream>
+#include <algorithm>
 #include <vector>
 #include <cmath>
+#include <cstring>
+#include <optional>
 #include "whiteboard.hpp"
 #include "Engine/Engine.hpp"
+#include "Engine/FrameArena.hpp"
+#include "Engine/ChunkStreamer.hpp"
+#include "Engine/InputRecorder.hpp"
+#include "Engine/Profiler.hpp"
+#include "Engine/ProfilerOverlay.hpp"
+#include "Engine/RenderStats.hpp"
 
 #define TILESIZE 32
 
@@ -27,9 +36,26 @@ std::unique_ptr<sf::RenderTexture> createGrid(sf::RenderWindow& window){
     return grid;
 }
 
-int main(){
+int main(int argc, char** argv){
+    PROFILE_THREAD("main");
     bool gridEnabled = true;
 
+    // --record file.pzr saves every input event, --replay file.pzr [--fast] plays one back instead of live input,
+    // --trace file.json writes profiler zones from the start
+    InputSession session;
+    bool fastReplay = false;
+    for (int i = 1; i < argc; i++)
+        if (std::strcmp(argv[i], "--fast") == 0)
+            fastReplay = true;
+    for (int i = 1; i + 1 < argc; i++){
+        if (std::strcmp(argv[i], "--record") == 0 && !session.startRecording(argv[i + 1]))
+            std::cout << "couldn't record to " << argv[i + 1] << "\n";
+        if (std::strcmp(argv[i], "--replay") == 0 && !session.startReplay(argv[i + 1], fastReplay ? InputReplayer::Mode::Fast : InputReplayer::Mode::RealTime))
+            std::cout << "couldn't replay " << argv[i + 1] << "\n";
+        if (std::strcmp(argv[i], "--trace") == 0 && !Profiler::startTrace(argv[i + 1]))
+            std::cout << "couldn't trace to " << argv[i + 1] << "\n";
+    }
+
     sf::Color skyColor(147, 187, 236);
     
     const unsigned int windowWidth = TILESIZE * 24;
@@ -37,7 +63,7 @@ int main(){
     sf::ContextSettings settings;
     settings.antiAliasingLevel = 8;
     sf::RenderWindow window(sf::VideoMode({windowWidth, windowHeight}), "Pizarra", sf::Style::Default, sf::State::Windowed, settings);
-    window.setFramerateLimit(120);
+    window.setFramerateLimit(session.isFastReplay() ? 0 : 120);
     
     auto gridTexture = createGrid(window);
     sf::Sprite grid(gridTexture->getTexture());
@@ -45,20 +71,80 @@ int main(){
     tgui::Gui gui{window};
 
     Mario mario;
+    std::optional<ChunkStreamer> level; // released before the whiteboard, which saves over its file
+    level.emplace("level.pzl");
+    // the mouse wheel zooms the level (not mario or the grid), far out it's drawn from the mip tiles
+    sf::View camera = window.getDefaultView();
+    float zoom = 1.f;
+
+    // F3 toggles the frame profiler, F4 starts and stops a chrome trace
+    ProfilerOverlay profilerOverlay;
+    auto profilerLegend = tgui::RichTextLabel::create();
+    profilerLegend->setPosition(500, 6);
+    profilerLegend->setTextSize(11);
+    profilerLegend->setVisible(false);
+    gui.add(profilerLegend);
+    unsigned int frameCount = 0;
+
+    session.beginWindow(0);
     while (window.isOpen()) {
-        while (const std::optional event = window.pollEvent()) {
-            gui.handleEvent(*event);
-            if (event->is<sf::Event::Closed>())
-                window.close();
+        {
+            PROFILE_SCOPE("events");
+            while (const std::optional event = session.pollEvent(window)) {
+                gui.handleEvent(*event);
+                if (event->is<sf::Event::Closed>())
+                    window.close();
+                if (const auto* key = event->getIf<sf::Event::KeyPressed>(); key && key->code == sf::Keyboard::Key::F3) {
+                    profilerOverlay.toggle();
+                    profilerLegend->setVisible(profilerOverlay.isVisible());
+                }
+                if (const auto* wheel = event->getIf<sf::Event::MouseWheelScrolled>()) {
+                    zoom = std::clamp(wheel->delta > 0 ? zoom * 0.8f : zoom * 1.25f, 0.25f, 64.f);
+                    camera.setSize(window.getDefaultView().getSize() * zoom);
+                }
+                if (const auto* key = event->getIf<sf::Event::KeyPressed>(); key && key->code == sf::Keyboard::Key::F4) {
+                    if (Profiler::isTracing()){
+                        Profiler::stopTrace();
+                        std::cout << "trace stopped\n";
+                    }
+                    else
+                        std::cout << (Profiler::startTrace("pizarra.trace.json") ? "tracing to pizarra.trace.json\n" : "trace failed\n");
+                }
+            }
+        }
+        {
+            PROFILE_SCOPE("update");
+            level->update(camera, {0.f, 0.f}, zoom); // mario doesn't move yet, so nothing to prefetch ahead of
+        }
+        {
+            PROFILE_SCOPE("draw");
+            CountingTarget target(window);
+            target.clear(skyColor);
+            if (gridEnabled){
+                target.draw(grid);
+            }
+            window.setView(camera);
+            level->draw(window);
+            window.setView(window.getDefaultView());
+            mario.render(window);
+            gui.draw(); // tgui draws straight to the window, so its own draws aren't counted
+            window.draw(profilerOverlay); // left out of the counts on purpose
         }
-        window.clear(skyColor);
-        if (gridEnabled){
-            window.draw(grid);
+        {
+            PROFILE_SCOPE("display");
+            window.display();
         }
-        mario.render(window);
-        gui.draw();
-        window.display();
+        session.endFrame();
+        PROFILE_COUNTER("resident chunks", level->getResidentCount());
+        RenderStats::endFrame();
+        FrameArena::endFrame();
+        PROFILE_FRAME();
+        profilerOverlay.update();
+        if (profilerOverlay.isVisible() && frameCount++ % 30 == 0)
+            profilerLegend->setText(profilerOverlay.getSummary());
     }
-    openWhiteboardWindow();
+    level.reset();
+    openWhiteboardWindow(session);
+    Profiler::stopTrace();
     return 0;
 }
\ No newline at end of file
@@ -2,168 +2,60 @@
 #include <TGUI/TGUI.hpp>
 #include <TGUI/Backend/SFML-Graphics.hpp>
 #include "gfx/eraser.h"
+#include "Engine/Brush.hpp"
+#include "Engine/CurveOverlay.hpp"
+#include "Engine/FloodFill.hpp"
+#include "Engine/FrameArena.hpp"
+#include "Engine/History.hpp"
+#include "Engine/InputRecorder.hpp"
+#include "Engine/Journal.hpp"
+#include "Engine/LevelFile.hpp"
+#include "Engine/MotionPredictor.hpp"
+#include "Engine/Palette.hpp"
+#include "Engine/PaletteModel.hpp"
+#include "Engine/Profiler.hpp"
+#include "Engine/ProfilerOverlay.hpp"
+#include "Engine/RenderStats.hpp"
+#include "Engine/Selection.hpp"
+#include "Engine/ShadowRaster.hpp"
+#include "Engine/Shape.hpp"
+#include "Engine/ShapeRecognizer.hpp"
+#include "Engine/StreamVertexBuffer.hpp"
+#include "Engine/StrokeBuilder.hpp"
+#include "Engine/StrokeIndex.hpp"
+#include "Engine/WorkerPool.hpp"
 #include <iostream>
+#include <mutex>
 #include <vector>
 #include <cmath>
 
-sf::Vertex constructVertex(sf::Vector2f pos, sf::Color col){
-    sf::Vertex vtx;
-    vtx.position = pos;
-    vtx.color = col;
-    return vtx;
-}
+#define SHAPE_CLOSE_DISTANCE 6.f // a polyline ends when its last corner is clicked again, this close
+#define SUGGESTION_ALPHA 96      // the shape a stroke was recognized as is drawn this faintly over it
+#define LASSO_SPACING 3.f        // pointer travel between the lasso's points
+#define SELECTION_HANDLE_RADIUS 6.f
+#define SELECTION_ROTATE_OFFSET 20.f // the rotate handle sits this far above the selection box
+#define SELECTION_MIN_SCALE 0.05f
 
 sf::Vector2f normalize(sf::Vector2f v) {
     float len = std::sqrt(v.x * v.x + v.y * v.y);
     return len != 0 ? v / len : sf::Vector2f(0, 0); // return 0 vector if length is 0, otherwise conver it to unit vector
 }
-class CircleButton : public tgui::CanvasSFML {
-public:
-    using Ptr = std::shared_ptr<CircleButton>;
-
-    CircleButton(float radius, sf::Color normalColor = sf::Color::Blue, sf::Color hoverColor = sf::Color::Green, bool imageEnabled = false)
-        : m_radius(radius), m_normalColor(normalColor), m_hoverColor(hoverColor), m_isHovered(false), m_imageEnabled(imageEnabled)
-    {
-        setSize({radius * 2, radius * 2});
-        setFocusable(true);
-        onMouseEnter([this](){
-            m_isHovered = true;
-            updateGraphics();
-        });
-        onMouseLeave([this](){
-            m_isHovered = false;
-            updateGraphics();
-        });
-        m_buttonLabel = tgui::Label::create();
-        m_buttonLabel->onSizeChange([this](){updateGraphics();});
-        m_buttonLabel->onPositionChange([this](){updateGraphics();});
-        updateGraphics();
-    }
-
-    static Ptr create(float radius, sf::Color normalColor = sf::Color::Blue, sf::Color hoverColor = sf::Color::Green, bool imageEnabled = false) {
-        return std::make_shared<CircleButton>(radius, normalColor, hoverColor, imageEnabled);
-    }
-
-    void setImageEnabled(bool imageEnabled){
-        m_imageEnabled = imageEnabled;
-        updateGraphics();
-    }
-
-    void setImage(sf::Texture& image){
-        m_buttonImage = image;
-        updateGraphics();
-    }
-
-    tgui::Label::Ptr getLabel(){
-        return m_buttonLabel;
-    }
-
-    sf::Color getNormalColor(){
-       return m_normalColor;
-    }
-
-    sf::Color getHoverColor(){
-        return m_hoverColor;
-    }
-
-    float getOutlineThickness(){
-        return m_outlineThickness;
-    }
-
-    void setNormalColor(sf::Color normalColor){
-        m_normalColor = normalColor;
-        updateGraphics();
-    }
-
-    void setHoverColor(sf::Color hoverColor){
-        m_hoverColor = hoverColor;
-        updateGraphics();
-    }
-
-    void setOutline(sf::Color outlineColor, float outlineThickness){
-        m_outlineColor = outlineColor;
-        m_outlineThickness = outlineThickness;
-        setSize({(m_radius + outlineThickness) * 2, (m_radius + outlineThickness) * 2});
-        setPosition({getPosition().x - m_outlineThickness + m_totalOffset, getPosition().y - m_outlineThickness + m_totalOffset}); // totalOffset term for correction
-        m_totalOffset = m_outlineThickness;
-        updateGraphics();
-    }
-
-    void updateGraphics() {
-        clear(sf::Color::Transparent);
-        sf::CircleShape circle(m_radius);
-        if(getParent()){
-            auto widgets = getParent()->getWidgets();
-            bool hasButtonLabel = false;
-            for (auto widget : widgets){
-                if (widget == m_buttonLabel){
-                    hasButtonLabel = true;
-                }
-            }
-            if (!hasButtonLabel){
-                getParent()->add(m_buttonLabel);
-                std::cout << "added buttonLabel\n";
-            }
-        }
-        circle.setPointCount(100); // Smooth circle
-        circle.setFillColor(m_isHovered ? m_hoverColor : m_normalColor);
-        circle.setPosition({m_outlineThickness, m_outlineThickness});
-        circle.setOutlineThickness(m_outlineThickness);
-        circle.setOutlineColor(m_outlineColor);
-        m_buttonLabel->setPosition({getPosition().x + m_outlineThickness + m_radius - m_buttonLabel->getSize().x/2, getPosition().y + m_outlineThickness + m_radius - m_buttonLabel->getSize().y/2});
-        draw(circle);
-        if (m_imageEnabled){
-            sf::Sprite drawSprite(m_buttonImage);
-            drawSprite.setPosition({m_outlineThickness + m_radius - m_buttonImage.getSize().x/2, m_outlineThickness + m_radius - m_buttonImage.getSize().y/2});
-            draw(drawSprite);
-        }
-        display();
-    }
-
-    tgui::Signal& getSignal(tgui::String signalName) override {
-        if (signalName == "Clicked")
-            return m_signalClicked;
-        return tgui::CanvasSFML::getSignal(signalName);
-    }
-
-protected:
-    bool isMouseOnWidget(tgui::Vector2f pos) const override {
-        tgui::Vector2f mouseCoords = {pos.x - getPosition().x, pos.y - getPosition().y}; // make the mouse coordinates relative
-        //std::cout << "mouseOnWidget called at: " << mouseCoords.x << ", " << mouseCoords.y << "\n";
-        float dx = mouseCoords.x - (m_radius + m_outlineThickness);
-        float dy = mouseCoords.y - (m_radius + m_outlineThickness);
-        return ((dx * dx + dy * dy) <= (m_radius * m_radius));
-    }
-
-    /*void mouseEnteredWidget() override {
-
-    }*/
-
-    /*void mouseLeftWidget() override {
-
-    }*/
-
-    bool leftMousePressed(tgui::Vector2f) {
-        return m_signalClicked.emit(this);
-    }
-private:
-    float m_radius;
-    float m_outlineThickness = 0;
-    bool m_isHovered;
-    bool m_imageEnabled = false;
-    sf::Texture m_buttonImage;
-    sf::Color m_outlineColor;
-    sf::Color m_normalColor;
-    sf::Color m_hoverColor;
-    tgui::Label::Ptr m_buttonLabel;
-    float m_totalOffset = 0;
-    tgui::Signal m_signalClicked{"Clicked"};
-};
-
 class DrawingCanvas : public tgui::CanvasSFML {
 public:
     using Ptr = std::shared_ptr<DrawingCanvas>;
 
+    enum class Tool {
+        Brush,
+        Bucket,
+        Line,
+        Rect,
+        Ellipse,
+        Arc,
+        Polyline,
+        Lasso,
+        BoxSelect
+    };
+
     DrawingCanvas(sf::RenderWindow* realWindow, sf::Color strokeColor, float lineThickness, float spacing)
         : m_realWindow(realWindow), m_strokeColor(strokeColor), m_lineThickness(lineThickness), m_spacing(spacing)
     {
@@ -173,30 +65,67 @@ public:
         this->onMouseLeave([this]() {
             m_mouseOnCanvas = false;
         });
-        onMousePress([this](){
+        onMousePress([this](tgui::Vector2f pos){
             //this->setFocused(true);
             std::cout << "focusing\n";
-            sf::Vector2i rawMousePos = sf::Mouse::getPosition(*m_realWindow);
-            sf::Vector2f mousePos = this->mapPixelToCoords({ (float)(rawMousePos.x - getPosition().x), (float)(rawMousePos.y - getPosition().y) }); // take difference to make the position relative
+            sf::Vector2f mousePos = this->mapPixelToCoords({pos.x, pos.y}); // already relative to the canvas
+            m_mousePos = pos;
+            clearSuggestion();
+            if (m_tool == Tool::Bucket){
+                fillAt(mousePos);
+                return;
+            }
+            if (isSelectTool()){
+                pressSelect(mousePos);
+                return;
+            }
+            if (m_tool != Tool::Brush){
+                pressShape(mousePos);
+                return;
+            }
             m_drawing = true;
-            m_currentStroke.clear();
-            m_currentStrokeTriangles.clear();
-            m_lastPos = mousePos;
-            m_currentStroke.push_back(m_lastPos);
+            m_builder.begin(mousePos, m_strokeColor, m_lineThickness, m_spacing, m_brush);
+            m_liveBuffer.clear();
+            m_predictor.reset();
+            m_predictor.addSample(mousePos, m_clock.getElapsedTime().asSeconds());
+            m_lastSample = mousePos;
+            m_curveOverlay.setLiveCurve({});
         });
         onMouseRelease([this](){
             m_drawing = false;
+            if (isSelectTool()){
+                releaseSelect();
+                return;
+            }
+            if (m_tool != Tool::Brush && m_tool != Tool::Bucket){
+                releaseShape();
+                return;
+            }
+            if (!m_builder.isActive())
+                return;
 
             // Draw current stroke to cached texture
-            if (m_currentStrokeTriangles.getVertexCount() != 0) {
-                m_cacheTexture.setActive(true);
-                m_cacheTexture.draw(m_currentStrokeTriangles);
-                m_cacheTexture.display();
-                m_cacheTexture.setActive(false);
+            // the live buffer already holds the stroke on the GPU, except whatever arrived since the last frame.
+            // a fitted stroke is baked from its flattened curve instead, the same triangles undo and chunks rebuild
+            bool stamped = m_builder.getStamp() != BrushStamp::Solid;
+            m_liveBuffer.sync(m_builder.getTriangles());
+            m_strokes.push_back(m_builder.finish(m_nextStrokeId++));
+            CountingTarget cache(m_cacheTexture);
+            if (m_strokes.back().curve.empty()){
+                m_liveBuffer.draw(cache, getStrokeStates(stamped));
+            } else {
+                sf::VertexArray triangles(sf::PrimitiveType::Triangles);
+                tessellateStroke(m_strokes.back(), triangles);
+                cache.draw(triangles, getStrokeStates(stamped));
             }
-
-            m_currentStroke.clear();
-            m_currentStrokeTriangles.clear();
+            m_liveBuffer.clear();
+            m_cacheTexture.display();
+            m_curvesDirty = true;
+            m_shadow.drawStroke(m_strokes.back());
+            m_history.recordAdd(m_strokes.back(), m_cacheTexture);
+            if (m_journal)
+                m_journal->recordAdd(m_strokes.back());
+            requestRecognition(m_strokes.back());
         });
     }
 
@@ -212,104 +141,760 @@ public:
         m_cacheTexture = sf::RenderTexture({(unsigned int)getSize().x, (unsigned int)getSize().y});
         m_cacheTexture.clear(sf::Color::White);
         m_cacheTexture.display();
+        m_history.reset(m_cacheTexture);
     }
 
     void updateGraphics() {
+        PROFILE_SCOPE("updateGraphics");
         if (!m_mouseOnCanvas)
             m_drawing = false;
 
         if (m_drawing) {
-            sf::Vector2i rawMousePos = sf::Mouse::getPosition(*m_realWindow);
-            sf::Vector2f currentPos = this->mapPixelToCoords({ (float)(rawMousePos.x - getPosition().x), (float)(rawMousePos.y - getPosition().y) }); // take difference to make the position relative
-            float dist = std::hypot(currentPos.x - m_lastPos.x, currentPos.y - m_lastPos.y);
-            int steps = std::max(1, static_cast<int>(dist / m_spacing));
-
-            for (int i = 1; i <= steps; ++i) {
-                float t = static_cast<float>(i) / steps;
-                sf::Vector2f interp = m_lastPos + t * (currentPos - m_lastPos);
-                m_currentStroke.push_back(interp);
-                sf::CircleShape cap(m_lineThickness / 2.f);
-                cap.setFillColor(m_strokeColor);
-                cap.setPosition(interp - sf::Vector2f(m_lineThickness / 2.f, m_lineThickness / 2.f));
-                m_cacheTexture.draw(cap);
-
-                if (m_currentStroke.size() >= 2) {
-                    auto tri = createThickLine(m_currentStroke[m_currentStroke.size() - 2], interp, m_lineThickness, m_strokeColor);
-                    for (auto t : tri){
-                        m_currentStrokeTriangles.append(t);
-                    }
-                }
+            sf::Vector2f currentPos = this->mapPixelToCoords({m_mousePos.x, m_mousePos.y});
+            float now = m_clock.getElapsedTime().asSeconds();
+            if (currentPos != m_lastSample){
+                m_builder.addSample(currentPos);
+                m_predictor.addSample(currentPos, now);
+                m_lastSample = currentPos;
             }
-
-            m_lastPos = currentPos;
+            // the ink would otherwise trail the pointer by the frame it takes to reach the screen
+            if (m_predictionLatency > 0.f)
+                m_builder.setPrediction(m_predictor.predict(now, m_predictionLatency));
+        } else {
+            m_builder.clearPrediction();
         }
+        if (!m_shapeHandles.empty())
+            m_shapeHandles.back() = this->mapPixelToCoords({m_mousePos.x, m_mousePos.y});
+        if (m_drag != Drag::None)
+            dragSelection(this->mapPixelToCoords({m_mousePos.x, m_mousePos.y}));
+        pollRecognition();
 
-        this->clear();
-        this->draw(sf::Sprite(m_cacheTexture.getTexture()));
-        this->draw(m_currentStrokeTriangles);
+        CountingTarget target(getRenderTexture());
+        target.clear();
+        target.draw(sf::Sprite(m_cacheTexture.getTexture()));
+        m_liveBuffer.sync(m_builder.getTriangles());
+        m_liveBuffer.draw(target, getStrokeStates(m_builder.getStamp() != BrushStamp::Solid));
+        target.draw(m_builder.getPrediction(), getStrokeStates(m_builder.getStamp() != BrushStamp::Solid));
+        if (!m_shapeHandles.empty()){
+            updateShapePreview();
+            FrameVector<sf::Vertex> triangles;
+            triangles.reserve(getTessellatedVertexCount(m_shapePreview));
+            tessellateStroke(m_shapePreview, triangles);
+            target.draw(triangles.data(), triangles.size(), sf::PrimitiveType::Triangles, getStrokeStates(false));
+        }
+        if (!m_selected.empty()){
+            // the lifted strokes never change while they're dragged, only the transform they're drawn through
+            sf::RenderStates states = getStrokeStates(m_selectedStamped);
+            states.transform = m_groupTransform.getTransform();
+            m_selectedBuffer.draw(target, states);
+            drawSelectionBox(target);
+        }
+        if (m_drag == Drag::Lasso)
+            drawLasso(target);
+        if (!m_suggestion.points.empty())
+            target.draw(m_suggestionTriangles, getStrokeStates(false));
+        if (m_curveOverlay.isVisible()){
+            if (m_curvesDirty)
+                m_curveOverlay.setStrokes(m_strokes);
+            m_curvesDirty = false;
+            m_curveOverlay.setLiveCurve(m_builder.isFitting() ? m_builder.getCurve() : std::vector<sf::Vector2f>());
+            target.draw(m_curveOverlay);
+        }
         this->display();
     }
 
+    // positions come from events rather than sf::Mouse, so a replayed recording draws the same strokes
+    void mouseMoved(tgui::Vector2f pos) override {
+        tgui::CanvasSFML::mouseMoved(pos);
+        m_mousePos = pos - getPosition(); // pos is relative to the parent
+    }
+
+    // H shows the fitted curves and their handles
+    void toggleCurves(){
+        m_curveOverlay.toggle();
+        m_curvesDirty = true;
+    }
+
     void clearCanvas(){
-        m_cacheTexture.clear(sf::Color::White);
-        m_cacheTexture.display();
-        m_currentStroke.clear();
-        m_currentStrokeTriangles.clear();
+        dropSelection();
+        resetCanvas();
+        m_history.recordClear(std::move(m_strokes), m_cacheTexture);
+        m_strokes.clear();
+        if (m_journal)
+            m_journal->recordClear();
+    }
+
+    // swaps the last stroke for the shape it was recognized as, keeping its id and its place
+    bool acceptSuggestion(){
+        if (m_suggestion.points.empty() || m_strokes.empty() || m_strokes.back().id != m_suggestion.id){
+            clearSuggestion();
+            return false;
+        }
+        Stroke before = std::move(m_strokes.back());
+        m_strokes.back() = std::move(m_suggestion);
+        clearSuggestion();
+        bakeStrokes();
+        m_shadow.invalidate(before);
+        m_shadow.invalidate(m_strokes.back());
+        m_index.invalidate();
+        m_curvesDirty = true;
+        if (m_journal)
+            m_journal->recordReplace(before.id, m_strokes.back());
+        std::vector<Stroke> befores;
+        befores.push_back(std::move(before));
+        m_history.recordReplace({(std::uint32_t)(m_strokes.size() - 1)}, std::move(befores), {m_strokes.back()}, m_cacheTexture);
+        return true;
+    }
+
+    void undo(){
+        clearSuggestion();
+        dropSelection();
+        const HistoryOp* op = m_history.undo(m_strokes, m_cacheTexture);
+        m_curvesDirty = true;
+        m_index.invalidate();
+        invalidateShadow(op);
+        if (!op || !m_journal)
+            return;
+        if (op->type == HistoryOp::Type::Add)
+            m_journal->recordErase(op->strokes[0].id);
+        else if (op->type == HistoryOp::Type::Erase){
+            for (std::size_t i = 0; i < op->indices.size(); i++)
+                m_journal->recordInsert(op->indices[i], op->strokes[i]);
+        }
+        else if (op->type == HistoryOp::Type::Replace)
+            journalReplace(*op, false);
+        else
+            journalStrokes(); // the clear came back
+    }
+
+    void redo(){
+        clearSuggestion();
+        dropSelection();
+        const HistoryOp* op = m_history.redo(m_strokes, m_cacheTexture);
+        m_curvesDirty = true;
+        m_index.invalidate();
+        invalidateShadow(op);
+        if (!op || !m_journal)
+            return;
+        if (op->type == HistoryOp::Type::Add)
+            m_journal->recordAdd(m_strokes.back());
+        else if (op->type == HistoryOp::Type::Erase){
+            for (const Stroke& stroke : op->strokes)
+                m_journal->recordErase(stroke.id);
+        }
+        else if (op->type == HistoryOp::Type::Replace)
+            journalReplace(*op, true);
+        else
+            m_journal->recordClear();
+    }
+
+    // the whole list changed at once: journaled as a clear and an add per stroke, never as a copy
+    void journalStrokes(){
+        m_journal->recordClear();
+        for (const Stroke& stroke : m_strokes)
+            m_journal->recordAdd(stroke);
+    }
+
+    // a replace op holds every stroke as it was, then as it is now; only the ones it touched are journaled
+    void journalReplace(const HistoryOp& op, bool forward){
+        std::size_t count = op.indices.size();
+        for (std::size_t i = 0; i < count; i++){
+            const Stroke& from = op.strokes[forward ? i : count + i];
+            m_journal->recordReplace(from.id, m_strokes[op.indices[i]]);
+        }
+    }
+
+    // replaces the whole drawing and rebakes it
+    void setStrokes(std::vector<Stroke> strokes){
+        resetCanvas();
+        m_strokes = std::move(strokes);
+        m_nextStrokeId = m_strokes.empty() ? 0 : m_strokes.back().id + 1;
+        bakeStrokes();
+        m_history.reset(m_cacheTexture);
+        m_shadow.rebuild(m_strokes);
+    }
+
+    bool saveDrawing(const std::string& path){
+        dropSelection();
+        return saveLevelFile(path, m_strokes, 0, true);
+    }
+
+    bool loadDrawing(const std::string& path){
+        LevelFile level;
+        std::vector<Stroke> strokes;
+        if (!level.open(path) || !level.loadStrokes(strokes))
+            return false;
+        setStrokes(std::move(strokes));
+        if (m_journal)
+            journalStrokes();
+        return true;
     }
 
     // getter/setter functions
     void setStrokeColor(sf::Color strokeColor){ m_strokeColor = strokeColor; }
     void setLineThickness(float lineThickness){ m_lineThickness = lineThickness; }
     void setSpacing(float spacing){ m_spacing = spacing; }
+    void setBrush(const Brush& brush){ m_brush = brush; }
+    void setTool(Tool tool){
+        dropSelection();
+        m_tool = tool;
+        clearSuggestion();
+        m_shapeHandles.clear(); // a half placed shape is dropped
+        m_shapeBending = false;
+    }
+    void setSmoothing(const OneEuroSettings& settings){ m_builder.setSmoothing(settings); }
+    void deselect(){ dropSelection(); }
+
+    // Delete erases the selection as it's shown. a moved selection is first put down as its own
+    // replace op, so the canvas undo restores has the strokes where the erase took them from
+    void eraseSelection(){
+        if (m_selected.empty())
+            return;
+        std::vector<std::uint32_t> indices = std::move(m_selected);
+        m_selected.clear();
+        m_drag = Drag::None;
+        m_selectedTriangles.clear();
+        m_selectedBuffer.clear();
+        if (!m_groupTransform.isIdentity()){
+            commitTransform(indices);
+            bakeStrokes(indices);
+        }
+        for (std::uint32_t i : indices)
+            m_shadow.invalidate(m_strokes[i]);
+        std::vector<Stroke> erased;
+        eraseStrokes(m_strokes, indices, erased);
+        m_index.invalidate();
+        m_curvesDirty = true;
+        if (m_journal){
+            for (const Stroke& stroke : erased)
+                m_journal->recordErase(stroke.id);
+        }
+        // the cache is baked without the selection, so it already shows the erase
+        m_history.recordErase(std::move(indices), std::move(erased), m_cacheTexture);
+    }
+
+    void setRecognition(bool enabled){ m_recognizing = enabled; } // offering shapes for finished strokes
+    void setPredictionLatency(float seconds){ m_predictionLatency = seconds; } // 0 turns the predicted tail off
     sf::Color getStrokeColor(){ return m_strokeColor; }
     float getLineThickness(){ return m_lineThickness; }
     float getSpacing(){ return m_spacing; }
+    const std::vector<Stroke>& getStrokes(){ return m_strokes; }
+    void setJournal(Journal* journal){ m_journal = journal; }
+    MotionPredictor& getPredictor(){ return m_predictor; }
 
 protected:
 
 
 private:
+    enum class Drag {
+        None,
+        Lasso, // picking, m_lasso follows the pointer
+        Move,
+        Scale,
+        Rotate
+    };
+
+    void resetCanvas(){
+        CountingTarget(m_cacheTexture).clear(sf::Color::White);
+        m_cacheTexture.display();
+        m_builder.cancel();
+        m_liveBuffer.clear();
+        m_curvesDirty = true;
+        m_shadow.clear();
+        m_index.invalidate();
+        clearSuggestion();
+        m_selected.clear();
+        m_drag = Drag::None;
+        m_lasso.clear();
+    }
+
+    // redraws the cache from the stroke list, leaving out the ascending indices in skip
+    void bakeStrokes(const std::vector<std::uint32_t>& skip = {}){
+        sf::VertexArray triangles(sf::PrimitiveType::Triangles);
+        bool stamped = false;
+        std::size_t next = 0;
+        for (std::size_t i = 0; i < m_strokes.size(); i++){
+            if (next < skip.size() && skip[next] == i){
+                next++;
+                continue;
+            }
+            tessellateStroke(m_strokes[i], triangles);
+            stamped |= m_strokes[i].stamp != BrushStamp::Solid;
+        }
+        CountingTarget cache(m_cacheTexture);
+        cache.clear(sf::Color::White);
+        cache.draw(triangles, getStrokeStates(stamped));
+        m_cacheTexture.display();
+    }
+
+    // plain solid strokes are fitted on a worker, and a guess comes back through pollRecognition
+    void requestRecognition(const Stroke& stroke){
+        if (!m_recognizing || stroke.stamp != BrushStamp::Solid || !stroke.widths.empty() || !stroke.alphas.empty())
+            return;
+        m_workers.submit([this, id = stroke.id, points = stroke.points](){
+            ShapeGuess guess = recognizeShape(points);
+            if (guess.shape == StrokeShape::Freehand)
+                return;
+            std::lock_guard<std::mutex> lock(m_recognizedMutex);
+            m_recognized.push_back({id, std::move(guess)});
+        });
+    }
+
+    // a guess is only offered while its stroke is still the last one and nothing new is being drawn
+    void pollRecognition(){
+        std::lock_guard<std::mutex> lock(m_recognizedMutex);
+        for (auto& recognized : m_recognized){
+            if (m_drawing || m_strokes.empty() || m_strokes.back().id != recognized.strokeId)
+                continue;
+            const Stroke& stroke = m_strokes.back();
+            m_suggestion = makeShapeStroke(recognized.guess.shape, std::move(recognized.guess.handles), stroke.color, stroke.thickness);
+            m_suggestion.id = stroke.id;
+            // tessellated once here, faded, and drawn as is until it's accepted or dropped
+            m_suggestionTriangles.clear();
+            tessellateStroke(m_suggestion, m_suggestionTriangles);
+            for (std::size_t i = 0; i < m_suggestionTriangles.getVertexCount(); i++)
+                m_suggestionTriangles[i].color.a = (std::uint8_t)(m_suggestionTriangles[i].color.a * SUGGESTION_ALPHA / 255);
+        }
+        m_recognized.clear();
+    }
+
+    void clearSuggestion(){
+        m_suggestion = Stroke();
+        m_suggestionTriangles.clear();
+    }
+
+    // whatever undo or redo took away or brought back is redrawn in the shadow on its next sync
+    void invalidateShadow(const HistoryOp* op){
+        if (!op)
+            return;
+        for (const auto& stroke : op->strokes)
+            m_shadow.invalidate(stroke);
+    }
+
+    bool isSelectTool() const { return m_tool == Tool::Lasso || m_tool == Tool::BoxSelect; }
+
+    // a press on a selection drags it by whatever part was hit, anywhere else drops it and starts
+    // picking again
+    void pressSelect(sf::Vector2f pos){
+        if (!m_selected.empty()){
+            Drag drag = hitSelection(pos);
+            if (drag != Drag::None){
+                m_drag = drag;
+                m_dragStart = pos;
+                m_dragFrom = m_groupTransform;
+                return;
+            }
+            dropSelection();
+        }
+        m_drag = Drag::Lasso;
+        m_lasso.assign(m_tool == Tool::BoxSelect ? 2 : 1, pos); // a box keeps its two corners
+    }
+
+    void dragSelection(sf::Vector2f pos){
+        sf::Vector2f center = m_dragFrom.getCenter();
+        switch (m_drag){
+            case Drag::Lasso: {
+                sf::Vector2f last = m_lasso.back();
+                if (m_tool == Tool::BoxSelect)
+                    m_lasso.back() = pos;
+                else if (std::hypot(pos.x - last.x, pos.y - last.y) >= LASSO_SPACING)
+                    m_lasso.push_back(pos);
+                break;
+            }
+            case Drag::Move:
+                m_groupTransform.offset = m_dragFrom.offset + pos - m_dragStart;
+                break;
+            case Drag::Scale: {
+                float from = std::hypot(m_dragStart.x - center.x, m_dragStart.y - center.y);
+                if (from > 0.f)
+                    m_groupTransform.scale = std::max(m_dragFrom.scale * std::hypot(pos.x - center.x, pos.y - center.y) / from, SELECTION_MIN_SCALE);
+                break;
+            }
+            case Drag::Rotate:
+                m_groupTransform.angle = m_dragFrom.angle + std::atan2(pos.y - center.y, pos.x - center.x)
+                    - std::atan2(m_dragStart.y - center.y, m_dragStart.x - center.x);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void releaseSelect(){
+        if (m_drag == Drag::Lasso){
+            std::vector<std::uint32_t> picked;
+            m_index.sync(m_strokes);
+            if (m_tool == Tool::BoxSelect){
+                sf::Vector2f a = m_lasso[0], b = m_lasso[1];
+                sf::Vector2f min(std::min(a.x, b.x), std::min(a.y, b.y));
+                selectInRect(m_strokes, m_index, sf::FloatRect(min, sf::Vector2f(std::max(a.x, b.x), std::max(a.y, b.y)) - min), picked);
+            } else {
+                selectInPolygon(m_strokes, m_index, m_lasso, picked);
+            }
+            m_lasso.clear();
+            liftSelection(std::move(picked));
+        }
+        m_drag = Drag::None;
+    }
+
+    // takes the strokes out of the cache and into a buffer of their own, tessellated once for the
+    // whole time they stay selected
+    void liftSelection(std::vector<std::uint32_t> picked){
+        if (picked.empty())
+            return;
+        m_selected = std::move(picked);
+        m_selectedTriangles.clear();
+        m_selectedStamped = false;
+        m_selectionTurns = true;
+        m_selectionBox = m_strokes[m_selected[0]].getBounds();
+        for (std::uint32_t i : m_selected){
+            const Stroke& stroke = m_strokes[i];
+            tessellateStroke(stroke, m_selectedTriangles);
+            m_selectedStamped |= stroke.stamp != BrushStamp::Solid;
+            m_selectionTurns &= stroke.stamp != BrushStamp::Fill; // fill rectangles can't leave the axes
+            sf::FloatRect bounds = stroke.getBounds();
+            sf::Vector2f min(std::min(m_selectionBox.position.x, bounds.position.x), std::min(m_selectionBox.position.y, bounds.position.y));
+            sf::Vector2f max(std::max(m_selectionBox.position.x + m_selectionBox.size.x, bounds.position.x + bounds.size.x),
+                std::max(m_selectionBox.position.y + m_selectionBox.size.y, bounds.position.y + bounds.size.y));
+            m_selectionBox = sf::FloatRect(min, max - min);
+        }
+        m_selectedBuffer.clear();
+        m_selectedBuffer.sync(m_selectedTriangles);
+        m_groupTransform = GroupTransform();
+        m_groupTransform.pivot = m_selectionBox.getCenter();
+        bakeStrokes(m_selected);
+    }
+
+    // puts the selection back: the strokes are rewritten through the transform only now, once,
+    // and the cache is baked with them in their place in the list
+    void dropSelection(){
+        if (m_selected.empty())
+            return;
+        std::vector<std::uint32_t> indices = std::move(m_selected);
+        m_selected.clear();
+        m_drag = Drag::None;
+        m_selectedTriangles.clear();
+        m_selectedBuffer.clear();
+        if (m_groupTransform.isIdentity())
+            bakeStrokes();
+        else
+            commitTransform(indices);
+    }
+
+    // rewrites the strokes through the group's transform as one replace op, with the cache baked
+    // to show them in their new place
+    void commitTransform(const std::vector<std::uint32_t>& indices){
+        std::vector<Stroke> before, after;
+        for (std::uint32_t i : indices)
+            m_shadow.invalidate(m_strokes[i]);
+        transformStrokes(m_strokes, indices, m_groupTransform, before, after);
+        for (const Stroke& stroke : after)
+            m_shadow.invalidate(stroke);
+        m_groupTransform = GroupTransform();
+        bakeStrokes();
+        m_index.invalidate();
+        m_curvesDirty = true;
+        if (m_journal){
+            for (const Stroke& stroke : after)
+                m_journal->recordReplace(stroke.id, stroke);
+        }
+        m_history.recordReplace(indices, std::move(before), std::move(after), m_cacheTexture);
+    }
+
+    sf::Vector2f getHandlePosition(Drag handle) const {
+        sf::Transform transform = m_groupTransform.getTransform();
+        const sf::FloatRect& box = m_selectionBox;
+        if (handle == Drag::Scale)
+            return transform.transformPoint(box.position + box.size);
+        float c = std::cos(m_groupTransform.angle), s = std::sin(m_groupTransform.angle);
+        return transform.transformPoint({box.position.x + box.size.x / 2.f, box.position.y}) + sf::Vector2f(s, -c) * SELECTION_ROTATE_OFFSET;
+    }
+
+    Drag hitSelection(sf::Vector2f pos) const {
+        auto near = [&pos](sf::Vector2f p){ return std::hypot(pos.x - p.x, pos.y - p.y) <= SELECTION_HANDLE_RADIUS; };
+        if (near(getHandlePosition(Drag::Scale)))
+            return Drag::Scale;
+        if (m_selectionTurns && near(getHandlePosition(Drag::Rotate)))
+            return Drag::Rotate;
+        sf::Vector2f local = m_groupTransform.getTransform().getInverse().transformPoint(pos);
+        return m_selectionBox.contains(local) ? Drag::Move : Drag::None;
+    }
+
+    void drawSelectionBox(CountingTarget& target) const {
+        sf::Transform transform = m_groupTransform.getTransform();
+        const sf::FloatRect& box = m_selectionBox;
+        sf::Vector2f corners[4] = {box.position, {box.position.x + box.size.x, box.position.y}, box.position + box.size, {box.position.x, box.position.y + box.size.y}};
+        sf::Vertex outline[5];
+        for (int i = 0; i < 5; i++)
+            outline[i] = sf::Vertex{transform.transformPoint(corners[i % 4]), sf::Color(0, 120, 215)};
+        target.draw(outline, 5, sf::PrimitiveType::LineStrip);
+        sf::CircleShape handle(SELECTION_HANDLE_RADIUS);
+        handle.setOrigin({SELECTION_HANDLE_RADIUS, SELECTION_HANDLE_RADIUS});
+        handle.setFillColor(sf::Color::White);
+        handle.setOutlineColor(sf::Color(0, 120, 215));
+        handle.setOutlineThickness(1.f);
+        handle.setPosition(getHandlePosition(Drag::Scale));
+        target.draw(handle);
+        if (m_selectionTurns){
+            handle.setPosition(getHandlePosition(Drag::Rotate));
+            target.draw(handle);
+        }
+    }
+
+    void drawLasso(CountingTarget& target) const {
+        FrameVector<sf::Vertex> outline;
+        if (m_tool == Tool::BoxSelect){
+            sf::Vector2f a = m_lasso[0], b = m_lasso[1];
+            for (sf::Vector2f p : {a, sf::Vector2f(b.x, a.y), b, sf::Vector2f(a.x, b.y), a})
+                outline.push_back(sf::Vertex{p, sf::Color(0, 120, 215)});
+        } else {
+            for (sf::Vector2f p : m_lasso)
+                outline.push_back(sf::Vertex{p, sf::Color(0, 120, 215)});
+            outline.push_back(outline.front()); // closed the way it will be tested
+        }
+        target.draw(outline.data(), outline.size(), sf::PrimitiveType::LineStrip);
+    }
+
+    StrokeShape getToolShape() const {
+        switch (m_tool){
+            case Tool::Line: return StrokeShape::Line;
+            case Tool::Rect: return StrokeShape::Rect;
+            case Tool::Ellipse: return StrokeShape::Ellipse;
+            case Tool::Arc: return StrokeShape::Arc;
+            case Tool::Polyline: return StrokeShape::Polyline;
+            default: return StrokeShape::Freehand;
+        }
+    }
+
+    // the last handle follows the pointer while a shape is placed. an arc is dragged from end to
+    // end and drawn as a line until it's released, then bent towards the pointer
+    StrokeShape getPreviewShape() const {
+        return m_tool == Tool::Arc && !m_shapeBending ? StrokeShape::Line : getToolShape();
+    }
+
+    std::vector<sf::Vector2f> getPreviewHandles() const {
+        if (m_tool == Tool::Arc && m_shapeBending)
+            return {m_shapeHandles[0], m_shapeHandles[2], m_shapeHandles[1]}; // start, through, end
+        return m_shapeHandles;
+    }
+
+    // reflattens the preview into the capacity it already has, and only when a handle moved
+    void updateShapePreview(){
+        StrokeShape shape = getPreviewShape();
+        bool bent = m_tool == Tool::Arc && m_shapeBending;
+        auto handle = [this, bent](std::size_t i){ return m_shapeHandles[bent && i > 0 ? 3 - i : i]; };
+        Stroke& preview = m_shapePreview;
+        bool same = !preview.points.empty() && preview.shape == shape && preview.handles.size() == m_shapeHandles.size()
+            && preview.color == m_strokeColor && preview.thickness == m_lineThickness;
+        for (std::size_t i = 0; same && i < preview.handles.size(); i++)
+            same = preview.handles[i] == handle(i);
+        if (same)
+            return;
+        preview.shape = shape;
+        preview.color = m_strokeColor;
+        preview.thickness = m_lineThickness;
+        preview.handles.resize(m_shapeHandles.size());
+        for (std::size_t i = 0; i < preview.handles.size(); i++)
+            preview.handles[i] = handle(i);
+        preview.points.clear();
+        flattenShape(shape, preview.handles, preview.points);
+    }
+
+    // lines, rectangles and ellipses are dragged out. an arc takes a drag and a click, a polyline a
+    // click per corner, ending with a click on its last corner
+    void pressShape(sf::Vector2f pos){
+        if (m_shapeHandles.empty()){
+            m_shapeHandles = {pos, pos};
+            return;
+        }
+        if (m_tool == Tool::Arc && m_shapeBending){
+            m_shapeHandles.back() = pos;
+            commitShape(StrokeShape::Arc, getPreviewHandles());
+            return;
+        }
+        if (m_tool == Tool::Polyline){
+            sf::Vector2f last = m_shapeHandles[m_shapeHandles.size() - 2];
+            if (std::hypot(pos.x - last.x, pos.y - last.y) <= SHAPE_CLOSE_DISTANCE){
+                m_shapeHandles.pop_back();
+                commitShape(StrokeShape::Polyline, m_shapeHandles);
+                return;
+            }
+            m_shapeHandles.back() = pos;
+            m_shapeHandles.push_back(pos);
+        }
+    }
+
+    void releaseShape(){
+        if (m_shapeHandles.empty() || m_tool == Tool::Polyline || m_shapeBending)
+            return;
+        m_shapeHandles.back() = this->mapPixelToCoords({m_mousePos.x, m_mousePos.y});
+        if (m_shapeHandles[0] == m_shapeHandles[1]){
+            m_shapeHandles.clear(); // a click without a drag draws nothing
+            return;
+        }
+        if (m_tool == Tool::Arc){
+            m_shapeHandles.push_back(m_shapeHandles[1]);
+            m_shapeBending = true;
+            return;
+        }
+        commitShape(getToolShape(), m_shapeHandles);
+    }
+
+    // bakes a shape stroke into the cache the way a finished brush stroke is
+    void commitShape(StrokeShape shape, std::vector<sf::Vector2f> handles){
+        m_shapeHandles.clear();
+        m_shapeBending = false;
+        Stroke stroke = makeShapeStroke(shape, std::move(handles), m_strokeColor, m_lineThickness);
+        if (stroke.points.empty())
+            return;
+        stroke.id = m_nextStrokeId++;
+        sf::VertexArray triangles(sf::PrimitiveType::Triangles);
+        tessellateStroke(stroke, triangles);
+        CountingTarget(m_cacheTexture).draw(triangles, getStrokeStates(false));
+        m_cacheTexture.display();
+        m_shadow.drawStroke(stroke);
+        m_strokes.push_back(std::move(stroke));
+        m_curvesDirty = true;
+        m_history.recordAdd(m_strokes.back(), m_cacheTexture);
+        if (m_journal)
+            m_journal->recordAdd(m_strokes.back());
+    }
+
+    // the fill is found on the shadow raster, so the click never waits on a readback, and only the
+    // rectangle around it is uploaded and drawn into the cache
+    void fillAt(sf::Vector2f pos){
+        PROFILE_SCOPE("fill");
+        m_shadow.sync(m_strokes);
+        sf::Vector2u canvasSize = m_cacheTexture.getSize();
+        if (m_shadow.getVersion() != m_fillSourceVersion || m_fillSource.size() != (std::size_t)canvasSize.x * canvasSize.y){
+            m_fillSource.resize((std::size_t)canvasSize.x * canvasSize.y);
+            m_shadow.readIndices(sf::IntRect({0, 0}, sf::Vector2i(canvasSize)), m_fillSource.data());
+            m_fillSourceVersion = m_shadow.getVersion();
+        }
+        if (pos.x < 0.f || pos.y < 0.f)
+            return;
+        if (!m_fill.fillIndexed(m_fillSource.data(), canvasSize, {(unsigned int)pos.x, (unsigned int)pos.y}))
+            return;
+
+        Stroke stroke;
+        stroke.id = m_nextStrokeId++;
+        stroke.color = m_strokeColor;
+        stroke.thickness = 0.f;
+        stroke.stamp = BrushStamp::Fill;
+        m_fill.getRects(stroke.points);
+
+        // the region in the fill colour over transparent, the same pixels the stroke's rectangles cover
+        sf::IntRect bounds = m_fill.getBounds();
+        sf::Vector2u size(bounds.size);
+        m_fillPixels.assign((std::size_t)size.x * size.y * 4, 0);
+        for (const FillSpan& span : m_fill.getSpans()){
+            std::uint8_t* p = &m_fillPixels[((std::size_t)(span.y - bounds.position.y) * size.x + (span.x0 - bounds.position.x)) * 4];
+            for (int x = span.x0; x < span.x1; x++, p += 4){
+                p[0] = m_strokeColor.r;
+                p[1] = m_strokeColor.g;
+                p[2] = m_strokeColor.b;
+                p[3] = m_strokeColor.a;
+            }
+        }
+        if (m_fillTexture.getSize().x < size.x || m_fillTexture.getSize().y < size.y){
+            if (!m_fillTexture.resize({std::max(size.x, m_fillTexture.getSize().x), std::max(size.y, m_fillTexture.getSize().y)}))
+                return;
+        }
+        m_fillTexture.update(m_fillPixels.data(), size, {0, 0});
+        sf::Sprite sprite(m_fillTexture, sf::IntRect({0, 0}, bounds.size));
+        sprite.setPosition(sf::Vector2f(bounds.position));
+        CountingTarget(m_cacheTexture).draw(sprite);
+        m_cacheTexture.display();
+
+        m_shadow.drawStroke(stroke);
+        m_strokes.push_back(std::move(stroke));
+        m_curvesDirty = true;
+        m_history.recordAdd(m_strokes.back(), m_cacheTexture);
+        if (m_journal)
+            m_journal->recordAdd(m_strokes.back());
+    }
+
     sf::RenderWindow* m_realWindow;
     sf::RenderTexture m_cacheTexture;
     sf::Color m_strokeColor;
     float m_lineThickness;
     float m_spacing;
+    Brush m_brush;
+    Tool m_tool = Tool::Brush;
+    std::vector<sf::Vector2f> m_shapeHandles; // of the shape being placed, the last one under the pointer
+    bool m_shapeBending = false;              // an arc's ends are down, its middle follows the pointer
+    Stroke m_shapePreview;                    // kept between frames so placing a shape doesn't allocate
 
     bool m_mouseOnCanvas = false;
     bool m_drawing = false;
-    sf::Vector2f m_lastPos;
-
-    std::vector<sf::Vector2f> m_currentStroke;
-    sf::VertexArray m_currentStrokeTriangles{ sf::PrimitiveType::Triangles };
-    // Helper to generate a thick line as two triangles
-    std::vector<sf::Vertex> createThickLine(const sf::Vector2f& a, const sf::Vector2f& b, float thickness, sf::Color color) {
-        sf::Vector2f direction = b - a;
-        sf::Vector2f unit = direction / std::sqrt(direction.x * direction.x + direction.y * direction.y);
-        sf::Vector2f normal(-unit.y, unit.x);
-        sf::Vector2f offset = normal * (thickness / 2.f);
-
-        std::vector<sf::Vertex> verts(6);
-        verts[0] = constructVertex(a - offset, color);
-        verts[1] = constructVertex(b - offset, color);
-        verts[2] = constructVertex(b + offset, color);
-        verts[3] = constructVertex(b + offset, color);
-        verts[4] = constructVertex(a + offset, color);
-        verts[5] = constructVertex(a - offset, color);
-        return verts;
-    }
+    tgui::Vector2f m_mousePos; // relative to the canvas
+
+    StrokeBuilder m_builder;
+    StreamVertexBuffer m_liveBuffer; // the builder's triangles, uploaded as they're appended
+    MotionPredictor m_predictor;
+    sf::Clock m_clock;
+    sf::Vector2f m_lastSample;
+    float m_predictionLatency = 2.f / 120.f; // a frame to get drawn plus one waiting for vsync
+    CurveOverlay m_curveOverlay;
+    bool m_curvesDirty = true; // m_strokes changed since the overlay was built
+    std::vector<Stroke> m_strokes; // committed strokes, in draw order
+    std::uint32_t m_nextStrokeId = 0;
+    Journal* m_journal = nullptr;
+    History m_history;
+    // what the cache shows, on the CPU, for pixel queries, one palette index per pixel. textured
+    // stamps come out as plain quads and translucent ink as opaque, close enough to find where a fill stops
+    ShadowRaster m_shadow{sf::Color::White, ShadowFormat::Indexed};
+    std::vector<std::uint8_t> m_fillSource; // the canvas area of the shadow's indices, copied out when it changes
+    std::uint64_t m_fillSourceVersion = ~0ull;
+    FloodFill m_fill;
+    std::vector<std::uint8_t> m_fillPixels;
+    sf::Texture m_fillTexture; // grows to the largest fill so far
+
+    // selection. the selected strokes are lifted out of the cache into a buffer drawn through the
+    // group's transform, and only rewritten when the selection is dropped
+    StrokeIndex m_index;
+    Drag m_drag = Drag::None;
+    std::vector<sf::Vector2f> m_lasso;
+    std::vector<std::uint32_t> m_selected; // ascending indices into m_strokes
+    sf::VertexArray m_selectedTriangles{sf::PrimitiveType::Triangles};
+    StreamVertexBuffer m_selectedBuffer;
+    bool m_selectedStamped = false;
+    bool m_selectionTurns = true; // false with a fill in it
+    sf::FloatRect m_selectionBox; // around the selected strokes, before the transform
+    GroupTransform m_groupTransform;
+    GroupTransform m_dragFrom; // as it was when the drag started
+    sf::Vector2f m_dragStart;
+
+    struct Recognized {
+        std::uint32_t strokeId;
+        ShapeGuess guess;
+    };
+    bool m_recognizing = true;
+    Stroke m_suggestion; // the shape offered in place of the last stroke, no points when there's none
+    sf::VertexArray m_suggestionTriangles{sf::PrimitiveType::Triangles};
+    std::mutex m_recognizedMutex;
+    std::vector<Recognized> m_recognized; // guesses from the workers, not yet polled
+    WorkerPool m_workers{1};              // last, so it's joined before anything its jobs touch goes away
 };
 
-void openWhiteboardWindow() {
+void openWhiteboardWindow(InputSession& session) {
     const unsigned int windowWidth = 800;
     const unsigned int windowHeight = 600;
     sf::ContextSettings settings;
     settings.antiAliasingLevel = 8;
     sf::RenderWindow window(sf::VideoMode({windowWidth, windowHeight}), "Pizarra", sf::Style::Default, sf::State::Windowed, settings);
-    window.setFramerateLimit(120);
+    window.setFramerateLimit(session.isFastReplay() ? 0 : 120);
 
 
     tgui::Gui gui{window};
     auto whiteBoardCanvas = DrawingCanvas::create(window, {windowWidth, windowHeight - 100}, sf::Color::Black, 10.f, 5.0f);
+    // a replay has to start from the same empty board it was recorded on, and shouldn't touch the autosave
+    std::unique_ptr<Journal> journal;
+    if (!session.isReplaying()){
+        std::vector<Stroke> recovered;
+        journal = std::make_unique<Journal>("autosave", recovered);
+        whiteBoardCanvas->setStrokes(std::move(recovered));
+        whiteBoardCanvas->setJournal(journal.get());
+    }
     //whiteBoardPanel->setFocusable(true);
     auto brushPanel = tgui::Panel::create({windowWidth, 100});
     brushPanel->setPosition({0, windowHeight - 100});
@@ -324,84 +909,204 @@ void openWhiteboardWindow() {
     brushPanel->add(brushSizeLabel);
     brushPanel->add(brushSizeSlider);
 
+    // sfml doesn't report pen pressure, so the dynamic brushes follow the pointer's speed
+    struct BrushPreset {
+        const char* name;
+        Brush brush;
+    };
+    static const BrushPreset brushPresets[] = {
+        {"Pen", Brush()},
+        {"Ink", {BrushStamp::Solid, Brush::Source::Velocity, Brush::Source::None}},
+        {"Airbrush", {BrushStamp::Airbrush, Brush::Source::None, Brush::Source::None}},
+        {"Chalk", {BrushStamp::Chalk, Brush::Source::None, Brush::Source::Velocity}},
+        {"Chisel", {BrushStamp::Chisel, Brush::Source::None, Brush::Source::None}}
+    };
+    auto brushBox = tgui::ComboBox::create();
+    brushBox->setSize(brushSizeSlider->getSize().x, 20);
+    brushBox->setPosition(30, 62);
+    for (const auto& preset : brushPresets)
+        brushBox->addItem(preset.name);
+    // past the presets, the tools that draw with the stroke colour but not the brush
+    struct ToolItem {
+        const char* name;
+        DrawingCanvas::Tool tool;
+    };
+    static const ToolItem toolItems[] = {
+        {"Bucket", DrawingCanvas::Tool::Bucket},
+        {"Line", DrawingCanvas::Tool::Line},
+        {"Rectangle", DrawingCanvas::Tool::Rect},
+        {"Ellipse", DrawingCanvas::Tool::Ellipse},
+        {"Arc", DrawingCanvas::Tool::Arc},
+        {"Polyline", DrawingCanvas::Tool::Polyline},
+        {"Lasso", DrawingCanvas::Tool::Lasso},
+        {"Select", DrawingCanvas::Tool::BoxSelect}
+    };
+    for (const auto& item : toolItems)
+        brushBox->addItem(item.name);
+    brushBox->setSelectedItemByIndex(0);
+    brushBox->onItemSelect([&whiteBoardCanvas](int index){
+        const int presetCount = (int)(sizeof(brushPresets) / sizeof(BrushPreset));
+        const int toolCount = (int)(sizeof(toolItems) / sizeof(ToolItem));
+        if (index < 0 || index >= presetCount + toolCount)
+            return;
+        if (index >= presetCount){
+            whiteBoardCanvas->setTool(toolItems[index - presetCount].tool);
+            return;
+        }
+        whiteBoardCanvas->setTool(DrawingCanvas::Tool::Brush);
+        whiteBoardCanvas->setBrush(brushPresets[index].brush);
+    });
+    brushPanel->add(brushBox);
+
     sf::Color brushColors[] = {sf::Color::Black, sf::Color::White, sf::Color::Red, sf::Color::Yellow, sf::Color::Green, sf::Color::Blue, sf::Color::Magenta};
-    CircleButton::Ptr brushButtons[sizeof(brushColors)/sizeof(sf::Color)];
     gui.add(brushPanel);
     gui.add(whiteBoardCanvas);
 
     brushSizeSlider->onValueChange([&brushSizeSlider, &whiteBoardCanvas](){
         whiteBoardCanvas->setLineThickness(brushSizeSlider->getValue());
     });
-    auto customBrushButton = CircleButton::create(20, sf::Color::Black, sf::Color(16, 16, 16));
-    auto eraserButton = CircleButton::create(20, sf::Color::Red, sf::Color(245, 0, 0), true);
-    if(true){ // keep these out of the function's overall scope, and avoid conflict with the for loop ahead (add custom brush button)
-        customBrushButton->getLabel()->setText("Custom");
-        customBrushButton->getLabel()->getRenderer()->setTextColor(tgui::Color::White);
-        customBrushButton->getLabel()->setTextSize(10);
-        customBrushButton->setPosition({windowWidth - 50*sizeof(brushColors)/sizeof(sf::Color) - 100, 30.f});
-        customBrushButton->getSignal("Clicked").connect([&brushButtons, eraserButton, &customBrushButton, brushColors, &whiteBoardCanvas, &gui](){
-            for (int j = 0; j < sizeof(brushColors)/sizeof(sf::Color); j++){
-                brushButtons[j]->getSize();
-                brushButtons[j]->setOutline(sf::Color::White, 0);
-            }
-            eraserButton->setOutline(sf::Color::White, 0);
-            customBrushButton->setOutline(sf::Color::White, 3);
-            auto colorPicker = tgui::ColorPicker::create("Custom Brush Color");
-            colorPicker->onClosing([&whiteBoardCanvas, &customBrushButton, colorPicker](){
-                whiteBoardCanvas->setStrokeColor(colorPicker->getColor());
-                customBrushButton->setNormalColor(colorPicker->getColor());
-            });
-            gui.add(colorPicker);
-        });
-        brushPanel->add(customBrushButton);
-        customBrushButton->updateGraphics();
-    }
-    if(true){ // add eraser button (technically just a white brush, but the user won't know that)
-        eraserButton->setPosition({windowWidth - 50*sizeof(brushColors)/sizeof(sf::Color) - 170, 30.f});
-        sf::Texture eraserIconTex;
-        eraserIconTex.loadFromMemory(eraser_png, sizeof(eraser_png));
-        eraserButton->setImage(eraserIconTex);
-        eraserButton->getSignal("Clicked").connect([&brushButtons, eraserButton, customBrushButton, brushColors, &whiteBoardCanvas, &gui](){
-            for (int j = 0; j < sizeof(brushColors)/sizeof(sf::Color); j++){
-                brushButtons[j]->getSize();
-                brushButtons[j]->setOutline(sf::Color::White, 0);
-            }
-            customBrushButton->setOutline(sf::Color::White, 0);
-            eraserButton->setOutline(sf::Color::White, 3);
-            whiteBoardCanvas->setStrokeColor(sf::Color::White);
-        });
-        brushPanel->add(eraserButton);
-        //button->updateGraphics();
-    }
-    for (int i = 0; i < sizeof(brushColors)/sizeof(sf::Color); i++){
-        auto button = CircleButton::create(20, brushColors[i], brushColors[i]);
-        button->setPosition({windowWidth - 50*sizeof(brushColors)/sizeof(sf::Color) - 50 + i*50.f, 30.f});
-        button->getSignal("Clicked").connect([&brushButtons, eraserButton, customBrushButton, i, brushColors, &whiteBoardCanvas](){
-            for (int j = 0; j < sizeof(brushColors)/sizeof(sf::Color); j++){
-                brushButtons[j]->getSize();
-                brushButtons[j]->setOutline(sf::Color::White, 0);
-            }
-            eraserButton->setOutline(sf::Color::White, 0);
-            customBrushButton->setOutline(sf::Color::White, 0);
-            brushButtons[i]->setOutline(sf::Color::White, 3);
-            whiteBoardCanvas->setStrokeColor(brushButtons[i]->getNormalColor());
+    // eraser (technically just a white brush, but the user won't know that), custom brush, then the brush colours
+    auto brushes = std::make_shared<PaletteModel>();
+    const std::size_t eraserSwatch = brushes->addColor(sf::Color::Red);
+    auto palette = Palette::create(20.f, 4.f);
+    palette->setPosition({windowWidth - 50*sizeof(brushColors)/sizeof(sf::Color) - 173, 27.f});
+    palette->setModel(brushes);
+    palette->addSpacing(20.f);
+    const std::size_t customSwatch = brushes->addColor(sf::Color::Black);
+    for (const sf::Color& color : brushColors)
+        brushes->addColor(color);
+    sf::Image eraserIcon;
+    if (eraserIcon.loadFromMemory(eraser_png, sizeof(eraser_png)))
+        palette->setSwatchIcon(eraserSwatch, eraserIcon);
+    brushPanel->add(palette);
+    auto customLabel = tgui::Label::create("Custom");
+    customLabel->getRenderer()->setTextColor(tgui::Color::White);
+    customLabel->setTextSize(10);
+    customLabel->setPosition({palette->getPosition().x + palette->getSwatchCenter(customSwatch).x - customLabel->getSize().x/2, palette->getPosition().y + palette->getSwatchCenter(customSwatch).y - customLabel->getSize().y/2});
+    customLabel->setIgnoreMouseEvents(true);
+    brushPanel->add(customLabel);
+
+    // custom colours are remembered in a row of small swatches under the brushes, kept across sessions
+    auto recents = std::make_shared<PaletteModel>();
+    if (!session.isReplaying())
+        recents->loadFromFile("recent_colors.txt");
+    auto recentPalette = Palette::create(8.f, 4.f);
+    recentPalette->setOutline(sf::Color::White, 2.f);
+    recentPalette->setPosition({palette->getPosition().x, 77.f});
+    recentPalette->setModel(recents);
+    brushPanel->add(recentPalette);
+
+    // only one of the two palettes has a selection, and whichever does sets the stroke colour
+    brushes->addObserver([brushes, recents, eraserSwatch, &whiteBoardCanvas](PaletteModel::Change change, std::size_t index, std::size_t){
+        if (index != brushes->getSelected() || index == PALETTE_NO_SELECTION)
+            return;
+        if (change == PaletteModel::Change::Selected)
+            recents->select(PALETTE_NO_SELECTION);
+        whiteBoardCanvas->setStrokeColor(index == eraserSwatch ? sf::Color::White : brushes->getColor(index));
+    });
+    recents->addObserver([brushes, recents, &whiteBoardCanvas](PaletteModel::Change change, std::size_t index, std::size_t){
+        if (index != recents->getSelected() || index == PALETTE_NO_SELECTION)
+            return;
+        if (change == PaletteModel::Change::Selected)
+            brushes->select(PALETTE_NO_SELECTION);
+        whiteBoardCanvas->setStrokeColor(recents->getColor(index));
+    });
+    palette->onSwatchClick([brushes, recents, customSwatch, &session, &gui](unsigned int index){
+        if (index != customSwatch)
+            return;
+        auto colorPicker = tgui::ColorPicker::create("Custom Brush Color");
+        colorPicker->onClosing([brushes, recents, customSwatch, colorPicker, &session](){
+            brushes->setColor(customSwatch, colorPicker->getColor());
+            recents->pushRecent(colorPicker->getColor(), 16);
+            if (!session.isReplaying())
+                recents->saveToFile("recent_colors.txt");
         });
-        brushButtons[i] = button;
-        brushPanel->add(button);
-    } 
+        gui.add(colorPicker);
+    });
+    // F3 toggles the frame profiler, F4 starts and stops a chrome trace
+    ProfilerOverlay profilerOverlay;
+    auto profilerLegend = tgui::RichTextLabel::create();
+    profilerLegend->setPosition(500, 6);
+    profilerLegend->setTextSize(11);
+    profilerLegend->setVisible(false);
+    gui.add(profilerLegend);
+    unsigned int frameCount = 0;
+
+    session.beginWindow(1);
     while (window.isOpen()) {
-        while (const std::optional event = window.pollEvent()) {
-            gui.handleEvent(*event);
-            if (event->is<sf::Event::Closed>())
-                window.close();
-            if (event->is<sf::Event::KeyPressed>() && event->getIf<sf::Event::KeyPressed>()->code == sf::Keyboard::Key::C) {
-                std::cout << "clear\n";
-                whiteBoardCanvas->clearCanvas();
+        {
+            PROFILE_SCOPE("events");
+            while (const std::optional event = session.pollEvent(window)) {
+                gui.handleEvent(*event);
+                if (event->is<sf::Event::Closed>())
+                    window.close();
+                if (const auto* key = event->getIf<sf::Event::KeyPressed>(); key && key->code == sf::Keyboard::Key::F3) {
+                    profilerOverlay.toggle();
+                    profilerLegend->setVisible(profilerOverlay.isVisible());
+                }
+                if (const auto* key = event->getIf<sf::Event::KeyPressed>(); key && key->code == sf::Keyboard::Key::F4) {
+                    if (Profiler::isTracing()){
+                        Profiler::stopTrace();
+                        std::cout << "trace stopped\n";
+                    }
+                    else
+                        std::cout << (Profiler::startTrace("pizarra.trace.json") ? "tracing to pizarra.trace.json\n" : "trace failed\n");
+                }
+                if (event->is<sf::Event::KeyPressed>() && event->getIf<sf::Event::KeyPressed>()->code == sf::Keyboard::Key::P) {
+                    // how far the predicted ink was from where the pointer actually went, since the last P
+                    const PredictionStats& stats = whiteBoardCanvas->getPredictor().getStats();
+                    std::cout << "prediction: " << stats.count << " samples, mean error " << stats.meanError << ", rms " << stats.rmsError << ", max " << stats.maxError << "\n";
+                    whiteBoardCanvas->getPredictor().resetStats();
+                }
+                if (event->is<sf::Event::KeyPressed>() && event->getIf<sf::Event::KeyPressed>()->code == sf::Keyboard::Key::H) {
+                    whiteBoardCanvas->toggleCurves();
+                }
+                if (event->is<sf::Event::KeyPressed>() && event->getIf<sf::Event::KeyPressed>()->code == sf::Keyboard::Key::Escape) {
+                    whiteBoardCanvas->deselect();
+                }
+                if (event->is<sf::Event::KeyPressed>() && event->getIf<sf::Event::KeyPressed>()->code == sf::Keyboard::Key::Delete) {
+                    whiteBoardCanvas->eraseSelection();
+                }
+                // Tab swaps the stroke just drawn for the shape it was recognized as
+                if (event->is<sf::Event::KeyPressed>() && event->getIf<sf::Event::KeyPressed>()->code == sf::Keyboard::Key::Tab) {
+                    whiteBoardCanvas->acceptSuggestion();
+                }
+                if (event->is<sf::Event::KeyPressed>() && event->getIf<sf::Event::KeyPressed>()->code == sf::Keyboard::Key::C) {
+                    std::cout << "clear\n";
+                    whiteBoardCanvas->clearCanvas();
+                }
+                if (const auto* key = event->getIf<sf::Event::KeyPressed>(); key && key->control) {
+                    if (key->code == sf::Keyboard::Key::Z && !key->shift)
+                        whiteBoardCanvas->undo();
+                    else if (key->code == sf::Keyboard::Key::Y || (key->code == sf::Keyboard::Key::Z && key->shift))
+                        whiteBoardCanvas->redo();
+                }
+                if (event->is<sf::Event::KeyPressed>() && event->getIf<sf::Event::KeyPressed>()->code == sf::Keyboard::Key::S) {
+                    std::cout << (whiteBoardCanvas->saveDrawing("level.pzl") ? "saved\n" : "save failed\n");
+                }
+                if (event->is<sf::Event::KeyPressed>() && event->getIf<sf::Event::KeyPressed>()->code == sf::Keyboard::Key::L) {
+                    std::cout << (whiteBoardCanvas->loadDrawing("level.pzl") ? "loaded\n" : "load failed\n");
+                }
+                whiteBoardCanvas->updateGraphics();
             }
-            whiteBoardCanvas->updateGraphics();
         }
-        window.clear(sf::Color::Black);
-        gui.draw();
-        window.display();
+        session.endFrame();
+        {
+            PROFILE_SCOPE("gui.draw");
+            CountingTarget(window).clear(sf::Color::Black);
+            gui.draw(); // tgui draws straight to the window, so its own draws aren't counted
+            window.draw(profilerOverlay); // left out of the counts on purpose
+        }
+        {
+            PROFILE_SCOPE("display");
+            window.display();
+        }
+        PROFILE_COUNTER("strokes", whiteBoardCanvas->getStrokes().size());
+        RenderStats::endFrame();
+        FrameArena::endFrame();
+        PROFILE_FRAME();
+        profilerOverlay.update();
+        if (profilerOverlay.isVisible() && frameCount++ % 30 == 0)
+            profilerLegend->setText(profilerOverlay.getSummary());
     }
 }
\ No newline at end of file
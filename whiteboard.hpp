@@ -1,2 +1,3 @@
 #pragma once
-void openWhiteboardWindow();
\ No newline at end of file
+class InputSession;
+void openWhiteboardWindow(InputSession& session);
\ No newline at end of file